@@ -0,0 +1,69 @@
+// Clustered forward lighting shared by the fragment shaders; light_clusters.h builds the buffers.
+// Include after declaring the UniformBufferObject (view, proj, shadowViewProj) at set 0, binding 0 as ubo.
+
+struct PointLight {
+    vec3 position;
+    float radius;
+    vec3 color;
+    float intensity;
+};
+
+layout(std430, set = 0, binding = 7) readonly buffer Lights {
+    PointLight lights[];
+};
+
+struct LightCluster {
+    uint offset;
+    uint count;
+};
+
+// Clusters are x fastest, then y (framebuffer rows), then exponential depth slices.
+layout(std430, set = 0, binding = 8) readonly buffer Clusters {
+    uvec4 clusterDimensions;
+    float sliceScale;
+    float sliceBias;
+    vec2 tileSize;
+    LightCluster clusters[];
+};
+
+layout(std430, set = 0, binding = 9) readonly buffer LightIndices {
+    uint lightIndices[];
+};
+
+// Depth map of the lamp, lights[0], as seen looking straight down from it.
+layout(set = 0, binding = 10) uniform sampler2DShadow shadowMap;
+
+// Fraction of the lamp's light reaching worldPos; points outside the map are lit.
+float lampShadow(vec3 worldPos, vec3 normal) {
+    vec4 clip = ubo.shadowViewProj * vec4(worldPos + normal * 0.01, 1.0);
+    if (clip.w <= 0.0) {
+        return 1.0;
+    }
+    vec3 ndc = clip.xyz / clip.w;
+    if (any(greaterThan(abs(ndc.xy), vec2(1.0))) || ndc.z > 1.0) {
+        return 1.0;
+    }
+    return texture(shadowMap, vec3(ndc.xy * 0.5 + 0.5, ndc.z));
+}
+
+// Ambient and diffuse light reaching worldPos from the lights listed in its cluster. occlusion is
+// the baked ambient occlusion, 1 when there is none; it scales only the ambient term.
+vec3 clusteredLight(vec3 worldPos, vec3 normal, float occlusion) {
+    float viewDepth = max(-(ubo.view * vec4(worldPos, 1.0)).z, 1e-4);
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / tileSize), clusterDimensions.xy - 1u);
+    uint slice = uint(clamp(floor(log(viewDepth) * sliceScale + sliceBias), 0.0, float(clusterDimensions.z - 1u)));
+    LightCluster cluster = clusters[(slice * clusterDimensions.y + tile.y) * clusterDimensions.x + tile.x];
+
+    vec3 result = vec3(0.0);
+    for (uint i = 0u; i < cluster.count; ++i) {
+        uint lightIndex = lightIndices[cluster.offset + i];
+        PointLight light = lights[lightIndex];
+        vec3 toLight = light.position - worldPos;
+        float distance = length(toLight);
+        float attenuation = (1.0 - smoothstep(0.0, light.radius, distance)) * light.intensity;
+        float diff = max(dot(normal, toLight / max(distance, 1e-4)), 0.0);
+        float shadow = lightIndex == 0u ? lampShadow(worldPos, normal) : 1.0;
+        result += (0.1 * occlusion + diff * shadow) * attenuation * light.color;
+    }
+    return result;
+}
@@ -0,0 +1,17 @@
+#version 450
+
+// World-space line vertices from DebugDraw.
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec4 inColor;
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+layout(location = 0) out vec4 fragColor;
+
+void main() {
+    gl_Position = ubo.proj * ubo.view * vec4(inPosition, 1.0);
+    fragColor = inColor;
+}
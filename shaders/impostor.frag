@@ -0,0 +1,72 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// Ray-traces an analytic sphere for impostor.vert's quad, with correct depth, normals and
+// the ball's baked markings rotated with the ball.
+
+layout(location = 0) in vec3 fragWorldPos;
+layout(location = 1) flat in vec4 fragSphere;
+layout(location = 2) flat in uvec3 fragMarkings;
+layout(location = 3) flat in mat3 fragRotation;
+
+layout(location = 0) out vec4 outColor;
+// The hit is always behind the quad, so early depth testing against the quad stays valid.
+layout(depth_greater) out float gl_FragDepth;
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    mat4 shadowViewProj;
+} ubo;
+
+#include "clustered_lighting.glsl"
+
+// RGBA8 latitude-longitude marking maps, MARKING_WIDTH x MARKING_HEIGHT in impostor.h.
+layout(std430, set = 0, binding = 6) readonly buffer Markings {
+    uint texels[];
+};
+
+const float PI = 3.14159265358979;
+
+vec4 fetchTexel(uint x, uint y) {
+    return unpackUnorm4x8(texels[fragMarkings.x + y * fragMarkings.y + x]);
+}
+
+// Bilinear lookup; longitude wraps, latitude clamps at the poles.
+vec4 sampleMarkings(vec3 direction) {
+    float u = atan(direction.z, direction.x) / (2.0 * PI) + 0.5;
+    float v = acos(clamp(direction.y, -1.0, 1.0)) / PI;
+    uint width = fragMarkings.y;
+    uint height = fragMarkings.z;
+
+    vec2 texel = vec2(u * width, v * height) - 0.5;
+    vec2 base = floor(texel);
+    vec2 f = texel - base;
+    uint x0 = uint(mod(base.x, float(width)));
+    uint x1 = (x0 + 1u) % width;
+    uint y0 = uint(clamp(base.y, 0.0, float(height - 1u)));
+    uint y1 = uint(clamp(base.y + 1.0, 0.0, float(height - 1u)));
+    return mix(mix(fetchTexel(x0, y0), fetchTexel(x1, y0), f.x), mix(fetchTexel(x0, y1), fetchTexel(x1, y1), f.x), f.y);
+}
+
+void main() {
+    vec3 cameraPos = -transpose(mat3(ubo.view)) * ubo.view[3].xyz;
+    vec3 rayDir = normalize(fragWorldPos - cameraPos);
+    vec3 oc = cameraPos - fragSphere.xyz;
+    float b = dot(oc, rayDir);
+    float c = dot(oc, oc) - fragSphere.w * fragSphere.w;
+    float h = b * b - c;
+    if (h < 0.0) {
+        discard;
+    }
+    vec3 hit = cameraPos + rayDir * (-b - sqrt(h));
+    vec3 normal = (hit - fragSphere.xyz) / fragSphere.w;
+
+    vec4 clip = ubo.proj * ubo.view * vec4(hit, 1.0);
+    gl_FragDepth = clip.z / clip.w;
+
+    // Rotations are orthonormal, so the transpose takes the normal back to object space.
+    vec3 albedo = sampleMarkings(transpose(fragRotation) * normal).rgb;
+
+    outColor = vec4(clusteredLight(hit, normal, 1.0) * albedo, 1.0);
+}
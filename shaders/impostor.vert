@@ -0,0 +1,81 @@
+#version 450
+
+// One camera-facing quad per ball; impostor.frag ray-traces the sphere inside it.
+// No vertex attributes: the corner comes from gl_VertexIndex of the shared quad's indices.
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+struct ObjectData {
+    mat4 transform;
+    vec4 positionScale;
+    vec4 positionOffset;
+};
+
+struct DrawData {
+    uint objectIndex;
+    // Impostor draws store the ball's slot in the impostor table here.
+    uint materialIndex;
+};
+
+struct ImpostorData {
+    // Object-space center and radius of the ball.
+    vec4 sphere;
+    uint texelOffset;
+    uint width;
+    uint height;
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer Objects {
+    ObjectData objects[];
+};
+
+layout(std430, set = 0, binding = 3) readonly buffer Draws {
+    DrawData draws[];
+};
+
+layout(std430, set = 0, binding = 5) readonly buffer Impostors {
+    ImpostorData impostors[];
+};
+
+layout(location = 0) out vec3 fragWorldPos;
+layout(location = 1) flat out vec4 fragSphere;
+layout(location = 2) flat out uvec3 fragMarkings;
+// Object to world rotation, for looking up the markings of the rolled ball.
+layout(location = 3) flat out mat3 fragRotation;
+
+const vec2 CORNERS[4] = vec2[](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0));
+
+void main() {
+    DrawData draw = draws[gl_InstanceIndex];
+    ObjectData object = objects[draw.objectIndex];
+    ImpostorData impostor = impostors[draw.materialIndex];
+
+    mat3 linear = mat3(object.transform);
+    float scale = length(linear[0]);
+    vec3 center = (object.transform * vec4(impostor.sphere.xyz, 1.0)).xyz;
+    float radius = impostor.sphere.w * scale;
+
+    // Camera position of a rigid view matrix.
+    vec3 cameraPos = -transpose(mat3(ubo.view)) * ubo.view[3].xyz;
+    vec3 toCenter = center - cameraPos;
+    float distance = length(toCenter);
+    vec3 forward = toCenter / distance;
+    vec3 right = normalize(abs(forward.y) < 0.999 ? cross(forward, vec3(0.0, 1.0, 0.0)) : cross(forward, vec3(1.0, 0.0, 0.0)));
+    vec3 up = cross(right, forward);
+
+    // The quad sits in front of the sphere, perpendicular to the view ray, and is just large
+    // enough to cover the silhouette cone there; every ray hit is therefore behind the quad.
+    float near = max(distance - radius, 1e-3);
+    float halfSize = near * radius / sqrt(max(distance * distance - radius * radius, 1e-6));
+    vec2 corner = CORNERS[gl_VertexIndex & 3];
+    vec3 worldPos = cameraPos + forward * near + (right * corner.x + up * corner.y) * halfSize;
+
+    gl_Position = ubo.proj * ubo.view * vec4(worldPos, 1.0);
+    fragWorldPos = worldPos;
+    fragSphere = vec4(center, radius);
+    fragMarkings = uvec3(impostor.texelOffset, impostor.width, impostor.height);
+    fragRotation = linear / scale;
+}
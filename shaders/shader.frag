@@ -1,31 +1,47 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
+#extension GL_GOOGLE_include_directive : require
 
 layout(location = 0) in vec3 fragNormal;
 layout(location = 1) in vec3 fragPos;
-layout(location = 2) in vec4 fragColor;
+layout(location = 2) flat in uint fragMaterial;
+layout(location = 3) in vec2 fragTexCoord;
+#ifdef BAKED_AO
+layout(location = 4) in float fragOcclusion;
+#endif
 
 layout(location = 0) out vec4 outColor;
 
-layout(set = 0, binding = 1) uniform Light {
-    vec3 position;
-    float radius;
-    float intensity;
-} light;
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    mat4 shadowViewProj;
+} ubo;
 
-void main() {
-    float distance = length(light.position - fragPos);
-    float attenuation = 1.0 - smoothstep(0.0, light.radius, distance);
-    attenuation *= light.intensity;
+#include "clustered_lighting.glsl"
+
+struct MaterialData {
+    vec4 color;
+    uint textureIndex;
+};
+
+layout(std430, set = 0, binding = 4) readonly buffer Materials {
+    MaterialData materials[];
+};
 
-    vec3 lightDir = normalize(light.position - fragPos);
+// Bindless texture array, MAX_TEXTURES in vk_textures.h. Slot 0 is white.
+layout(set = 1, binding = 0) uniform sampler2D textures[256];
+
+void main() {
     vec3 normal = normalize(fragNormal);
-    
-    float diff = max(dot(normal, lightDir), 0.0);
-    vec3 diffuse = diff * vec3(1.0, 1.0, 1.0);
-    
-    vec3 ambient = 0.1 * vec3(1.0, 1.0, 1.0);
-    
-    vec3 result = (ambient + diffuse) * fragColor.rgb;
-    result *= attenuation;
-    outColor = vec4(result, fragColor.a);
-}
\ No newline at end of file
+
+    MaterialData material = materials[fragMaterial];
+    vec3 albedo = material.color.rgb * texture(textures[nonuniformEXT(material.textureIndex)], fragTexCoord).rgb;
+#ifdef BAKED_AO
+    float occlusion = fragOcclusion;
+#else
+    float occlusion = 1.0;
+#endif
+    vec3 result = clusteredLight(fragPos, normal, occlusion) * albedo;
+    outColor = vec4(result, material.color.a);
+}
@@ -1,28 +1,73 @@
 #version 450
 
+// Float vertices: vec3 position, vec2 UV, vec3 normal.
+// Packed vertices: SNORM position relative to the mesh bounds, half-float UV and an
+// octahedral SNORM normal that arrives as (x, y, 0).
+layout(constant_id = 0) const bool PACKED_NORMALS = false;
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec2 inTexCoord;
 layout(location = 2) in vec3 inNormal;
+#ifdef BAKED_AO
+// Ambient occlusion baked per vertex at load, from its own vertex buffer.
+layout(location = 3) in float inOcclusion;
+#endif
 
 layout(set = 0, binding = 0) uniform UniformBufferObject {
     mat4 view;
     mat4 proj;
 } ubo;
 
-layout(push_constant) uniform constants {
+struct ObjectData {
     mat4 transform;
-    vec4 color;
-} push;
+    vec4 positionScale;
+    vec4 positionOffset;
+};
+
+struct DrawData {
+    uint objectIndex;
+    uint materialIndex;
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer Objects {
+    ObjectData objects[];
+};
+
+// Indexed by gl_InstanceIndex, which is each draw's firstInstance.
+layout(std430, set = 0, binding = 3) readonly buffer Draws {
+    DrawData draws[];
+};
 
 layout(location = 0) out vec3 fragNormal;
 layout(location = 1) out vec3 fragPos;
-layout(location = 2) out vec4 fragColor;
+layout(location = 2) flat out uint fragMaterial;
+layout(location = 3) out vec2 fragTexCoord;
+#ifdef BAKED_AO
+layout(location = 4) out float fragOcclusion;
+#endif
+
+vec3 octahedralDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
 
 void main() {
-    vec4 worldPosition = push.transform * vec4(inPosition, 1.0);
+    DrawData draw = draws[gl_InstanceIndex];
+    ObjectData object = objects[draw.objectIndex];
+
+    vec3 position = inPosition * object.positionScale.xyz + object.positionOffset.xyz;
+    vec3 normal = PACKED_NORMALS ? octahedralDecode(inNormal.xy) : inNormal;
+
+    vec4 worldPosition = object.transform * vec4(position, 1.0);
     gl_Position = ubo.proj * ubo.view * worldPosition;
     
     fragPos = vec3(worldPosition);
-    fragNormal = mat3(transpose(inverse(push.transform))) * inNormal;
-    fragColor = push.color;
-}
\ No newline at end of file
+    fragNormal = mat3(transpose(inverse(object.transform))) * normal;
+    fragMaterial = draw.materialIndex;
+    fragTexCoord = inTexCoord;
+#ifdef BAKED_AO
+    fragOcclusion = inOcclusion;
+#endif
+}
@@ -0,0 +1,37 @@
+#version 450
+
+// Depth-only pass into the lamp's shadow map. Only the position is read, which has the
+// same meaning in both vertex formats.
+layout(location = 0) in vec3 inPosition;
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    mat4 shadowViewProj;
+} ubo;
+
+struct ObjectData {
+    mat4 transform;
+    vec4 positionScale;
+    vec4 positionOffset;
+};
+
+struct DrawData {
+    uint objectIndex;
+    uint materialIndex;
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer Objects {
+    ObjectData objects[];
+};
+
+// Indexed by gl_InstanceIndex, which is each draw's firstInstance.
+layout(std430, set = 0, binding = 3) readonly buffer Draws {
+    DrawData draws[];
+};
+
+void main() {
+    ObjectData object = objects[draws[gl_InstanceIndex].objectIndex];
+    vec3 position = inPosition * object.positionScale.xyz + object.positionOffset.xyz;
+    gl_Position = ubo.shadowViewProj * object.transform * vec4(position, 1.0);
+}
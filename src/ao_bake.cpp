@@ -0,0 +1,214 @@
+#include "ao_bake.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "parallel_for.h"
+
+namespace {
+    const float PI = 3.14159265358979f;
+    // Vertices claimed by a bake thread at a time.
+    const size_t VERTEX_CHUNK = 64;
+
+    // Integer hash (lowbias32) giving every vertex its own rotation of the sample pattern.
+    uint32_t hash(uint32_t x) {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // Van der Corput sequence in base 2, the second Hammersley coordinate.
+    float radical_inverse(uint32_t bits) {
+        bits = (bits << 16u) | (bits >> 16u);
+        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+        return static_cast<float>(bits) * 2.3283064365386963e-10f;
+    }
+
+    float fract(float value) {
+        return value - std::floor(value);
+    }
+
+    bool hit_box(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, const glm::vec3& minimum, const glm::vec3& maximum) {
+        glm::vec3 t0 = (minimum - origin) * inverseDirection;
+        glm::vec3 t1 = (maximum - origin) * inverseDirection;
+        glm::vec3 entries = glm::min(t0, t1);
+        glm::vec3 exits = glm::max(t0, t1);
+        float enter = std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+        float leave = std::min(std::min(exits.x, exits.y), std::min(exits.z, maxDistance));
+        return enter <= leave;
+    }
+}
+
+void TriangleBvh::build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+    using namespace ao_bake;
+
+    const uint32_t count = static_cast<uint32_t>(indices.size() / 3);
+    std::vector<glm::vec3> minimums(count), maximums(count), centroids(count);
+    std::vector<uint32_t> order(count);
+    for (uint32_t t = 0; t < count; ++t) {
+        const glm::vec3& a = vertices[indices[t * 3]].pos;
+        const glm::vec3& b = vertices[indices[t * 3 + 1]].pos;
+        const glm::vec3& c = vertices[indices[t * 3 + 2]].pos;
+        minimums[t] = glm::min(a, glm::min(b, c));
+        maximums[t] = glm::max(a, glm::max(b, c));
+        centroids[t] = (minimums[t] + maximums[t]) * 0.5f;
+        order[t] = t;
+    }
+
+    nodes.clear();
+    nodes.reserve(count > 0 ? 2 * count / LEAF_TRIANGLES + 1 : 0);
+    treeDepth = 0;
+
+    // Appends the subtree over order[first, last); the left child lands right after its parent.
+    auto build_node = [&](auto& self, uint32_t first, uint32_t last, uint32_t depth) -> void {
+        const uint32_t index = static_cast<uint32_t>(nodes.size());
+        nodes.push_back({});
+        treeDepth = std::max(treeDepth, depth + 1);
+
+        glm::vec3 minimum(INFINITY), maximum(-INFINITY);
+        glm::vec3 centroidMinimum(INFINITY), centroidMaximum(-INFINITY);
+        for (uint32_t i = first; i < last; ++i) {
+            minimum = glm::min(minimum, minimums[order[i]]);
+            maximum = glm::max(maximum, maximums[order[i]]);
+            centroidMinimum = glm::min(centroidMinimum, centroids[order[i]]);
+            centroidMaximum = glm::max(centroidMaximum, centroids[order[i]]);
+        }
+        nodes[index].minimum = minimum;
+        nodes[index].maximum = maximum;
+
+        glm::vec3 extent = centroidMaximum - centroidMinimum;
+        int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+        if (last - first <= LEAF_TRIANGLES || depth + 1 >= MAX_DEPTH || extent[axis] <= 0.0f) {
+            nodes[index].offset = first;
+            nodes[index].count = last - first;
+            return;
+        }
+
+        const uint32_t middle = first + (last - first) / 2;
+        std::nth_element(order.begin() + first, order.begin() + middle, order.begin() + last,
+                         [&](uint32_t lhs, uint32_t rhs) { return centroids[lhs][axis] < centroids[rhs][axis]; });
+        self(self, first, middle, depth + 1);
+        nodes[index].offset = static_cast<uint32_t>(nodes.size());
+        nodes[index].count = 0;
+        self(self, middle, last, depth + 1);
+    };
+    if (count > 0) {
+        build_node(build_node, 0, count, 0);
+    }
+
+    // Leaves index triangles in tree order.
+    triangles.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t t = order[i];
+        const glm::vec3& a = vertices[indices[t * 3]].pos;
+        triangles[i] = {a, vertices[indices[t * 3 + 1]].pos - a, vertices[indices[t * 3 + 2]].pos - a};
+    }
+}
+
+bool TriangleBvh::occluded(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const {
+    if (nodes.empty()) {
+        return false;
+    }
+    const glm::vec3 inverseDirection = 1.0f / direction;
+
+    // Only right children wait on the stack, at most one per level.
+    uint32_t stack[ao_bake::MAX_DEPTH];
+    uint32_t stackSize = 0;
+    uint32_t current = 0;
+    while (true) {
+        const Node& node = nodes[current];
+        if (hit_box(origin, inverseDirection, maxDistance, node.minimum, node.maximum)) {
+            if (node.count == 0) {
+                stack[stackSize++] = node.offset;
+                current++;
+                continue;
+            }
+            // Möller-Trumbore, accepting both faces.
+            for (uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+                const Triangle& triangle = triangles[i];
+                glm::vec3 p = glm::cross(direction, triangle.edge2);
+                float determinant = glm::dot(triangle.edge1, p);
+                if (std::fabs(determinant) < 1e-12f) {
+                    continue;
+                }
+                float inverse = 1.0f / determinant;
+                glm::vec3 s = origin - triangle.a;
+                float u = glm::dot(s, p) * inverse;
+                if (u < 0.0f || u > 1.0f) {
+                    continue;
+                }
+                glm::vec3 q = glm::cross(s, triangle.edge1);
+                float v = glm::dot(direction, q) * inverse;
+                if (v < 0.0f || u + v > 1.0f) {
+                    continue;
+                }
+                float t = glm::dot(triangle.edge2, q) * inverse;
+                if (t > 0.0f && t < maxDistance) {
+                    return true;
+                }
+            }
+        }
+        if (stackSize == 0) {
+            return false;
+        }
+        current = stack[--stackSize];
+    }
+}
+
+std::vector<uint8_t> ao_bake::bake(const std::vector<Vertex>& vertices, const TriangleBvh& bvh, uint32_t rayCount,
+                                   float maxDistance, uint32_t threadCount) {
+    std::vector<uint8_t> occlusion(vertices.size(), 255);
+    if (rayCount == 0 || bvh.triangleCount() == 0) {
+        return occlusion;
+    }
+    // Rays start this far off the surface so they do not hit the triangles they leave.
+    const float bias = maxDistance * 1e-3f;
+
+    auto bake_vertex = [&](size_t index) {
+        const Vertex& vertex = vertices[index];
+        float length = glm::length(vertex.normal);
+        if (!(length > 1e-6f)) {
+            return;
+        }
+        const glm::vec3 normal = vertex.normal / length;
+        // Orthonormal basis around the normal (Duff et al. 2017).
+        float sign = std::copysign(1.0f, normal.z);
+        float a = -1.0f / (sign + normal.z);
+        float b = normal.x * normal.y * a;
+        const glm::vec3 tangent(1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+        const glm::vec3 bitangent(b, sign + normal.y * normal.y * a, -normal.y);
+        const glm::vec3 origin = vertex.pos + normal * bias;
+
+        // Hammersley points, randomly shifted per vertex to trade banding for noise.
+        uint32_t seed = hash(static_cast<uint32_t>(index));
+        float shiftU = (seed & 0xFFFFu) / 65536.0f;
+        float shiftV = (seed >> 16) / 65536.0f;
+        uint32_t escaped = 0;
+        for (uint32_t i = 0; i < rayCount; ++i) {
+            float u = fract((i + 0.5f) / rayCount + shiftU);
+            float v = fract(radical_inverse(i) + shiftV);
+            // Cosine-weighted: uniform on the disk, lifted onto the hemisphere.
+            float radius = std::sqrt(u);
+            float phi = 2.0f * PI * v;
+            glm::vec3 direction = tangent * (radius * std::cos(phi)) + bitangent * (radius * std::sin(phi)) +
+                                  normal * std::sqrt(std::max(0.0f, 1.0f - u));
+            if (!bvh.occluded(origin, direction, maxDistance)) {
+                escaped++;
+            }
+        }
+        occlusion[index] = static_cast<uint8_t>(std::lround(255.0f * escaped / rayCount));
+    };
+
+    parallel::parallel_for(vertices.size(), VERTEX_CHUNK, threadCount, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            bake_vertex(i);
+        }
+    });
+    return occlusion;
+}
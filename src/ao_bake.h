@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+
+// Bounding volume hierarchy over a triangle list, answering any-hit occlusion queries.
+// Nodes are stored depth first: an interior node's left child follows it directly.
+class TriangleBvh {
+    public:
+
+    // Builds the tree by splitting every node at the median centroid of its longest axis.
+    void build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+    // True if the ray hits any triangle, either face, at a distance in (0, maxDistance).
+    bool occluded(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const;
+
+    uint32_t nodeCount() const { return static_cast<uint32_t>(nodes.size()); }
+    uint32_t triangleCount() const { return static_cast<uint32_t>(triangles.size()); }
+    uint32_t depth() const { return treeDepth; }
+
+    private:
+
+    struct Node {
+        glm::vec3 minimum;
+        // Interior: index of the right child. Leaf: first triangle.
+        uint32_t offset;
+        glm::vec3 maximum;
+        // Triangles in a leaf; 0 for interior nodes.
+        uint32_t count;
+    };
+
+    // Vertex a and the two edges leaving it, as the intersection test wants them.
+    struct Triangle {
+        glm::vec3 a;
+        glm::vec3 edge1;
+        glm::vec3 edge2;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<Triangle> triangles;
+    uint32_t treeDepth = 0;
+};
+
+// Per-vertex ambient occlusion baked by ray tracing the geometry around each vertex.
+namespace ao_bake {
+    // Triangles per BVH leaf and the deepest tree the traversal stack allows.
+    const uint32_t LEAF_TRIANGLES = 4;
+    const uint32_t MAX_DEPTH = 64;
+
+    // Fraction of a cosine-weighted hemisphere of rayCount rays around each vertex normal that
+    // escapes the geometry within maxDistance, as UNORM8 (255 is fully open). Vertices without
+    // a normal stay open. Runs on threadCount threads; 0 uses every core.
+    std::vector<uint8_t> bake(const std::vector<Vertex>& vertices, const TriangleBvh& bvh, uint32_t rayCount,
+                              float maxDistance, uint32_t threadCount = 0);
+}
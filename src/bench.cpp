@@ -0,0 +1,129 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+static void sort_shots(BenchScript& script) {
+    std::stable_sort(script.shots.begin(), script.shots.end(), [](const BenchEvent& a, const BenchEvent& b) {
+        return a.frame < b.frame;
+    });
+}
+
+BenchScript bench::load_script(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open bench script " + path);
+    }
+
+    BenchScript script;
+    script.name = path;
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream tokens(line);
+        std::string command;
+        if (!(tokens >> command)) {
+            continue;
+        }
+
+        BenchEvent event{};
+        bool parsed = false;
+        if (command == "camera") {
+            event.type = BenchEventType::Camera;
+            parsed = static_cast<bool>(tokens >> event.frame >> event.values[0] >> event.values[1] >> event.values[2]);
+        } else if (command == "orbit") {
+            event.type = BenchEventType::Orbit;
+            parsed = static_cast<bool>(tokens >> event.frame >> event.endFrame >> event.values[0]) && event.endFrame > event.frame;
+        } else if (command == "shot") {
+            event.type = BenchEventType::Shot;
+            parsed = static_cast<bool>(tokens >> event.frame >> event.values[0] >> event.values[1]);
+        } else if (command == "rack") {
+            event.type = BenchEventType::Rack;
+            parsed = static_cast<bool>(tokens >> event.frame);
+        } else {
+            throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": unknown bench command '" + command + "'.");
+        }
+
+        std::string extra;
+        if (!parsed || tokens >> extra) {
+            throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": malformed '" + command + "' line.");
+        }
+
+        if (event.type == BenchEventType::Shot) {
+            script.shots.push_back(event);
+        } else {
+            script.events.push_back(event);
+        }
+    }
+
+    sort_shots(script);
+    return script;
+}
+
+BenchScript bench::default_script() {
+    BenchScript script;
+    script.name = "default";
+    script.events.push_back({BenchEventType::Camera, 0, 0, {60.0f, 35.0f, 12.0f}});
+    script.events.push_back({BenchEventType::Orbit, 0, UINT32_MAX, {15.0f, 0.0f, 0.0f}});
+    script.shots.push_back({BenchEventType::Shot, 30, 0, {0.0f, 10.0f, 0.0f}});
+    script.shots.push_back({BenchEventType::Shot, 300, 0, {200.0f, 8.0f, 0.0f}});
+    script.shots.push_back({BenchEventType::Shot, 450, 0, {140.0f, 12.0f, 0.0f}});
+    return script;
+}
+
+static std::string json_escape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+static void write_summary(std::ofstream& out, const char* name, const StatsSummary& summary) {
+    out << "  \"" << name << "\": {\"avg\": " << summary.average << ", \"p50\": " << summary.p50
+        << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99 << "},\n";
+}
+
+bool bench::write_results(const std::string& path, const BenchResults& results) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    out << "{\n";
+    out << "  \"script\": \"" << json_escape(results.script) << "\",\n";
+    out << "  \"frames\": " << results.frames << ",\n";
+    out << "  \"timestep\": " << results.timestep << ",\n";
+    out << "  \"headless\": " << (results.headless ? "true" : "false") << ",\n";
+    out << "  \"width\": " << results.width << ",\n";
+    out << "  \"height\": " << results.height << ",\n";
+    out << "  \"frames_in_flight\": " << results.framesInFlight << ",\n";
+    out << "  \"present_mode\": \"" << results.presentMode << "\",\n";
+    out << "  \"wall_time_s\": " << results.wallTimeSeconds << ",\n";
+    out << "  \"shots_fired\": " << results.shotsFired << ",\n";
+    write_summary(out, "cpu_frame_ms", results.cpuFrameMs);
+    write_summary(out, "physics_step_ms", results.physicsMs);
+    if (results.gpuTimestamps) {
+        write_summary(out, "gpu_frame_ms", results.gpuFrameMs);
+        write_summary(out, "gpu_static_ms", results.gpuStaticMs);
+        write_summary(out, "gpu_dynamic_ms", results.gpuDynamicMs);
+    }
+    if (results.gpuStatistics) {
+        out << "  \"gpu_invocations\": {\"static_vs\": " << results.staticVertexInvocations << ", \"static_fs\": " << results.staticFragmentInvocations
+            << ", \"dynamic_vs\": " << results.dynamicVertexInvocations << ", \"dynamic_fs\": " << results.dynamicFragmentInvocations << "},\n";
+    }
+    out << "  \"per_frame\": {\"draw_calls\": " << results.drawCalls << ", \"triangles\": " << results.triangles
+        << ", \"pipeline_binds\": " << results.pipelineBinds << ", \"vertex_buffer_binds\": " << results.vertexBufferBinds << ", \"index_buffer_binds\": " << results.indexBufferBinds
+        << ", \"indirect_calls\": " << results.indirectCalls << "}\n";
+    out << "}\n";
+    return out.good();
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rolling_stats.h"
+
+enum class BenchEventType {
+    Camera,
+    Orbit,
+    Shot,
+    Rack
+};
+
+// One timeline entry. Frames are simulation frames; values depend on the type:
+//   camera: yaw (deg), pitch (deg), distance
+//   orbit:  yaw rate (deg/s) for frames [frame, endFrame)
+//   shot:   cue angle (deg), power
+//   rack:   none
+struct BenchEvent {
+    BenchEventType type;
+    uint32_t frame = 0;
+    uint32_t endFrame = 0;
+    float values[3] = {};
+};
+
+struct BenchScript {
+    std::string name;
+    // Camera, orbit and rack events, applied on the frames they cover.
+    std::vector<BenchEvent> events;
+    // Sorted by frame. A shot fires on its frame, or as soon as the cue ball comes to rest.
+    std::vector<BenchEvent> shots;
+};
+
+// Everything written to the results file.
+struct BenchResults {
+    std::string script;
+    uint32_t frames = 0;
+    float timestep = 0.0f;
+    bool headless = false;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t framesInFlight = 0;
+    std::string presentMode;
+    double wallTimeSeconds = 0.0;
+    uint32_t shotsFired = 0;
+
+    StatsSummary cpuFrameMs;
+    StatsSummary physicsMs;
+    bool gpuTimestamps = false;
+    StatsSummary gpuFrameMs;
+    StatsSummary gpuStaticMs;
+    StatsSummary gpuDynamicMs;
+    bool gpuStatistics = false;
+    // Shader invocations per frame of the static and dynamic draw groups.
+    double staticVertexInvocations = 0.0;
+    double staticFragmentInvocations = 0.0;
+    double dynamicVertexInvocations = 0.0;
+    double dynamicFragmentInvocations = 0.0;
+
+    // Per-frame averages.
+    double drawCalls = 0.0;
+    double triangles = 0.0;
+    double pipelineBinds = 0.0;
+    double vertexBufferBinds = 0.0;
+    double indexBufferBinds = 0.0;
+    double indirectCalls = 0.0;
+};
+
+namespace bench {
+    // Parses a timeline file. Throws on unreadable files and malformed lines.
+    BenchScript load_script(const std::string& path);
+
+    // Built-in timeline: a slow orbit with a break shot and follow-up shots.
+    BenchScript default_script();
+
+    // Writes the results as JSON. Returns false when the file cannot be written.
+    bool write_results(const std::string& path, const BenchResults& results);
+}
@@ -0,0 +1,115 @@
+#include "debug_draw.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+VkVertexInputBindingDescription DebugVertex::getBindingDescription() {
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding = 0;
+    bindingDescription.stride = sizeof(DebugVertex);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    return bindingDescription;
+}
+
+std::array<VkVertexInputAttributeDescription, 2> DebugVertex::getAttributeDescriptions() {
+    std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
+    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescriptions[0].offset = offsetof(DebugVertex, position);
+
+    attributeDescriptions[1].binding = 0;
+    attributeDescriptions[1].location = 1;
+    attributeDescriptions[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+    attributeDescriptions[1].offset = offsetof(DebugVertex, color);
+    return attributeDescriptions;
+}
+
+uint32_t debug_color(float r, float g, float b, float a) {
+    auto channel = [](float value) { return static_cast<uint32_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f); };
+    return channel(r) | channel(g) << 8 | channel(b) << 16 | channel(a) << 24;
+}
+
+void DebugDraw::begin(DebugVertex* vertices, uint32_t capacity) {
+    this->vertices = vertices;
+    this->capacity = vertices ? capacity : 0;
+    count = 0;
+    dropped = 0;
+}
+
+DebugVertex* DebugDraw::reserve(uint32_t vertexCount) {
+    if (vertexCount > capacity - count) {
+        dropped += vertexCount;
+        return nullptr;
+    }
+    DebugVertex* reserved = vertices + count;
+    count += vertexCount;
+    return reserved;
+}
+
+void DebugDraw::line(const glm::vec3& a, const glm::vec3& b, uint32_t color) {
+    if (DebugVertex* out = reserve(2)) {
+        out[0] = {a, color};
+        out[1] = {b, color};
+    }
+}
+
+void DebugDraw::box(const glm::vec3& minimum, const glm::vec3& maximum, uint32_t color) {
+    DebugVertex* out = reserve(24);
+    if (!out) {
+        return;
+    }
+    auto corner = [&](uint32_t i) {
+        return glm::vec3(i & 1 ? maximum.x : minimum.x, i & 2 ? maximum.y : minimum.y, i & 4 ? maximum.z : minimum.z);
+    };
+    // Each edge joins two corners that differ in exactly one axis bit.
+    for (uint32_t i = 0; i < 8; ++i) {
+        for (uint32_t axis = 1; axis < 8; axis <<= 1) {
+            if (!(i & axis)) {
+                *out++ = {corner(i), color};
+                *out++ = {corner(i | axis), color};
+            }
+        }
+    }
+}
+
+void DebugDraw::sphere(const glm::vec3& center, float radius, uint32_t color, uint32_t segments) {
+    segments = std::max(segments, 3u);
+    DebugVertex* out = reserve(segments * 6);
+    if (!out) {
+        return;
+    }
+    const float step = 2.0f * 3.14159265f / segments;
+    for (uint32_t s = 0; s < segments; ++s) {
+        float c0 = std::cos(s * step) * radius, s0 = std::sin(s * step) * radius;
+        float c1 = std::cos((s + 1) * step) * radius, s1 = std::sin((s + 1) * step) * radius;
+        *out++ = {center + glm::vec3(c0, s0, 0.0f), color};
+        *out++ = {center + glm::vec3(c1, s1, 0.0f), color};
+        *out++ = {center + glm::vec3(c0, 0.0f, s0), color};
+        *out++ = {center + glm::vec3(c1, 0.0f, s1), color};
+        *out++ = {center + glm::vec3(0.0f, c0, s0), color};
+        *out++ = {center + glm::vec3(0.0f, c1, s1), color};
+    }
+}
+
+void DebugDraw::trajectory(const glm::vec3* points, size_t pointCount, uint32_t color) {
+    if (pointCount < 2) {
+        return;
+    }
+    DebugVertex* out = reserve(static_cast<uint32_t>((pointCount - 1) * 2));
+    if (!out) {
+        return;
+    }
+    for (size_t i = 0; i + 1 < pointCount; ++i) {
+        *out++ = {points[i], color};
+        *out++ = {points[i + 1], color};
+    }
+}
+
+void DebugDraw::axes(const glm::mat4& transform, float length) {
+    glm::vec3 origin = glm::vec3(transform[3]);
+    line(origin, origin + glm::vec3(transform[0]) * length, debug_color(0.8f, 0.1f, 0.1f));
+    line(origin, origin + glm::vec3(transform[1]) * length, debug_color(0.1f, 0.8f, 0.1f));
+    line(origin, origin + glm::vec3(transform[2]) * length, debug_color(0.1f, 0.1f, 0.8f));
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "vk_types.h"
+
+// One line endpoint: world-space position and an RGBA8 color (R in the lowest byte).
+struct DebugVertex {
+    glm::vec3 position;
+    uint32_t color;
+
+    // Returns the binding description for a debug vertex.
+    static VkVertexInputBindingDescription getBindingDescription();
+
+    // Returns the attribute descriptions for a debug vertex.
+    static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions();
+};
+
+// Packs a color into DebugVertex::color.
+uint32_t debug_color(float r, float g, float b, float a = 1.0f);
+
+// Immediate-mode line list written straight into a mapped vertex buffer. Shapes are rebuilt
+// every frame between begin and the draw; nothing is allocated, and shapes that do not fit
+// in the buffer are dropped whole and counted.
+class DebugDraw {
+    public:
+
+    // Starts a frame that appends into vertices, which holds capacity entries.
+    void begin(DebugVertex* vertices, uint32_t capacity);
+
+    void line(const glm::vec3& a, const glm::vec3& b, uint32_t color);
+    // Axis-aligned box.
+    void box(const glm::vec3& minimum, const glm::vec3& maximum, uint32_t color);
+    // Three great circles of segments lines each.
+    void sphere(const glm::vec3& center, float radius, uint32_t color, uint32_t segments = 16);
+    // Polyline through count points.
+    void trajectory(const glm::vec3* points, size_t count, uint32_t color);
+    // Red, green and blue lines along the transform's X, Y and Z axes.
+    void axes(const glm::mat4& transform, float length);
+
+    uint32_t vertexCount() const { return count; }
+    // Vertices rejected by the budget since begin.
+    uint32_t droppedVertices() const { return dropped; }
+
+    private:
+
+    // Reserves space for a whole shape; returns nullptr and counts it as dropped if it does not fit.
+    DebugVertex* reserve(uint32_t vertexCount);
+
+    DebugVertex* vertices = nullptr;
+    uint32_t capacity = 0;
+    uint32_t count = 0;
+    uint32_t dropped = 0;
+};
@@ -0,0 +1,90 @@
+#include "draw_sort.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace {
+    const uint32_t LAYER_SHIFT = 62;
+    const uint32_t PIPELINE_SHIFT = LAYER_SHIFT - draw_sort::PIPELINE_BITS;
+
+    uint64_t field(uint32_t value, uint32_t bits) {
+        return value & ((uint64_t(1) << bits) - 1);
+    }
+}
+
+uint32_t draw_sort::depth_bucket(float viewDepth, float farPlane) {
+    const uint32_t maxBucket = (1u << DEPTH_BITS) - 1;
+    if (!(viewDepth > 0.0f) || farPlane <= 0.0f) {
+        return 0;
+    }
+    float normalized = std::min(viewDepth / farPlane, 1.0f);
+    return static_cast<uint32_t>(normalized * maxBucket);
+}
+
+uint64_t draw_sort::make_key(DrawLayer layer, uint32_t pipeline, uint32_t mesh, uint32_t material, uint32_t depthBucket) {
+    uint64_t key = field(static_cast<uint32_t>(layer), 2) << LAYER_SHIFT;
+    key |= field(pipeline, PIPELINE_BITS) << PIPELINE_SHIFT;
+
+    if (layer == DrawLayer::Translucent) {
+        // Farthest first: invert the depth so larger distances sort lower.
+        uint64_t inverted = field(~depthBucket, DEPTH_BITS);
+        key |= inverted << (MESH_BITS + MATERIAL_BITS);
+        key |= field(mesh, MESH_BITS) << MATERIAL_BITS;
+        key |= field(material, MATERIAL_BITS);
+    } else {
+        key |= field(mesh, MESH_BITS) << (MATERIAL_BITS + DEPTH_BITS);
+        key |= field(material, MATERIAL_BITS) << DEPTH_BITS;
+        key |= field(depthBucket, DEPTH_BITS);
+    }
+    return key;
+}
+
+DrawLayer draw_sort::key_layer(uint64_t key) {
+    return static_cast<DrawLayer>(key >> LAYER_SHIFT);
+}
+
+uint32_t draw_sort::key_pipeline(uint64_t key) {
+    return static_cast<uint32_t>(field(static_cast<uint32_t>(key >> PIPELINE_SHIFT), PIPELINE_BITS));
+}
+
+void draw_sort::radix_sort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch) {
+    const size_t count = entries.size();
+    if (count < 2) {
+        return;
+    }
+
+    // All eight histograms in one pass over the keys.
+    std::array<std::array<uint32_t, 256>, 8> histograms{};
+    for (const SortEntry& entry : entries) {
+        for (uint32_t pass = 0; pass < 8; ++pass) {
+            histograms[pass][(entry.key >> (pass * 8)) & 0xFF]++;
+        }
+    }
+
+    scratch.resize(count);
+    std::vector<SortEntry>* source = &entries;
+    std::vector<SortEntry>* destination = &scratch;
+    for (uint32_t pass = 0; pass < 8; ++pass) {
+        std::array<uint32_t, 256>& histogram = histograms[pass];
+        const uint32_t shift = pass * 8;
+        if (histogram[((*source)[0].key >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t& bucket : histogram) {
+            uint32_t bucketCount = bucket;
+            bucket = offset;
+            offset += bucketCount;
+        }
+        for (const SortEntry& entry : *source) {
+            (*destination)[histogram[(entry.key >> shift) & 0xFF]++] = entry;
+        }
+        std::swap(source, destination);
+    }
+
+    if (source != &entries) {
+        entries.swap(scratch);
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Draws are ordered by layer first so translucent draws always follow every opaque one.
+enum class DrawLayer : uint32_t {
+    Opaque = 0,
+    Translucent = 1
+};
+
+// A draw's sort key and its position in the frame's list of collected draws.
+struct SortEntry {
+    uint64_t key;
+    uint32_t index;
+};
+
+// 64-bit draw keys, most significant field first:
+//   opaque:      layer:2 | pipeline:6 | mesh:16  | material:16 | depth:24 (front to back)
+//   translucent: layer:2 | pipeline:6 | depth:24 (back to front) | mesh:16 | material:16
+// Opaque draws group by state and only use depth to break ties; translucent draws need
+// correct blending, so depth wins over state.
+namespace draw_sort {
+    const uint32_t PIPELINE_BITS = 6;
+    const uint32_t MESH_BITS = 16;
+    const uint32_t MATERIAL_BITS = 16;
+    const uint32_t DEPTH_BITS = 24;
+
+    // Quantizes a view-space depth to DEPTH_BITS, clamped to [0, farPlane].
+    uint32_t depth_bucket(float viewDepth, float farPlane);
+
+    // Packs a key; fields wider than their bits are truncated.
+    uint64_t make_key(DrawLayer layer, uint32_t pipeline, uint32_t mesh, uint32_t material, uint32_t depthBucket);
+
+    DrawLayer key_layer(uint64_t key);
+    uint32_t key_pipeline(uint64_t key);
+
+    // Stable LSD radix sort on the keys, one byte per pass; passes where every key has the
+    // same byte are skipped. scratch is resized as needed and keeps its capacity between frames.
+    void radix_sort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+}
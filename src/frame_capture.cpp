@@ -0,0 +1,227 @@
+#include "frame_capture.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+CaptureEncoder::~CaptureEncoder() {
+    stop();
+}
+
+void CaptureEncoder::start(const std::string& directory, CaptureFormat format, uint32_t slotCount) {
+    outputDirectory = directory;
+    outputFormat = format;
+    std::filesystem::create_directories(outputDirectory);
+
+    slotBusy = std::make_unique<std::atomic<bool>[]>(slotCount);
+    for (uint32_t i = 0; i < slotCount; ++i) {
+        slotBusy[i] = false;
+    }
+
+    stopping = false;
+    worker = std::thread(&CaptureEncoder::run, this);
+}
+
+void CaptureEncoder::stop() {
+    if (!worker.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobAvailable.notify_one();
+    worker.join();
+}
+
+void CaptureEncoder::waitIdle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    jobsDone.wait(lock, [this] { return jobs.empty() && !busy; });
+}
+
+void CaptureEncoder::submit(const CaptureJob& job) {
+    slotBusy[job.slot].store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(job);
+    }
+    jobAvailable.notify_one();
+}
+
+bool CaptureEncoder::isSlotBusy(uint32_t slot) const {
+    return slotBusy[slot].load(std::memory_order_acquire);
+}
+
+void CaptureEncoder::run() {
+    profiler::set_thread_name("Capture encoder");
+
+    while (true) {
+        CaptureJob job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;
+            }
+            job = jobs.front();
+            jobs.pop_front();
+            busy = true;
+        }
+
+        encode(job);
+        slotBusy[job.slot].store(false, std::memory_order_release);
+        encoded.fetch_add(1, std::memory_order_relaxed);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy = false;
+        }
+        jobsDone.notify_all();
+    }
+}
+
+void CaptureEncoder::encode(const CaptureJob& job) {
+    PROFILE_FUNCTION();
+    char name[64];
+    bool written = false;
+
+    if (outputFormat == CaptureFormat::PNG) {
+        std::snprintf(name, sizeof(name), "frame_%06llu.png", static_cast<unsigned long long>(job.frameNumber));
+        written = capture::write_png(outputDirectory + "/" + name, job.pixels, job.width, job.height, job.bgra, scratch);
+    } else {
+        std::snprintf(name, sizeof(name), "frame_%06llu_%ux%u.%s", static_cast<unsigned long long>(job.frameNumber),
+                      job.width, job.height, job.bgra ? "bgra" : "rgba");
+        written = capture::write_raw(outputDirectory + "/" + name, job.pixels, job.width, job.height);
+    }
+
+    if (!written) {
+        std::cerr << "[ERROR] Failed to write capture " << outputDirectory << "/" << name << std::endl;
+    }
+}
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t size) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[n] = c;
+        }
+        return t;
+    }();
+
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static void put_u32_be(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static void write_chunk(std::ofstream& file, const char type[4], const uint8_t* data, size_t size) {
+    std::vector<uint8_t> header;
+    put_u32_be(header, static_cast<uint32_t>(size));
+    header.insert(header.end(), type, type + 4);
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    if (size > 0) {
+        file.write(reinterpret_cast<const char*>(data), size);
+    }
+
+    uint32_t crc = crc32_update(0xFFFFFFFFu, reinterpret_cast<const uint8_t*>(type), 4);
+    crc = crc32_update(crc, data, size) ^ 0xFFFFFFFFu;
+    std::vector<uint8_t> footer;
+    put_u32_be(footer, crc);
+    file.write(reinterpret_cast<const char*>(footer.data()), footer.size());
+}
+
+bool capture::write_png(const std::string& path, const uint8_t* pixels, uint32_t width, uint32_t height, bool bgra, std::vector<uint8_t>& scratch) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    std::vector<uint8_t> ihdr;
+    put_u32_be(ihdr, width);
+    put_u32_be(ihdr, height);
+    ihdr.push_back(8);  // bit depth
+    ihdr.push_back(6);  // RGBA
+    ihdr.push_back(0);  // deflate
+    ihdr.push_back(0);  // adaptive filtering
+    ihdr.push_back(0);  // no interlace
+    write_chunk(file, "IHDR", ihdr.data(), ihdr.size());
+
+    // Scanlines with a "None" filter byte, wrapped in stored deflate blocks. Compression
+    // is left to offline tools; the encoder thread has to keep up with the frame rate.
+    const size_t rowBytes = static_cast<size_t>(width) * 4;
+    const size_t rawSize = (rowBytes + 1) * height;
+    const size_t maxBlock = 65535;
+    const size_t blockCount = (rawSize + maxBlock - 1) / maxBlock;
+
+    scratch.clear();
+    scratch.reserve(2 + rawSize + blockCount * 5 + 4);
+    scratch.push_back(0x78);
+    scratch.push_back(0x01);
+
+    uint32_t adlerA = 1, adlerB = 0;
+    size_t blockRemaining = 0;
+    size_t rawWritten = 0;
+
+    auto emit = [&](uint8_t byte) {
+        if (blockRemaining == 0) {
+            size_t blockSize = std::min(maxBlock, rawSize - rawWritten);
+            bool last = rawWritten + blockSize == rawSize;
+            scratch.push_back(last ? 1 : 0);
+            scratch.push_back(static_cast<uint8_t>(blockSize));
+            scratch.push_back(static_cast<uint8_t>(blockSize >> 8));
+            scratch.push_back(static_cast<uint8_t>(~blockSize));
+            scratch.push_back(static_cast<uint8_t>(~blockSize >> 8));
+            blockRemaining = blockSize;
+        }
+        scratch.push_back(byte);
+        adlerA = (adlerA + byte) % 65521;
+        adlerB = (adlerB + adlerA) % 65521;
+        --blockRemaining;
+        ++rawWritten;
+    };
+
+    for (uint32_t y = 0; y < height; ++y) {
+        emit(0);
+        const uint8_t* row = pixels + y * rowBytes;
+        for (uint32_t x = 0; x < width; ++x) {
+            const uint8_t* p = row + x * 4;
+            emit(bgra ? p[2] : p[0]);
+            emit(p[1]);
+            emit(bgra ? p[0] : p[2]);
+            emit(p[3]);
+        }
+    }
+    put_u32_be(scratch, (adlerB << 16) | adlerA);
+
+    write_chunk(file, "IDAT", scratch.data(), scratch.size());
+    write_chunk(file, "IEND", nullptr, 0);
+
+    return file.good();
+}
+
+bool capture::write_raw(const std::string& path, const uint8_t* pixels, uint32_t width, uint32_t height) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(pixels), static_cast<std::streamsize>(width) * height * 4);
+    return file.good();
+}
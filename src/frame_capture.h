@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class CaptureFormat {
+    PNG,
+    Raw
+};
+
+// One finished readback handed to the encoder. The pixels live in a mapped
+// readback buffer that stays reserved until the encoder releases the slot.
+struct CaptureJob {
+    uint32_t slot;
+    uint64_t frameNumber;
+    const uint8_t* pixels;
+    uint32_t width;
+    uint32_t height;
+    bool bgra;
+};
+
+// Background thread that writes captured frames to disk so the frame loop never
+// waits on encoding or file I/O.
+class CaptureEncoder {
+    public:
+
+    ~CaptureEncoder();
+
+    // Starts the worker thread. Frames are written into directory, which is created if needed.
+    void start(const std::string& directory, CaptureFormat format, uint32_t slotCount);
+    // Finishes every queued job and joins the worker thread.
+    void stop();
+    // Blocks until every queued job has been written.
+    void waitIdle();
+
+    // Queues a job and marks its slot busy until it has been written.
+    void submit(const CaptureJob& job);
+    // Returns true while the encoder still reads from the given slot.
+    bool isSlotBusy(uint32_t slot) const;
+
+    // Number of frames written so far.
+    uint64_t encodedFrames() const { return encoded.load(std::memory_order_relaxed); }
+
+    private:
+
+    void run();
+    void encode(const CaptureJob& job);
+
+    std::string outputDirectory;
+    CaptureFormat outputFormat = CaptureFormat::PNG;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    std::condition_variable jobsDone;
+    std::deque<CaptureJob> jobs;
+    bool stopping = false;
+    bool busy = false;
+    std::unique_ptr<std::atomic<bool>[]> slotBusy;
+    std::atomic<uint64_t> encoded{0};
+    std::vector<uint8_t> scratch;
+};
+
+namespace capture {
+    // Writes 8-bit RGBA pixels as an uncompressed (stored deflate) PNG. Swizzles BGRA input when bgra is set.
+    bool write_png(const std::string& path, const uint8_t* pixels, uint32_t width, uint32_t height, bool bgra, std::vector<uint8_t>& scratch);
+    // Writes the pixels unchanged.
+    bool write_raw(const std::string& path, const uint8_t* pixels, uint32_t width, uint32_t height);
+}
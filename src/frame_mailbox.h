@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Single-producer / single-consumer triple buffer. The producer always owns one
+// slot, the consumer always owns another, and the third sits in the "middle"
+// waiting to be picked up. Publishing and consuming are a single atomic exchange
+// each, so neither side ever blocks on the other and the consumer always sees
+// the most recent complete value.
+template<typename T>
+class FrameMailbox {
+    public:
+
+    // Returns the slot the producer is free to write into.
+    T& back() {
+        return slots[backIndex];
+    }
+
+    // Hands the back slot to the consumer and takes the previous middle slot in return.
+    void publish() {
+        uint8_t previous = middle.exchange(backIndex | FRESH_BIT, std::memory_order_acq_rel);
+        backIndex = previous & INDEX_MASK;
+    }
+
+    // Returns the newest published slot. The reference stays valid until the next call.
+    const T& latest(bool* isNew = nullptr) {
+        bool fresh = (middle.load(std::memory_order_relaxed) & FRESH_BIT) != 0;
+        if (fresh) {
+            uint8_t previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+            frontIndex = previous & INDEX_MASK;
+        }
+        if (isNew) {
+            *isNew = fresh;
+        }
+        return slots[frontIndex];
+    }
+
+    private:
+
+    static constexpr uint8_t INDEX_MASK = 0x3;
+    static constexpr uint8_t FRESH_BIT = 0x4;
+
+    std::array<T, 3> slots{};
+    uint8_t backIndex = 0;
+    std::atomic<uint8_t> middle{1};
+    uint8_t frontIndex = 2;
+};
@@ -0,0 +1,81 @@
+#include "impostor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+namespace {
+    const float PI = 3.14159265358979f;
+
+    // Möller-Trumbore; returns the distance along direction, or a negative value on a miss.
+    float intersect(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+        glm::vec3 edge1 = b - a;
+        glm::vec3 edge2 = c - a;
+        glm::vec3 p = glm::cross(direction, edge2);
+        float determinant = glm::dot(edge1, p);
+        if (std::fabs(determinant) < 1e-12f) {
+            return -1.0f;
+        }
+        float inverse = 1.0f / determinant;
+        glm::vec3 s = origin - a;
+        float u = glm::dot(s, p) * inverse;
+        if (u < 0.0f || u > 1.0f) {
+            return -1.0f;
+        }
+        glm::vec3 q = glm::cross(s, edge1);
+        float v = glm::dot(direction, q) * inverse;
+        if (v < 0.0f || u + v > 1.0f) {
+            return -1.0f;
+        }
+        return glm::dot(edge2, q) * inverse;
+    }
+}
+
+glm::vec4 impostor::range_sphere(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const IndexRange& range) {
+    if (range.indexCount == 0) {
+        return glm::vec4(0.0f);
+    }
+    glm::vec3 minimum = vertices[indices[range.firstIndex]].pos;
+    glm::vec3 maximum = minimum;
+    for (uint32_t i = range.firstIndex; i < range.firstIndex + range.indexCount; ++i) {
+        minimum = glm::min(minimum, vertices[indices[i]].pos);
+        maximum = glm::max(maximum, vertices[indices[i]].pos);
+    }
+    glm::vec3 center = (minimum + maximum) * 0.5f;
+    float radius = 0.0f;
+    for (uint32_t i = range.firstIndex; i < range.firstIndex + range.indexCount; ++i) {
+        radius = std::max(radius, glm::length(vertices[indices[i]].pos - center));
+    }
+    return glm::vec4(center, radius);
+}
+
+glm::vec3 impostor::texel_direction(uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    float longitude = ((x + 0.5f) / width - 0.5f) * 2.0f * PI;
+    float colatitude = (y + 0.5f) / height * PI;
+    return {std::sin(colatitude) * std::cos(longitude), std::cos(colatitude), std::sin(colatitude) * std::sin(longitude)};
+}
+
+std::vector<uint32_t> impostor::bake_markings(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                                              const std::vector<ColoredRange>& ranges, const glm::vec3& center,
+                                              uint32_t width, uint32_t height) {
+    const uint32_t fallback = ranges.empty() ? 0xFFFFFFFFu : ranges.front().color;
+    std::vector<uint32_t> texels(static_cast<size_t>(width) * height, fallback);
+
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            glm::vec3 direction = texel_direction(x, y, width, height);
+            float farthest = 0.0f;
+            for (const ColoredRange& colored : ranges) {
+                for (uint32_t i = 0; i + 2 < colored.range.indexCount; i += 3) {
+                    const uint32_t* triangle = &indices[colored.range.firstIndex + i];
+                    float t = intersect(center, direction, vertices[triangle[0]].pos, vertices[triangle[1]].pos, vertices[triangle[2]].pos);
+                    if (t > farthest) {
+                        farthest = t;
+                        texels[static_cast<size_t>(y) * width + x] = colored.color;
+                    }
+                }
+            }
+        }
+    }
+    return texels;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+#include "mesh_optimizer.h"
+
+// A triangle range of a mesh and the RGBA8 color its surface is painted with.
+struct ColoredRange {
+    IndexRange range;
+    uint32_t color;
+};
+
+namespace impostor {
+    // Size of a baked marking map: a latitude-longitude grid around the sphere center.
+    const uint32_t MARKING_WIDTH = 128;
+    const uint32_t MARKING_HEIGHT = 64;
+
+    // Bounding sphere (center, radius) of the vertices a range uses. Fit to a ball's largest range,
+    // it ignores markings that stand off the surface.
+    glm::vec4 range_sphere(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const IndexRange& range);
+
+    // Direction of texel (x, y) of a width x height latitude-longitude map. Row 0 is +Y;
+    // longitude 0 is +X and grows towards +Z, matching the lookup in impostor.frag.
+    glm::vec3 texel_direction(uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+    // Casts a ray from center through every texel direction and stores the color of the outermost
+    // triangle it hits, so markings modelled as separate geometry on top of the ball win.
+    // Texels that miss every triangle take the color of the first range.
+    std::vector<uint32_t> bake_markings(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                                        const std::vector<ColoredRange>& ranges, const glm::vec3& center,
+                                        uint32_t width = MARKING_WIDTH, uint32_t height = MARKING_HEIGHT);
+}
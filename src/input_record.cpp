@@ -0,0 +1,87 @@
+#include "input_record.h"
+
+#include <cstring>
+#include <stdexcept>
+
+static const char INPUT_MAGIC[4] = {'V', 'R', 'I', 'N'};
+static const uint32_t INPUT_VERSION = 1;
+static const size_t INPUT_RECORD_SIZE = 6;
+
+static void put_u16(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static void put_u32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+static uint32_t get_u32(const uint8_t* in) {
+    return in[0] | (in[1] << 8) | (in[2] << 16) | (static_cast<uint32_t>(in[3]) << 24);
+}
+
+InputRecorder::~InputRecorder() {
+    close();
+}
+
+void InputRecorder::open(const std::string& path) {
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to create input recording " + path);
+    }
+
+    uint8_t header[12];
+    std::memcpy(header, INPUT_MAGIC, 4);
+    put_u32(header + 4, INPUT_VERSION);
+    put_u32(header + 8, INPUT_KEY_COUNT);
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    frames = 0;
+}
+
+void InputRecorder::close() {
+    if (file.is_open()) {
+        file.close();
+    }
+}
+
+void InputRecorder::write(const InputFrame& frame) {
+    uint32_t dtBits;
+    std::memcpy(&dtBits, &frame.deltaTime, sizeof(dtBits));
+
+    uint8_t record[INPUT_RECORD_SIZE];
+    put_u16(record, frame.keys);
+    put_u32(record + 2, dtBits);
+    file.write(reinterpret_cast<const char*>(record), sizeof(record));
+    ++frames;
+}
+
+void InputReplay::open(const std::string& path) {
+    file.open(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open input recording " + path);
+    }
+
+    uint8_t header[12];
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header)) || std::memcmp(header, INPUT_MAGIC, 4) != 0) {
+        throw std::runtime_error(path + " is not an input recording.");
+    }
+    if (get_u32(header + 4) != INPUT_VERSION || get_u32(header + 8) != INPUT_KEY_COUNT) {
+        throw std::runtime_error(path + " was recorded by an incompatible version.");
+    }
+    frames = 0;
+}
+
+bool InputReplay::next(InputFrame& frame) {
+    uint8_t record[INPUT_RECORD_SIZE];
+    if (!file.read(reinterpret_cast<char*>(record), sizeof(record))) {
+        return false;
+    }
+
+    uint32_t dtBits = get_u32(record + 2);
+    frame.keys = static_cast<uint16_t>(record[0] | (record[1] << 8));
+    std::memcpy(&frame.deltaTime, &dtBits, sizeof(dtBits));
+    ++frames;
+    return true;
+}
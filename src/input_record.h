@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// Keys processInput reacts to, as bit positions in InputFrame::keys.
+enum InputKey : uint16_t {
+    INPUT_KEY_A,
+    INPUT_KEY_D,
+    INPUT_KEY_W,
+    INPUT_KEY_S,
+    INPUT_KEY_E,
+    INPUT_KEY_Q,
+    INPUT_KEY_LEFT,
+    INPUT_KEY_RIGHT,
+    INPUT_KEY_SPACE,
+    INPUT_KEY_COUNT
+};
+
+// Everything one simulation tick consumed: the sampled key states and the
+// (already clamped) timestep.
+struct InputFrame {
+    uint16_t keys = 0;
+    float deltaTime = 0.0f;
+
+    bool pressed(InputKey key) const { return (keys >> key) & 1u; }
+};
+
+// Appends input frames to a binary stream: a 12-byte header ("VRIN", version,
+// key count) followed by 6 bytes per tick (little-endian uint16 keys, float32 dt).
+class InputRecorder {
+    public:
+
+    ~InputRecorder();
+
+    // Creates the file and writes the header. Throws when it cannot be created.
+    void open(const std::string& path);
+    void close();
+    bool isOpen() const { return file.is_open(); }
+
+    void write(const InputFrame& frame);
+    uint64_t frameCount() const { return frames; }
+
+    private:
+
+    std::ofstream file;
+    uint64_t frames = 0;
+};
+
+// Reads a stream written by InputRecorder.
+class InputReplay {
+    public:
+
+    // Opens the file and validates the header. Throws on missing or foreign files.
+    void open(const std::string& path);
+
+    // Reads the next frame. Returns false at the end of the stream.
+    bool next(InputFrame& frame);
+    uint64_t frameCount() const { return frames; }
+
+    private:
+
+    std::ifstream file;
+    uint64_t frames = 0;
+};
@@ -0,0 +1,118 @@
+#include "light_clusters.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Cluster coordinate of a normalized device coordinate along an axis of count tiles.
+    uint32_t tile(float ndc, uint32_t count) {
+        float t = std::floor((ndc * 0.5f + 0.5f) * count);
+        return static_cast<uint32_t>(std::clamp(t, 0.0f, static_cast<float>(count - 1)));
+    }
+}
+
+void LightClusterBuilder::build(const std::vector<GPUPointLight>& lights, const ClusterCamera& camera) {
+    using namespace light_clusters;
+
+    const float logDepthRatio = std::log(camera.zFar / camera.zNear);
+    header.dimensions[0] = GRID_X;
+    header.dimensions[1] = GRID_Y;
+    header.dimensions[2] = GRID_Z;
+    header.dimensions[3] = CLUSTER_COUNT;
+    header.sliceScale = GRID_Z / logDepthRatio;
+    header.sliceBias = -(GRID_Z * std::log(camera.zNear)) / logDepthRatio;
+    header.tileWidth = static_cast<float>(camera.width) / GRID_X;
+    header.tileHeight = static_cast<float>(camera.height) / GRID_Y;
+
+    auto slice = [this](float depth) {
+        float s = std::floor(std::log(depth) * header.sliceScale + header.sliceBias);
+        return static_cast<uint32_t>(std::clamp(s, 0.0f, static_cast<float>(GRID_Z - 1)));
+    };
+
+    clusterRanges.assign(CLUSTER_COUNT, LightCluster{0, 0});
+    bounds.clear();
+    visible = 0;
+    occupied = 0;
+    maxPerCluster = 0;
+    dropped = 0;
+
+    const float tanY = std::tan(camera.fovY * 0.5f);
+    const float tanX = tanY * camera.aspect;
+    const size_t lightCount = std::min(lights.size(), static_cast<size_t>(MAX_LIGHTS));
+    for (size_t i = 0; i < lightCount; ++i) {
+        const GPUPointLight& light = lights[i];
+        if (light.radius <= 0.0f || light.intensity <= 0.0f) {
+            continue;
+        }
+        const glm::vec3 center = glm::vec3(camera.view * glm::vec4(light.position, 1.0f));
+        const float radius = light.radius;
+        float nearDepth = -center.z - radius;
+        float farDepth = -center.z + radius;
+        if (farDepth <= camera.zNear || nearDepth >= camera.zFar) {
+            continue;
+        }
+        nearDepth = std::max(nearDepth, camera.zNear);
+        farDepth = std::min(farDepth, camera.zFar);
+
+        // Screen extent of the light's view-space box: each side projects furthest at either its
+        // nearest or its farthest depth, so the tile range is conservative.
+        const float minX = std::min((center.x - radius) / nearDepth, (center.x - radius) / farDepth) / tanX;
+        const float maxX = std::max((center.x + radius) / nearDepth, (center.x + radius) / farDepth) / tanX;
+        const float minY = std::min((center.y - radius) / nearDepth, (center.y - radius) / farDepth) / tanY;
+        const float maxY = std::max((center.y + radius) / nearDepth, (center.y + radius) / farDepth) / tanY;
+        if (maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f) {
+            continue;
+        }
+
+        LightBounds lightBounds;
+        lightBounds.light = static_cast<uint32_t>(i);
+        lightBounds.minX = tile(minX, GRID_X);
+        lightBounds.maxX = tile(maxX, GRID_X);
+        // Framebuffer rows grow downwards while view-space y grows upwards.
+        lightBounds.minY = tile(-maxY, GRID_Y);
+        lightBounds.maxY = tile(-minY, GRID_Y);
+        lightBounds.minZ = slice(nearDepth);
+        lightBounds.maxZ = slice(farDepth);
+        bounds.push_back(lightBounds);
+
+        for (uint32_t z = lightBounds.minZ; z <= lightBounds.maxZ; ++z) {
+            for (uint32_t y = lightBounds.minY; y <= lightBounds.maxY; ++y) {
+                for (uint32_t x = lightBounds.minX; x <= lightBounds.maxX; ++x) {
+                    clusterRanges[(z * GRID_Y + y) * GRID_X + x].count++;
+                }
+            }
+        }
+    }
+    visible = static_cast<uint32_t>(bounds.size());
+
+    // Clusters are laid out back to back; those past the index budget keep what still fits.
+    uint32_t offset = 0;
+    for (LightCluster& cluster : clusterRanges) {
+        uint32_t kept = std::min(cluster.count, MAX_LIGHT_INDICES - offset);
+        dropped += cluster.count - kept;
+        cluster.offset = offset;
+        cluster.count = kept;
+        offset += kept;
+        if (kept > 0) {
+            occupied++;
+            maxPerCluster = std::max(maxPerCluster, kept);
+        }
+    }
+
+    // Second pass in light order, so every cluster lists its lights in ascending order.
+    lightIndices.resize(offset);
+    cursors.assign(CLUSTER_COUNT, 0);
+    for (const LightBounds& lightBounds : bounds) {
+        for (uint32_t z = lightBounds.minZ; z <= lightBounds.maxZ; ++z) {
+            for (uint32_t y = lightBounds.minY; y <= lightBounds.maxY; ++y) {
+                for (uint32_t x = lightBounds.minX; x <= lightBounds.maxX; ++x) {
+                    uint32_t index = (z * GRID_Y + y) * GRID_X + x;
+                    const LightCluster& cluster = clusterRanges[index];
+                    if (cursors[index] < cluster.count) {
+                        lightIndices[cluster.offset + cursors[index]++] = lightBounds.light;
+                    }
+                }
+            }
+        }
+    }
+}
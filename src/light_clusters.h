@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// One point light in the light storage buffer (std430). Light falls off to zero at radius.
+struct GPUPointLight {
+    glm::vec3 position;
+    float radius;
+    glm::vec3 color;
+    float intensity;
+};
+
+// A cluster's run of the light index list.
+struct LightCluster {
+    uint32_t offset;
+    uint32_t count;
+};
+
+// Header of the cluster storage buffer (std430): what the fragment shader needs to find its cluster.
+struct GPUClusterGrid {
+    // Clusters along x, y and z, and their product.
+    uint32_t dimensions[4];
+    // slice = log(view depth) * sliceScale + sliceBias.
+    float sliceScale;
+    float sliceBias;
+    // Framebuffer pixels per tile.
+    float tileWidth;
+    float tileHeight;
+};
+
+// Perspective camera the clusters are built for. view looks down -Z.
+struct ClusterCamera {
+    glm::mat4 view;
+    float fovY;
+    float aspect;
+    float zNear;
+    float zFar;
+    uint32_t width;
+    uint32_t height;
+};
+
+// Clustered forward lighting: the view frustum is split into GRID_X x GRID_Y screen tiles and
+// GRID_Z exponential depth slices, and every light is listed in each froxel its bounding box touches.
+namespace light_clusters {
+    const uint32_t GRID_X = 16;
+    const uint32_t GRID_Y = 9;
+    const uint32_t GRID_Z = 24;
+    const uint32_t CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+    // Capacity of the light buffer and of the index list shared by all clusters.
+    const uint32_t MAX_LIGHTS = 1024;
+    const uint32_t MAX_LIGHT_INDICES = CLUSTER_COUNT * 32;
+}
+
+// Bins lights into the cluster grid on the CPU. Storage is allocated once and reused every frame.
+class LightClusterBuilder {
+    public:
+
+    // Rebuilds every cluster's light list; lights beyond MAX_LIGHTS are ignored.
+    void build(const std::vector<GPUPointLight>& lights, const ClusterCamera& camera);
+
+    const GPUClusterGrid& grid() const { return header; }
+    // CLUSTER_COUNT entries, x fastest, then y, then z.
+    const std::vector<LightCluster>& clusters() const { return clusterRanges; }
+    // Light indices referenced by the clusters.
+    const std::vector<uint32_t>& indices() const { return lightIndices; }
+
+    // Lights that touch at least one cluster.
+    uint32_t visibleLights() const { return visible; }
+    uint32_t occupiedClusters() const { return occupied; }
+    uint32_t maxClusterLights() const { return maxPerCluster; }
+    // Indices dropped because the index list was full.
+    uint32_t droppedIndices() const { return dropped; }
+
+    private:
+
+    // Cluster bounds of one light, inclusive.
+    struct LightBounds {
+        uint32_t light;
+        uint32_t minX, maxX, minY, maxY, minZ, maxZ;
+    };
+
+    GPUClusterGrid header{};
+    std::vector<LightCluster> clusterRanges;
+    std::vector<uint32_t> lightIndices;
+    std::vector<LightBounds> bounds;
+    // Fill position inside each cluster during the second pass.
+    std::vector<uint32_t> cursors;
+    uint32_t visible = 0;
+    uint32_t occupied = 0;
+    uint32_t maxPerCluster = 0;
+    uint32_t dropped = 0;
+};
@@ -1,12 +1,25 @@
 #include "vk_engine.h"
+#include "settings.h"
+#include "texture_compress.h"
+#include "transform_batch.h"
 #include <cstdlib>
 #include <iostream>
 #include <memory>
 
 int main(int argc, char* argv[]) {
-  std::unique_ptr<VulkanApplication> app = std::make_unique<VulkanApplication>();
-
   try {
+    RendererSettings rendererSettings = settings::parse_command_line(argc, argv);
+    if (rendererSettings.transformBenchCount > 0) {
+      transform_batch::run_benchmark(rendererSettings.transformBenchCount);
+      return EXIT_SUCCESS;
+    }
+    if (!rendererSettings.bakeTextures.empty()) {
+      texture_compress::bake_files(rendererSettings.bakeTextures, rendererSettings.bakeFormat);
+      return EXIT_SUCCESS;
+    }
+
+    std::unique_ptr<VulkanApplication> app = std::make_unique<VulkanApplication>(rendererSettings);
+
     app->init();
     app->run();
     app->cleanup();
@@ -1,6 +1,11 @@
 #include "mesh.h"
 #include "tiny_obj_loader.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <iostream>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
 
   VkVertexInputBindingDescription Vertex::getBindingDescription() {
     VkVertexInputBindingDescription bindingDescription{};
@@ -29,4 +34,96 @@
     attributeDescriptions[2].offset = offsetof(Vertex, normal);
 
     return attributeDescriptions;
-  }
\ No newline at end of file
+  }
+
+  VkVertexInputBindingDescription PackedVertex::getBindingDescription() {
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding = 0;
+    bindingDescription.stride = sizeof(PackedVertex);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    return bindingDescription;
+  }
+
+  std::array<VkVertexInputAttributeDescription, 3> PackedVertex::getAttributeDescriptions() {
+    std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_SNORM;
+    attributeDescriptions[0].offset = offsetof(PackedVertex, pos);
+
+    attributeDescriptions[1].binding = 0;
+    attributeDescriptions[1].location = 1;
+    attributeDescriptions[1].format = VK_FORMAT_R16G16_SFLOAT;
+    attributeDescriptions[1].offset = offsetof(PackedVertex, texCoord);
+
+    attributeDescriptions[2].binding = 0;
+    attributeDescriptions[2].location = 2;
+    attributeDescriptions[2].format = VK_FORMAT_R16G16_SNORM;
+    attributeDescriptions[2].offset = offsetof(PackedVertex, normal);
+
+    return attributeDescriptions;
+  }
+
+  static int16_t to_snorm16(float value) {
+    return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+  }
+
+  glm::vec2 vertex_packing::octahedral_encode(glm::vec3 normal) {
+    float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (l1 == 0.0f) {
+      return glm::vec2(0.0f);
+    }
+    normal /= l1;
+
+    glm::vec2 encoded(normal.x, normal.y);
+    if (normal.z < 0.0f) {
+      encoded = glm::vec2((1.0f - std::abs(normal.y)) * (normal.x >= 0.0f ? 1.0f : -1.0f),
+                          (1.0f - std::abs(normal.x)) * (normal.y >= 0.0f ? 1.0f : -1.0f));
+    }
+    return encoded;
+  }
+
+  glm::vec3 vertex_packing::octahedral_decode(glm::vec2 encoded) {
+    glm::vec3 normal(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+    float t = std::max(-normal.z, 0.0f);
+    normal.x += normal.x >= 0.0f ? -t : t;
+    normal.y += normal.y >= 0.0f ? -t : t;
+    return glm::normalize(normal);
+  }
+
+  VertexQuantization vertex_packing::pack(const std::vector<Vertex>& vertices, std::vector<PackedVertex>& packed) {
+    packed.resize(vertices.size());
+    if (vertices.empty()) {
+      return VertexQuantization{};
+    }
+
+    glm::vec3 minBounds = vertices[0].pos;
+    glm::vec3 maxBounds = vertices[0].pos;
+    for (const Vertex& vertex : vertices) {
+      minBounds = glm::min(minBounds, vertex.pos);
+      maxBounds = glm::max(maxBounds, vertex.pos);
+    }
+
+    // Flat meshes get a tiny extent on their flat axis so the division stays finite.
+    VertexQuantization quantization;
+    quantization.offset = (minBounds + maxBounds) * 0.5f;
+    quantization.scale = glm::max((maxBounds - minBounds) * 0.5f, glm::vec3(1e-6f));
+
+    for (size_t i = 0; i < vertices.size(); ++i) {
+      const Vertex& vertex = vertices[i];
+      glm::vec3 local = (vertex.pos - quantization.offset) / quantization.scale;
+      glm::vec2 normal = octahedral_encode(vertex.normal);
+
+      PackedVertex& out = packed[i];
+      out.pos[0] = to_snorm16(local.x);
+      out.pos[1] = to_snorm16(local.y);
+      out.pos[2] = to_snorm16(local.z);
+      out.pos[3] = 0;
+      out.normal[0] = to_snorm16(normal.x);
+      out.normal[1] = to_snorm16(normal.y);
+      out.texCoord[0] = glm::packHalf1x16(vertex.texCoord.x);
+      out.texCoord[1] = glm::packHalf1x16(vertex.texCoord.y);
+    }
+    return quantization;
+  }
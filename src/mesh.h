@@ -1,6 +1,8 @@
 #pragma once
 #include <vulkan/vulkan.h>
 #include <array>
+#include <cstdint>
+#include <vector>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 
@@ -19,3 +21,32 @@ struct Vertex {
     return pos == other.pos && texCoord == other.texCoord && normal == other.normal;
   }
 };
+
+// 16-byte vertex baked from Vertex: position as 16-bit SNORM relative to the mesh bounds,
+// octahedral-encoded 16-bit SNORM normal and half-float texture coordinates.
+struct PackedVertex {
+  int16_t pos[4];
+  int16_t normal[2];
+  uint16_t texCoord[2];
+
+  // Returns the binding description for a packed vertex.
+  static VkVertexInputBindingDescription getBindingDescription();
+
+  // Returns the attribute descriptions for a packed vertex, at the same locations as Vertex.
+  static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions();
+};
+
+// Maps the SNORM positions back to object space: pos = snorm * scale + offset.
+struct VertexQuantization {
+  glm::vec3 scale{1.0f};
+  glm::vec3 offset{0.0f};
+};
+
+namespace vertex_packing {
+  // Packs vertices into the compact layout and returns the dequantization for the mesh bounds.
+  VertexQuantization pack(const std::vector<Vertex>& vertices, std::vector<PackedVertex>& packed);
+
+  // Encodes a unit vector onto the octahedron, both components in [-1, 1].
+  glm::vec2 octahedral_encode(glm::vec3 normal);
+  glm::vec3 octahedral_decode(glm::vec2 encoded);
+}
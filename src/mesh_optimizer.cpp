@@ -0,0 +1,510 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+VertexCacheStats mesh_optimizer::analyze_vertex_cache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+    VertexCacheStats stats;
+    if (indexCount < 3) {
+        return stats;
+    }
+
+    // Each vertex remembers when it entered the FIFO; it is still cached while fewer than
+    // cacheSize misses have happened since.
+    std::vector<uint64_t> enteredAt(vertexCount, 0);
+    std::vector<uint8_t> referenced(vertexCount, 0);
+    uint64_t misses = 0;
+    size_t uniqueVertices = 0;
+
+    for (size_t i = 0; i < indexCount; ++i) {
+        uint32_t v = indices[i];
+        if (!referenced[v]) {
+            referenced[v] = 1;
+            ++uniqueVertices;
+        }
+        if (enteredAt[v] == 0 || misses - enteredAt[v] >= cacheSize) {
+            ++misses;
+            enteredAt[v] = misses;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+    return stats;
+}
+
+std::vector<uint32_t> mesh_optimizer::optimize_vertex_cache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+    std::vector<uint32_t> clusterStarts;
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) {
+        return clusterStarts;
+    }
+
+    // Vertex -> triangle adjacency in compressed rows.
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i) {
+        liveTriangles[indices[i]]++;
+    }
+    std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+    }
+    std::vector<uint32_t> adjacency(adjacencyOffset[vertexCount]);
+    std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+
+    uint32_t timestamp = cacheSize + 1;
+    size_t scanCursor = 0;
+    int64_t fanning = indices[0];
+    clusterStarts.push_back(0);
+
+    while (fanning >= 0) {
+        candidates.clear();
+        uint32_t f = static_cast<uint32_t>(fanning);
+        for (uint32_t a = adjacencyOffset[f]; a < adjacencyOffset[f + 1]; ++a) {
+            uint32_t t = adjacency[a];
+            if (emitted[t]) {
+                continue;
+            }
+            for (int k = 0; k < 3; ++k) {
+                uint32_t v = indices[t * 3 + k];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                if (timestamp - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = timestamp++;
+                }
+            }
+            emitted[t] = 1;
+        }
+
+        // Prefer the 1-ring vertex that stays in the cache longest while its remaining
+        // triangles are emitted.
+        int64_t next = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (liveTriangles[v] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            if (timestamp - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+                priority = timestamp - cacheTime[v];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+
+        if (next < 0) {
+            while (!deadEnd.empty() && next < 0) {
+                uint32_t v = deadEnd.back();
+                deadEnd.pop_back();
+                if (liveTriangles[v] > 0) {
+                    next = v;
+                }
+            }
+            while (next < 0 && scanCursor < vertexCount) {
+                if (liveTriangles[scanCursor] > 0) {
+                    next = static_cast<int64_t>(scanCursor);
+                }
+                ++scanCursor;
+            }
+            if (next >= 0 && output.size() < triangleCount * 3) {
+                clusterStarts.push_back(static_cast<uint32_t>(output.size() / 3));
+            }
+        }
+        fanning = next;
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+    return clusterStarts;
+}
+
+void mesh_optimizer::optimize_overdraw(uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& clusterStarts) {
+    size_t triangleCount = indexCount / 3;
+    if (clusterStarts.size() < 2) {
+        return;
+    }
+
+    struct Cluster {
+        uint32_t firstTriangle;
+        uint32_t triangleCount;
+        glm::vec3 centroid;
+        glm::vec3 normal;
+        float sortKey;
+    };
+
+    std::vector<Cluster> clusters;
+    clusters.reserve(clusterStarts.size());
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (size_t c = 0; c < clusterStarts.size(); ++c) {
+        uint32_t begin = clusterStarts[c];
+        uint32_t end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : static_cast<uint32_t>(triangleCount);
+
+        Cluster cluster{begin, end - begin, glm::vec3(0.0f), glm::vec3(0.0f), 0.0f};
+        float area = 0.0f;
+        for (uint32_t t = begin; t < end; ++t) {
+            const glm::vec3& p0 = vertices[indices[t * 3 + 0]].pos;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+            glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+            float faceArea = glm::length(faceNormal) * 0.5f;
+            cluster.centroid += (p0 + p1 + p2) * (faceArea / 3.0f);
+            cluster.normal += faceNormal;
+            area += faceArea;
+        }
+
+        meshCentroid += cluster.centroid;
+        meshArea += area;
+        if (area > 0.0f) {
+            cluster.centroid /= area;
+        }
+        float normalLength = glm::length(cluster.normal);
+        if (normalLength > 0.0f) {
+            cluster.normal /= normalLength;
+        }
+        clusters.push_back(cluster);
+    }
+
+    // Clusters that face away from the mesh centre are on the outside and tend to
+    // occlude the others, so they draw first.
+    if (meshArea > 0.0f) {
+        meshCentroid /= meshArea;
+    }
+    for (Cluster& cluster : clusters) {
+        cluster.sortKey = glm::dot(cluster.centroid - meshCentroid, cluster.normal);
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<uint32_t> sorted;
+    sorted.reserve(triangleCount * 3);
+    for (const Cluster& cluster : clusters) {
+        sorted.insert(sorted.end(), indices + cluster.firstTriangle * 3, indices + (cluster.firstTriangle + cluster.triangleCount) * 3);
+    }
+    std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+void mesh_optimizer::optimize_vertex_fetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    const uint32_t unassigned = UINT32_MAX;
+    std::vector<uint32_t> remap(vertices.size(), unassigned);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (uint32_t& index : indices) {
+        if (remap[index] == unassigned) {
+            remap[index] = static_cast<uint32_t>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(reordered);
+}
+
+std::pair<VertexCacheStats, VertexCacheStats> mesh_optimizer::optimize_mesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const std::vector<IndexRange>& ranges) {
+    VertexCacheStats before = analyze_vertex_cache(indices.data(), indices.size(), vertices.size());
+
+    for (const IndexRange& range : ranges) {
+        uint32_t* rangeIndices = indices.data() + range.firstIndex;
+        std::vector<uint32_t> clusters = optimize_vertex_cache(rangeIndices, range.indexCount, vertices.size());
+        optimize_overdraw(rangeIndices, range.indexCount, vertices, clusters);
+    }
+    optimize_vertex_fetch(vertices, indices);
+
+    VertexCacheStats after = analyze_vertex_cache(indices.data(), indices.size(), vertices.size());
+    return {before, after};
+}
+
+namespace {
+    // Symmetric 4x4 error matrix, upper triangle only.
+    struct Quadric {
+        double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+        double a11 = 0, a12 = 0, a13 = 0;
+        double a22 = 0, a23 = 0;
+        double a33 = 0;
+
+        void addPlane(const glm::vec3& n, double d) {
+            a00 += n.x * n.x; a01 += n.x * n.y; a02 += n.x * n.z; a03 += n.x * d;
+            a11 += n.y * n.y; a12 += n.y * n.z; a13 += n.y * d;
+            a22 += n.z * n.z; a23 += n.z * d;
+            a33 += d * d;
+        }
+
+        void add(const Quadric& o) {
+            a00 += o.a00; a01 += o.a01; a02 += o.a02; a03 += o.a03;
+            a11 += o.a11; a12 += o.a12; a13 += o.a13;
+            a22 += o.a22; a23 += o.a23;
+            a33 += o.a33;
+        }
+
+        // Sum of squared distances from p to the accumulated planes.
+        double evaluate(const glm::vec3& p) const {
+            double x = p.x, y = p.y, z = p.z;
+            return a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+                 + a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+                 + a22 * z * z + 2 * a23 * z
+                 + a33;
+        }
+    };
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+}
+
+static uint64_t edge_key(uint32_t a, uint32_t b) {
+    return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+}
+
+std::vector<uint32_t> mesh_optimizer::simplify(const std::vector<Vertex>& vertices, const uint32_t* indices, size_t indexCount, size_t targetIndexCount, float maxError, float* resultError) {
+    // Split vertices (normal or UV seams) are welded by position: the surface is simplified
+    // on positions and each corner re-picks one of the original vertices at the end.
+    std::map<std::array<float, 3>, uint32_t> positionIds;
+    std::unordered_map<uint32_t, uint32_t> positionOf;
+    std::vector<glm::vec3> positions;
+    std::vector<std::vector<uint32_t>> vertexAtPosition;
+
+    std::vector<uint32_t> corners(indexCount);
+    std::vector<uint32_t> attributes(indices, indices + indexCount);
+    for (size_t i = 0; i < indexCount; ++i) {
+        uint32_t v = indices[i];
+        auto known = positionOf.find(v);
+        if (known == positionOf.end()) {
+            const glm::vec3& p = vertices[v].pos;
+            auto inserted = positionIds.emplace(std::array<float, 3>{p.x, p.y, p.z}, static_cast<uint32_t>(positions.size()));
+            if (inserted.second) {
+                positions.push_back(p);
+                vertexAtPosition.emplace_back();
+            }
+            known = positionOf.emplace(v, inserted.first->second).first;
+            vertexAtPosition[known->second].push_back(v);
+        }
+        corners[i] = known->second;
+    }
+
+    size_t positionCount = positions.size();
+    std::vector<Quadric> quadrics(positionCount);
+    std::unordered_map<uint64_t, uint32_t> edgeUse;
+    for (size_t t = 0; t + 2 < indexCount; t += 3) {
+        const glm::vec3& p0 = positions[corners[t]];
+        glm::vec3 normal = glm::cross(positions[corners[t + 1]] - p0, positions[corners[t + 2]] - p0);
+        float length = glm::length(normal);
+        if (length > 0.0f) {
+            normal /= length;
+            double d = -glm::dot(normal, p0);
+            for (int k = 0; k < 3; ++k) {
+                quadrics[corners[t + k]].addPlane(normal, d);
+            }
+        }
+        for (int k = 0; k < 3; ++k) {
+            edgeUse[edge_key(corners[t + k], corners[t + (k + 1) % 3])]++;
+        }
+    }
+
+    // Border and non-manifold edges keep both endpoints in place.
+    std::vector<uint8_t> locked(positionCount, 0);
+    for (const auto& [key, uses] : edgeUse) {
+        if (uses != 2) {
+            locked[key >> 32] = 1;
+            locked[key & 0xffffffffu] = 1;
+        }
+    }
+
+    double maxCost = static_cast<double>(maxError) * maxError;
+    double reachedCost = 0.0;
+    size_t targetTriangles = targetIndexCount / 3;
+    std::vector<uint32_t> adjacencyOffset;
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> candidates;
+    std::vector<uint8_t> touched;
+
+    auto flips = [&](uint32_t from, uint32_t to) {
+        for (uint32_t a = adjacencyOffset[from]; a < adjacencyOffset[from + 1]; ++a) {
+            const uint32_t* tri = &corners[adjacency[a] * 3];
+            if (tri[0] == to || tri[1] == to || tri[2] == to) {
+                continue;
+            }
+            glm::vec3 before[3], after[3];
+            for (int k = 0; k < 3; ++k) {
+                before[k] = positions[tri[k]];
+                after[k] = tri[k] == from ? positions[to] : before[k];
+            }
+            glm::vec3 oldNormal = glm::cross(before[1] - before[0], before[2] - before[0]);
+            glm::vec3 newNormal = glm::cross(after[1] - after[0], after[2] - after[0]);
+            if (glm::dot(oldNormal, newNormal) <= 0.0f) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Each pass collapses the cheapest independent edges, then rebuilds the topology.
+    while (corners.size() / 3 > targetTriangles) {
+        size_t triangleCount = corners.size() / 3;
+
+        adjacencyOffset.assign(positionCount + 1, 0);
+        for (uint32_t p : corners) {
+            adjacencyOffset[p + 1]++;
+        }
+        for (size_t p = 0; p < positionCount; ++p) {
+            adjacencyOffset[p + 1] += adjacencyOffset[p];
+        }
+        adjacency.resize(corners.size());
+        std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+        for (size_t i = 0; i < corners.size(); ++i) {
+            adjacency[fill[corners[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        candidates.clear();
+        for (size_t t = 0; t < triangleCount; ++t) {
+            for (int k = 0; k < 3; ++k) {
+                uint32_t a = corners[t * 3 + k];
+                uint32_t b = corners[t * 3 + (k + 1) % 3];
+                if (a > b) {
+                    continue;
+                }
+                Quadric combined = quadrics[a];
+                combined.add(quadrics[b]);
+                double costToB = locked[a] ? -1.0 : std::max(0.0, combined.evaluate(positions[b]));
+                double costToA = locked[b] ? -1.0 : std::max(0.0, combined.evaluate(positions[a]));
+                if (costToB >= 0.0 && (costToA < 0.0 || costToB <= costToA)) {
+                    candidates.push_back({a, b, costToB});
+                } else if (costToA >= 0.0) {
+                    candidates.push_back({b, a, costToA});
+                }
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Collapse& x, const Collapse& y) {
+            return x.cost < y.cost;
+        });
+
+        // Every interior collapse removes two triangles.
+        size_t wanted = (triangleCount - targetTriangles + 1) / 2;
+        size_t performed = 0;
+        touched.assign(positionCount, 0);
+        for (const Collapse& collapse : candidates) {
+            if (performed >= wanted || collapse.cost > maxCost) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to] || flips(collapse.from, collapse.to)) {
+                continue;
+            }
+
+            for (uint32_t a = adjacencyOffset[collapse.from]; a < adjacencyOffset[collapse.from + 1]; ++a) {
+                for (int k = 0; k < 3; ++k) {
+                    touched[corners[adjacency[a] * 3 + k]] = 1;
+                }
+            }
+            for (uint32_t a = adjacencyOffset[collapse.from]; a < adjacencyOffset[collapse.from + 1]; ++a) {
+                for (int k = 0; k < 3; ++k) {
+                    uint32_t& corner = corners[adjacency[a] * 3 + k];
+                    if (corner == collapse.from) {
+                        corner = collapse.to;
+                    }
+                }
+            }
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            reachedCost = std::max(reachedCost, collapse.cost);
+            ++performed;
+        }
+        if (performed == 0) {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t t = 0; t < triangleCount; ++t) {
+            uint32_t a = corners[t * 3], b = corners[t * 3 + 1], c = corners[t * 3 + 2];
+            if (a == b || b == c || a == c) {
+                continue;
+            }
+            for (int k = 0; k < 3; ++k) {
+                corners[write * 3 + k] = corners[t * 3 + k];
+                attributes[write * 3 + k] = attributes[t * 3 + k];
+            }
+            ++write;
+        }
+        corners.resize(write * 3);
+        attributes.resize(write * 3);
+    }
+
+    // A corner whose position moved takes the vertex at its new position with the closest normal.
+    std::vector<uint32_t> result(corners.size());
+    for (size_t i = 0; i < corners.size(); ++i) {
+        uint32_t original = attributes[i];
+        if (positionOf[original] == corners[i]) {
+            result[i] = original;
+            continue;
+        }
+        const std::vector<uint32_t>& choices = vertexAtPosition[corners[i]];
+        uint32_t best = choices[0];
+        float bestDot = -2.0f;
+        for (uint32_t choice : choices) {
+            float d = glm::dot(vertices[choice].normal, vertices[original].normal);
+            if (d > bestDot) {
+                bestDot = d;
+                best = choice;
+            }
+        }
+        result[i] = best;
+    }
+
+    if (resultError) {
+        *resultError = static_cast<float>(std::sqrt(reachedCost));
+    }
+    return result;
+}
+
+std::vector<LodLevel> mesh_optimizer::build_lod_chain(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const std::vector<IndexRange>& ranges, uint32_t levelCount, float maxError) {
+    std::vector<LodLevel> levels;
+    uint32_t previousTriangles = 0;
+    for (const IndexRange& range : ranges) {
+        previousTriangles += range.indexCount / 3;
+    }
+
+    for (uint32_t level = 1; level <= levelCount; ++level) {
+        LodLevel lod;
+        std::vector<std::vector<uint32_t>> simplified;
+        for (const IndexRange& range : ranges) {
+            float error = 0.0f;
+            // Every level starts from the full-resolution range so errors do not compound.
+            simplified.push_back(simplify(vertices, indices.data() + range.firstIndex, range.indexCount, range.indexCount >> level, maxError, &error));
+            optimize_vertex_cache(simplified.back().data(), simplified.back().size(), vertices.size());
+            lod.triangleCount += static_cast<uint32_t>(simplified.back().size() / 3);
+            lod.error = std::max(lod.error, error);
+        }
+
+        if (lod.triangleCount * 5 > previousTriangles * 4) {
+            break;
+        }
+        for (const std::vector<uint32_t>& rangeIndices : simplified) {
+            lod.ranges.push_back({static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(rangeIndices.size())});
+            indices.insert(indices.end(), rangeIndices.begin(), rangeIndices.end());
+        }
+        previousTriangles = lod.triangleCount;
+        levels.push_back(std::move(lod));
+    }
+    return levels;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "mesh.h"
+
+// Average cache miss ratio (transformed vertices per triangle, 0.5-3) and average
+// transform to vertex ratio (1.0 is optimal) of an index buffer under a FIFO cache.
+struct VertexCacheStats {
+    float acmr = 0.0f;
+    float atvr = 0.0f;
+};
+
+// A contiguous triangle list inside a shared index buffer, such as a SubMesh.
+struct IndexRange {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+// One simplified level of a mesh: a copy of every source range, in the same order.
+struct LodLevel {
+    std::vector<IndexRange> ranges;
+    uint32_t triangleCount = 0;
+    // Largest surface deviation introduced, in object space units.
+    float error = 0.0f;
+};
+
+namespace mesh_optimizer {
+    const uint32_t DEFAULT_CACHE_SIZE = 16;
+
+    // Simulates a FIFO post-transform cache over the triangle list.
+    VertexCacheStats analyze_vertex_cache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+    // Reorders triangles in place for cache locality (Tipsify, Sander et al. 2007). Returns
+    // the triangle offsets where the traversal had to jump, which delimit clusters for
+    // optimize_overdraw.
+    std::vector<uint32_t> optimize_vertex_cache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+    // Reorders whole clusters so outward-facing ones draw first and occlude the rest,
+    // keeping each cluster's internal cache-friendly order.
+    void optimize_overdraw(uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& clusterStarts);
+
+    // Renumbers vertices in first-use order so fetches walk the vertex buffer forwards.
+    // Unreferenced vertices are dropped.
+    void optimize_vertex_fetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+    // Runs the cache and overdraw passes on every range, then the fetch pass on the whole
+    // mesh. Ranges keep their offsets and sizes. Returns the stats before and after.
+    std::pair<VertexCacheStats, VertexCacheStats> optimize_mesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const std::vector<IndexRange>& ranges);
+
+    // Collapses edges in order of quadric error (Garland & Heckbert 1997) until at most
+    // targetIndexCount indices remain or the next collapse would exceed maxError. Vertices
+    // only move onto existing ones, so the result indexes the same vertex buffer, and open
+    // borders stay fixed so neighbouring ranges do not crack. Writes the error reached to
+    // resultError when it is not null.
+    std::vector<uint32_t> simplify(const std::vector<Vertex>& vertices, const uint32_t* indices, size_t indexCount, size_t targetIndexCount, float maxError, float* resultError = nullptr);
+
+    // Appends up to levelCount simplified copies of ranges to indices, each aiming for half the
+    // triangles of the one before. Stops early once a level would not remove a fifth of the
+    // triangles or would exceed maxError.
+    std::vector<LodLevel> build_lod_chain(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const std::vector<IndexRange>& ranges, uint32_t levelCount, float maxError);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Work splitting shared by the load-time bakers (BC encoding, ambient occlusion).
+namespace parallel {
+    // threadCount, or every core when it is 0.
+    inline uint32_t resolve_thread_count(uint32_t threadCount) {
+        return threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Runs task(first, last) over [0, count) in chunks of chunkSize items, claimed one at a time
+    // by threadCount threads (0 uses every core). The calling thread is one of them.
+    template <typename Task>
+    void parallel_for(size_t count, size_t chunkSize, uint32_t threadCount, const Task& task) {
+        std::atomic<size_t> next{0};
+        auto worker = [&] {
+            for (size_t first = next.fetch_add(chunkSize); first < count; first = next.fetch_add(chunkSize)) {
+                task(first, std::min(first + chunkSize, count));
+            }
+        };
+        threadCount = resolve_thread_count(threadCount);
+        std::vector<std::thread> threads;
+        for (uint32_t i = 1; i < threadCount; ++i) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+}
@@ -0,0 +1,232 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PROFILER_HAS_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_HAS_RDTSC 1
+#else
+#define PROFILER_HAS_RDTSC 0
+#endif
+
+std::atomic<bool> profiler::g_enabled{false};
+
+namespace {
+    const size_t EVENTS_PER_THREAD = 1 << 16;
+
+    struct ZoneEvent {
+        const char* name;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    // One ring slot guarded by a sequence lock. sequence is 2 * index + 1 while event index is
+    // being written and 2 * index + 2 once it is complete, so a reader can tell both a torn
+    // copy and a slot that has moved on to a later lap.
+    struct EventSlot {
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint64_t> start{0};
+        std::atomic<uint64_t> end{0};
+    };
+
+    // Written only by its owning thread; head is published with release so the
+    // dumping thread knows which events exist.
+    struct ThreadBuffer {
+        std::unique_ptr<EventSlot[]> events{new EventSlot[EVENTS_PER_THREAD]};
+        std::atomic<uint64_t> head{0};
+        uint32_t threadId = 0;
+        std::string threadName;
+        bool gpu = false;
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        uint64_t originTicks = profiler::now_ticks();
+        std::chrono::steady_clock::time_point originTime = std::chrono::steady_clock::now();
+    };
+
+    Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    ThreadBuffer& thread_buffer() {
+        thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+            auto created = std::make_shared<ThreadBuffer>();
+            Registry& reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            created->threadId = static_cast<uint32_t>(reg.buffers.size() + 1);
+            created->threadName = "Thread " + std::to_string(created->threadId);
+            reg.buffers.push_back(created);
+            return created;
+        }();
+        return *buffer;
+    }
+
+    ThreadBuffer& gpu_buffer() {
+        static std::shared_ptr<ThreadBuffer> buffer = [] {
+            auto created = std::make_shared<ThreadBuffer>();
+            Registry& reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            created->threadId = static_cast<uint32_t>(reg.buffers.size() + 1);
+            created->threadName = "GPU";
+            created->gpu = true;
+            reg.buffers.push_back(created);
+            return created;
+        }();
+        return *buffer;
+    }
+
+    void push_event(ThreadBuffer& buffer, const char* name, uint64_t startTicks, uint64_t endTicks) {
+        uint64_t head = buffer.head.load(std::memory_order_relaxed);
+        EventSlot& slot = buffer.events[head % EVENTS_PER_THREAD];
+        slot.sequence.store(2 * head + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.start.store(startTicks, std::memory_order_relaxed);
+        slot.end.store(endTicks, std::memory_order_relaxed);
+        slot.sequence.store(2 * head + 2, std::memory_order_release);
+        buffer.head.store(head + 1, std::memory_order_release);
+    }
+
+    // Copies event index out of its slot; false if the owning thread overwrote it before or
+    // during the copy.
+    bool read_event(const ThreadBuffer& buffer, uint64_t index, ZoneEvent& event) {
+        const EventSlot& slot = buffer.events[index % EVENTS_PER_THREAD];
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != 2 * index + 2) {
+            return false;
+        }
+        event.name = slot.name.load(std::memory_order_relaxed);
+        event.start = slot.start.load(std::memory_order_relaxed);
+        event.end = slot.end.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.sequence.load(std::memory_order_relaxed) == sequence;
+    }
+
+    // Microseconds per tick, measured against steady_clock since the registry was created.
+    double ticks_to_microseconds() {
+#if PROFILER_HAS_RDTSC
+        Registry& reg = registry();
+        uint64_t ticks = profiler::now_ticks() - reg.originTicks;
+        double elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - reg.originTime).count();
+        return ticks > 0 ? elapsedUs / static_cast<double>(ticks) : 0.0;
+#else
+        return 0.001;
+#endif
+    }
+
+    void write_json_string(std::ofstream& out, const std::string& text) {
+        out << '"';
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                out << '\\';
+            }
+            out << c;
+        }
+        out << '"';
+    }
+}
+
+void profiler::set_enabled(bool enabled) {
+    registry();
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+uint64_t profiler::now_ticks() {
+#if PROFILER_HAS_RDTSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+void profiler::record_zone(const char* name, uint64_t startTicks, uint64_t endTicks) {
+    push_event(thread_buffer(), name, startTicks, endTicks);
+}
+
+void profiler::record_gpu_zone(const char* name, uint64_t anchorTicks, double offsetUs, double durationUs) {
+    double usPerTick = ticks_to_microseconds();
+    if (usPerTick <= 0.0) {
+        return;
+    }
+    uint64_t start = anchorTicks + static_cast<uint64_t>(offsetUs / usPerTick);
+    uint64_t end = start + static_cast<uint64_t>(durationUs / usPerTick);
+    push_event(gpu_buffer(), name, start, end);
+}
+
+void profiler::set_thread_name(const char* name) {
+    ThreadBuffer& buffer = thread_buffer();
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    buffer.threadName = name;
+}
+
+bool profiler::dump_chrome_trace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    Registry& reg = registry();
+    double usPerTick = ticks_to_microseconds();
+
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        buffers = reg.buffers;
+    }
+
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    auto separator = [&]() {
+        if (!first) {
+            out << ",\n";
+        }
+        first = false;
+    };
+
+    for (const auto& buffer : buffers) {
+        std::string threadName;
+        {
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            threadName = buffer->threadName;
+        }
+        separator();
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId << ",\"args\":{\"name\":";
+        write_json_string(out, threadName);
+        out << "}}";
+
+        // Events older than one ring length have been overwritten, and the owning thread keeps
+        // overwriting the oldest ones while we read; read_event drops those.
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t begin = head > EVENTS_PER_THREAD ? head - EVENTS_PER_THREAD : 0;
+        for (uint64_t i = begin; i < head; ++i) {
+            ZoneEvent event;
+            if (!read_event(*buffer, i, event) || event.name == nullptr || event.end < event.start || event.start < reg.originTicks) {
+                continue;
+            }
+            double startUs = (event.start - reg.originTicks) * usPerTick;
+            double durationUs = (event.end - event.start) * usPerTick;
+
+            separator();
+            out << "{\"name\":";
+            write_json_string(out, event.name);
+            out << ",\"cat\":" << (buffer->gpu ? "\"gpu\"" : "\"cpu\"") << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                << ",\"ts\":" << startUs << ",\"dur\":" << durationUs << "}";
+        }
+    }
+
+    out << "\n]}\n";
+    return out.good();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Lightweight CPU frame profiler. Zones are recorded into a per-thread ring buffer
+// that only its own thread writes, so recording never takes a lock. When the
+// profiler is disabled a zone costs one relaxed atomic load.
+namespace profiler {
+	extern std::atomic<bool> g_enabled;
+
+	inline bool is_enabled() {
+		return g_enabled.load(std::memory_order_relaxed);
+	}
+
+	// Turns recording on or off for every thread.
+	void set_enabled(bool enabled);
+
+	// Returns a raw timestamp: the TSC on x86, steady_clock nanoseconds elsewhere.
+	uint64_t now_ticks();
+
+	// Appends a completed zone to the calling thread's buffer. name must outlive the profiler.
+	void record_zone(const char* name, uint64_t startTicks, uint64_t endTicks);
+
+	// Appends a zone to the separate "GPU" track, placed offsetUs after anchorTicks (a now_ticks()
+	// value). Only one thread may record GPU zones.
+	void record_gpu_zone(const char* name, uint64_t anchorTicks, double offsetUs, double durationUs);
+
+	// Names the calling thread in the exported trace.
+	void set_thread_name(const char* name);
+
+	// Writes every buffered zone as Chrome trace_event JSON (chrome://tracing, Perfetto).
+	bool dump_chrome_trace(const std::string& path);
+
+	class ScopedZone {
+		public:
+		explicit ScopedZone(const char* name) : zoneName(name), start(is_enabled() ? now_ticks() : 0) {}
+		~ScopedZone() {
+			if (start != 0) {
+				record_zone(zoneName, start, now_ticks());
+			}
+		}
+
+		ScopedZone(const ScopedZone&) = delete;
+		ScopedZone& operator=(const ScopedZone&) = delete;
+
+		private:
+		const char* zoneName;
+		uint64_t start;
+	};
+}
+
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+// Profiles the rest of the enclosing scope under the given name.
+#define PROFILE_SCOPE(name) profiler::ScopedZone PROFILER_CONCAT(profilerZone_, __LINE__)(name)
+// Profiles the rest of the enclosing function under its own name.
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
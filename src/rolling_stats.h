@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Average and tail percentiles of a RollingStats window.
+struct StatsSummary {
+    float average = 0.0f;
+    float p50 = 0.0f;
+    float p95 = 0.0f;
+    float p99 = 0.0f;
+};
+
+// Fixed-size window over the most recent samples, with average and percentiles.
+class RollingStats {
+    public:
+
+    explicit RollingStats(size_t capacity = 240) : samples(std::max<size_t>(capacity, 1)) {}
+
+    // Adds a sample, evicting the oldest one once the window is full.
+    void add(float value) {
+        samples[next] = value;
+        next = (next + 1) % samples.size();
+        count = std::min(count + 1, samples.size());
+    }
+
+    // Forgets every sample.
+    void clear() {
+        next = 0;
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+
+    float average() const {
+        if (count == 0) {
+            return 0.0f;
+        }
+        double sum = 0.0;
+        for (size_t i = 0; i < count; ++i) {
+            sum += samples[i];
+        }
+        return static_cast<float>(sum / count);
+    }
+
+    // Returns the nearest-rank percentile, p in [0, 100].
+    float percentile(float p) const {
+        if (count == 0) {
+            return 0.0f;
+        }
+        sorted.assign(samples.begin(), samples.begin() + count);
+        size_t rank = static_cast<size_t>(p / 100.0f * (count - 1) + 0.5f);
+        rank = std::min(rank, count - 1);
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        return sorted[rank];
+    }
+
+    StatsSummary summarize() const {
+        return {average(), percentile(50.0f), percentile(95.0f), percentile(99.0f)};
+    }
+
+    private:
+
+    std::vector<float> samples;
+    mutable std::vector<float> sorted;
+    size_t next = 0;
+    size_t count = 0;
+};
@@ -0,0 +1,236 @@
+#include "settings.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+static uint32_t parse_uint(const std::string& option, const char* value, uint32_t minValue, uint32_t maxValue) {
+    unsigned long parsed = 0;
+    try {
+        size_t consumed = 0;
+        parsed = std::stoul(value, &consumed);
+        if (value[consumed] != '\0') {
+            throw std::invalid_argument(value);
+        }
+    } catch (const std::exception&) {
+        throw std::runtime_error(option + " expects an integer, got '" + value + "'.");
+    }
+
+    if (parsed < minValue || parsed > maxValue) {
+        throw std::runtime_error(option + " must be between " + std::to_string(minValue) + " and " + std::to_string(maxValue) + ".");
+    }
+    return static_cast<uint32_t>(parsed);
+}
+
+static float parse_float(const std::string& option, const char* value, float minValue, float maxValue) {
+    float parsed = 0.0f;
+    try {
+        size_t consumed = 0;
+        parsed = std::stof(value, &consumed);
+        if (value[consumed] != '\0') {
+            throw std::invalid_argument(value);
+        }
+    } catch (const std::exception&) {
+        throw std::runtime_error(option + " expects a number, got '" + value + "'.");
+    }
+
+    if (parsed < minValue || parsed > maxValue) {
+        throw std::runtime_error(option + " must be between " + std::to_string(minValue) + " and " + std::to_string(maxValue) + ".");
+    }
+    return parsed;
+}
+
+static CaptureFormat parse_capture_format(const std::string& value) {
+    if (value == "png") return CaptureFormat::PNG;
+    if (value == "raw") return CaptureFormat::Raw;
+    throw std::runtime_error("unknown capture format '" + value + "' (expected png or raw).");
+}
+
+static TextureFormat parse_bake_format(const std::string& value) {
+    if (value == "bc1") return TextureFormat::BC1;
+    if (value == "bc7") return TextureFormat::BC7;
+    throw std::runtime_error("unknown bake format '" + value + "' (expected bc1 or bc7).");
+}
+
+static VkPresentModeKHR parse_present_mode(const std::string& value) {
+    if (value == "immediate")    return VK_PRESENT_MODE_IMMEDIATE_KHR;
+    if (value == "mailbox")      return VK_PRESENT_MODE_MAILBOX_KHR;
+    if (value == "fifo")         return VK_PRESENT_MODE_FIFO_KHR;
+    if (value == "fifo_relaxed") return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+    throw std::runtime_error("unknown present mode '" + value + "' (expected immediate, mailbox, fifo or fifo_relaxed).");
+}
+
+RendererSettings settings::parse_command_line(int argc, char* argv[]) {
+    RendererSettings result;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+
+        auto next_value = [&]() -> const char* {
+            if (i + 1 >= argc) {
+                throw std::runtime_error(option + " expects a value.");
+            }
+            return argv[++i];
+        };
+
+        if (option == "--frames-in-flight") {
+            result.framesInFlight = parse_uint(option, next_value(), 1, 4);
+        } else if (option == "--swapchain-images") {
+            result.swapchainImages = parse_uint(option, next_value(), 1, 16);
+        } else if (option == "--present-mode") {
+            result.presentMode = parse_present_mode(next_value());
+        } else if (option == "--headless") {
+            result.headless = true;
+        } else if (option == "--width") {
+            result.width = parse_uint(option, next_value(), 1, 16384);
+        } else if (option == "--height") {
+            result.height = parse_uint(option, next_value(), 1, 16384);
+        } else if (option == "--targets") {
+            result.offscreenTargets = parse_uint(option, next_value(), 1, 8);
+        } else if (option == "--frames") {
+            result.frameCount = parse_uint(option, next_value(), 0, UINT32_MAX);
+        } else if (option == "--capture") {
+            result.captureDirectory = next_value();
+        } else if (option == "--capture-format") {
+            result.captureFormat = parse_capture_format(next_value());
+        } else if (option == "--capture-slots") {
+            result.captureSlots = parse_uint(option, next_value(), 1, 16);
+        } else if (option == "--capture-every") {
+            result.captureInterval = parse_uint(option, next_value(), 1, UINT32_MAX);
+        } else if (option == "--profile") {
+            result.profile = true;
+        } else if (option == "--profile-out") {
+            result.profile = true;
+            result.profileOutput = next_value();
+        } else if (option == "--bench") {
+            result.bench = true;
+        } else if (option == "--bench-script") {
+            result.bench = true;
+            result.benchScript = next_value();
+        } else if (option == "--bench-out") {
+            result.bench = true;
+            result.benchOutput = next_value();
+        } else if (option == "--bench-dt") {
+            result.benchTimestep = parse_float(option, next_value(), 0.0001f, 0.1f);
+        } else if (option == "--record") {
+            result.recordInput = next_value();
+        } else if (option == "--replay") {
+            result.replayInput = next_value();
+        } else if (option == "--packed-vertices") {
+            result.packedVertices = true;
+        } else if (option == "--no-mesh-optimize") {
+            result.optimizeMeshes = false;
+        } else if (option == "--lod-levels") {
+            result.lodLevels = parse_uint(option, next_value(), 0, 3);
+        } else if (option == "--lod-error") {
+            result.lodPixelError = parse_float(option, next_value(), 0.0f, 100.0f);
+        } else if (option == "--debug-draw") {
+            result.debugDraw = true;
+        } else if (option == "--no-static-batch") {
+            result.staticBatching = false;
+        } else if (option == "--ao-rays") {
+            result.aoRays = parse_uint(option, next_value(), 0, 4096);
+        } else if (option == "--lights") {
+            result.extraLights = parse_uint(option, next_value(), 0, 1023);
+        } else if (option == "--no-shadows") {
+            result.shadows = false;
+        } else if (option == "--no-shadow-cache") {
+            result.shadowCache = false;
+        } else if (option == "--ball-impostors") {
+            result.ballImpostors = true;
+        } else if (option == "--no-draw-sort") {
+            result.sortDraws = false;
+        } else if (option == "--texture-budget") {
+            result.textureBudgetMB = parse_uint(option, next_value(), 1, 65536);
+        } else if (option == "--texture") {
+            std::string assignment = next_value();
+            size_t separator = assignment.find('=');
+            if (separator == std::string::npos || separator == 0 || separator + 1 == assignment.size()) {
+                throw std::runtime_error("--texture expects MATERIAL=FILE, got '" + assignment + "'.");
+            }
+            result.materialTextures.emplace_back(assignment.substr(0, separator), assignment.substr(separator + 1));
+        } else if (option == "--no-baked-textures") {
+            result.loadBakedTextures = false;
+        } else if (option == "--bake") {
+            result.bakeTextures.push_back(next_value());
+        } else if (option == "--bake-format") {
+            result.bakeFormat = parse_bake_format(next_value());
+        } else if (option == "--transform-bench") {
+            result.transformBenchCount = parse_uint(option, next_value(), 1, 100000000);
+        } else if (option == "--help" || option == "-h") {
+            print_usage(argv[0]);
+            std::exit(EXIT_SUCCESS);
+        } else {
+            throw std::runtime_error("unknown option '" + option + "'. Use --help for the list of options.");
+        }
+    }
+
+    if (!result.replayInput.empty() && (result.bench || !result.recordInput.empty())) {
+        throw std::runtime_error("--replay cannot be combined with --bench or --record.");
+    }
+    if (result.bench && !result.recordInput.empty()) {
+        throw std::runtime_error("--record cannot be combined with --bench.");
+    }
+
+    // A replay runs to the end of its recording unless --frames cuts it short.
+    if (result.bench && result.frameCount == 0) {
+        result.frameCount = 600;
+    } else if (result.headless && result.replayInput.empty() && result.frameCount == 0) {
+        result.frameCount = 60;
+    }
+
+    return result;
+}
+
+void settings::print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --frames-in-flight N      Frames recorded ahead of the GPU, 1-4 (default 2)\n"
+              << "  --swapchain-images N      Swap chain image count (default: surface minimum + 1)\n"
+              << "  --present-mode MODE       immediate | mailbox | fifo | fifo_relaxed (default mailbox)\n"
+              << "  --headless                Render offscreen without a window or swap chain\n"
+              << "  --width W, --height H     Window or offscreen target size (default 800x600)\n"
+              << "  --targets N               Offscreen targets rendered round-robin, 1-8 (default 3)\n"
+              << "  --frames N                Exit after N frames (default: headless 60, windowed never)\n"
+              << "  --capture DIR             Write rendered frames into DIR without stalling the frame loop\n"
+              << "  --capture-format FORMAT   png | raw (default png)\n"
+              << "  --capture-slots N         Readback buffers in flight, 1-16 (default 4)\n"
+              << "  --capture-every N         Capture every Nth frame (default 1)\n"
+              << "  --profile                 Record CPU profiler zones (F12 dumps a Chrome trace)\n"
+              << "  --profile-out FILE        Trace file written on F12 and at exit (implies --profile)\n"
+              << "  --bench                   Run the scripted benchmark at a fixed timestep (default 600 frames)\n"
+              << "  --bench-script FILE       Benchmark timeline (implies --bench; default: built-in script)\n"
+              << "  --bench-out FILE          Benchmark results JSON (implies --bench; default bench_results.json)\n"
+              << "  --bench-dt SECONDS        Simulated time per benchmark frame (default 1/60)\n"
+              << "  --record FILE             Record per-tick key states and timesteps into FILE\n"
+              << "  --replay FILE             Replay a recording instead of the keyboard\n"
+              << "  --packed-vertices         Use 16-byte quantized vertices instead of 32-byte floats\n"
+              << "  --no-mesh-optimize        Keep the index and vertex order of the OBJ files\n"
+              << "  --lod-levels N            Simplified LODs generated per mesh, 0-3 (default 3)\n"
+              << "  --lod-error PIXELS        Screen-space error allowed when picking a LOD (default 1)\n"
+              << "  --debug-draw              Draw axes, table bounds, light range and ball trails as lines\n"
+              << "  --no-static-batch         Draw static objects with their own meshes instead of one merged batch\n"
+              << "  --ao-rays N               Rays per vertex for the static batch's baked ambient occlusion, 0-4096 (default 64)\n"
+              << "  --lights N                Add N moving point lights over the table, 0-1023 (default 0)\n"
+              << "  --no-shadows              Disable the lamp's shadow map\n"
+              << "  --no-shadow-cache         Re-render every shadow caster every frame\n"
+              << "  --ball-impostors          Draw the balls as ray-traced sphere impostors\n"
+              << "  --no-draw-sort            Submit draws in scene order instead of sorting them by state\n"
+              << "  --texture-budget MB       GPU memory for resident textures (default 256)\n"
+              << "  --texture MATERIAL=FILE   Sample FILE as MATERIAL's diffuse texture (repeatable)\n"
+              << "  --no-baked-textures       Decode source images even when a baked .btx file exists\n"
+              << "  --bake FILE               Bake FILE into a block-compressed .btx next to it and exit (repeatable)\n"
+              << "  --bake-format FORMAT      bc1 | bc7 (default bc7)\n"
+              << "  --transform-bench N       Benchmark batched transform composition for N objects and exit\n"
+              << "  --help                    Show this message" << std::endl;
+}
+
+const char* settings::present_mode_name(VkPresentModeKHR mode) {
+    switch (mode) {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:    return "immediate";
+        case VK_PRESENT_MODE_MAILBOX_KHR:      return "mailbox";
+        case VK_PRESENT_MODE_FIFO_KHR:         return "fifo";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo_relaxed";
+        default:                               return "unknown";
+    }
+}
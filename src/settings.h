@@ -0,0 +1,104 @@
+#pragma once
+
+#include "vk_types.h"
+#include "frame_capture.h"
+#include "texture_compress.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct RendererSettings {
+	// Number of frames the CPU may record ahead of the GPU (1-4).
+	uint32_t framesInFlight = 2;
+	// Requested swap chain image count; 0 means minImageCount + 1.
+	uint32_t swapchainImages = 0;
+	// Preferred present mode; falls back to FIFO when the surface lacks it.
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+
+	// Renders into offscreen images instead of a window; needs neither a surface nor VK_KHR_swapchain.
+	bool headless = false;
+	// Size of the window or of the offscreen targets.
+	uint32_t width = 800;
+	uint32_t height = 600;
+	// Number of offscreen color targets rendered round-robin in headless mode.
+	uint32_t offscreenTargets = 3;
+	// Frames to render before exiting; 0 runs until the window is closed.
+	uint32_t frameCount = 0;
+
+	// Directory rendered frames are written to; empty disables capture.
+	std::string captureDirectory;
+	CaptureFormat captureFormat = CaptureFormat::PNG;
+	// Number of host-visible readback buffers in the capture ring.
+	uint32_t captureSlots = 4;
+	// Capture every Nth rendered frame.
+	uint32_t captureInterval = 1;
+
+	// Records CPU profiler zones from startup.
+	bool profile = false;
+	// Chrome trace written on F12 and at exit when profiling.
+	std::string profileOutput = "profile_trace.json";
+
+	// Runs the scripted benchmark serially at a fixed timestep instead of the interactive loop.
+	bool bench = false;
+	// Timeline file; empty uses the built-in script.
+	std::string benchScript;
+	// JSON results file.
+	std::string benchOutput = "bench_results.json";
+	// Simulated seconds per benchmark frame.
+	float benchTimestep = 1.0f / 60.0f;
+
+	// Records every simulation tick's key states and timestep into this file.
+	std::string recordInput;
+	// Replays a recording instead of reading the keyboard.
+	std::string replayInput;
+
+	// Bakes meshes into the 16-byte PackedVertex layout and uses the matching pipeline variant.
+	bool packedVertices = false;
+	// Reorders each mesh's triangles and vertices for the post-transform cache at load time.
+	bool optimizeMeshes = true;
+	// Simplified levels generated per mesh at load (0-3); 0 always draws full resolution.
+	uint32_t lodLevels = 3;
+	// Screen-space error in pixels a LOD may introduce before a finer one is drawn.
+	float lodPixelError = 1.0f;
+	// Draws world axes, table bounds, light range and ball bounds and trails as lines.
+	bool debugDraw = false;
+	// Merges the static renderables into one world-space mesh at load, one draw per material.
+	bool staticBatching = true;
+	// Rays per vertex when baking the static batch's ambient occlusion at load; 0 skips the bake.
+	uint32_t aoRays = 64;
+	// Moving point lights added over the table on top of the lamp, each culled into light clusters.
+	uint32_t extraLights = 0;
+	// Shadows from the lamp, and whether their static and dynamic layers are cached between frames.
+	bool shadows = true;
+	bool shadowCache = true;
+	// Draws the balls as ray-traced sphere quads with baked markings instead of triangle meshes.
+	bool ballImpostors = false;
+	// Radix-sorts each frame's draws by pipeline, mesh, material and depth; off keeps scene order.
+	bool sortDraws = true;
+
+	// GPU memory the texture cache may keep resident before evicting least recently used textures.
+	uint32_t textureBudgetMB = 256;
+	// Material name and image file pairs that override or add a material's diffuse texture.
+	std::vector<std::pair<std::string, std::string>> materialTextures;
+	// Loads a baked .btx file next to a requested image instead of decoding the image.
+	bool loadBakedTextures = true;
+
+	// When non-empty, bakes these images into .btx files of bakeFormat and exits.
+	std::vector<std::string> bakeTextures;
+	TextureFormat bakeFormat = TextureFormat::BC7;
+
+	// When non-zero, benchmarks transform composition for this many objects and exits.
+	uint32_t transformBenchCount = 0;
+};
+
+namespace settings {
+	// Parses the command line into renderer settings. Throws on malformed arguments.
+	RendererSettings parse_command_line(int argc, char* argv[]);
+
+	// Prints the supported command line options.
+	void print_usage(const char* program);
+
+	// Returns a readable name for a present mode.
+	const char* present_mode_name(VkPresentModeKHR mode);
+}
@@ -0,0 +1,700 @@
+#include "texture_compress.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include <stb_image.h>
+
+#include "parallel_for.h"
+
+static const uint8_t FILE_IDENTIFIER[12] = {0xAB, 'B', 'T', 'X', ' ', '1', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+static const uint32_t MAX_FILE_LEVELS = 16;
+
+// Levels in a full mip chain down to 1x1, floor(log2(max(width, height))) + 1.
+static uint32_t full_level_count(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1) {
+        levels++;
+    }
+    return levels;
+}
+
+struct FileHeader {
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+};
+
+struct FileLevel {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+};
+
+// BC7 4-bit index interpolation weights, out of 64.
+static const int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+static size_t block_bytes(TextureFormat format) {
+    return format == TextureFormat::BC1 ? 8 : 16;
+}
+
+static uint64_t level_size(TextureFormat format, uint32_t width, uint32_t height) {
+    if (format == TextureFormat::RGBA8) {
+        return uint64_t(width) * height * 4;
+    }
+    return uint64_t((width + 3) / 4) * ((height + 3) / 4) * block_bytes(format);
+}
+
+static const std::array<float, 256>& srgb_to_linear_table() {
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> values{};
+        for (int i = 0; i < 256; ++i) {
+            float c = i / 255.0f;
+            values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return values;
+    }();
+    return table;
+}
+
+static uint8_t linear_to_srgb(float linear) {
+    float c = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+}
+
+// Copies the 4x4 block at (blockX, blockY), repeating the last row and column past the edges.
+static void load_block(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, uint8_t block[64]) {
+    for (uint32_t y = 0; y < 4; ++y) {
+        uint32_t sourceY = std::min(blockY * 4 + y, height - 1);
+        for (uint32_t x = 0; x < 4; ++x) {
+            uint32_t sourceX = std::min(blockX * 4 + x, width - 1);
+            memcpy(block + (y * 4 + x) * 4, pixels + (size_t(sourceY) * width + sourceX) * 4, 4);
+        }
+    }
+}
+
+static void store_block(const uint8_t block[64], uint8_t* pixels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY) {
+    for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; ++y) {
+        for (uint32_t x = 0; x < 4 && blockX * 4 + x < width; ++x) {
+            memcpy(pixels + (size_t(blockY * 4 + y) * width + blockX * 4 + x) * 4, block + (y * 4 + x) * 4, 4);
+        }
+    }
+}
+
+// Finds the principal axis of the first N channels of the block. Endpoints are placed on
+// it at the extreme projections.
+template <int N>
+static void fit_principal_axis(const uint8_t block[64], float low[N], float high[N]) {
+    float mean[N] = {};
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < N; ++c) {
+            mean[c] += block[i * 4 + c];
+        }
+    }
+    for (int c = 0; c < N; ++c) {
+        mean[c] /= 16.0f;
+    }
+
+    float covariance[N][N] = {};
+    for (int i = 0; i < 16; ++i) {
+        for (int a = 0; a < N; ++a) {
+            for (int b = 0; b < N; ++b) {
+                covariance[a][b] += (block[i * 4 + a] - mean[a]) * (block[i * 4 + b] - mean[b]);
+            }
+        }
+    }
+
+    float axis[N];
+    for (int c = 0; c < N; ++c) {
+        axis[c] = 1.0f;
+    }
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        float next[N] = {};
+        float largest = 0.0f;
+        for (int a = 0; a < N; ++a) {
+            for (int b = 0; b < N; ++b) {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            largest = std::max(largest, std::fabs(next[a]));
+        }
+        if (largest == 0.0f) {
+            break;
+        }
+        for (int c = 0; c < N; ++c) {
+            axis[c] = next[c] / largest;
+        }
+    }
+
+    float length = 0.0f;
+    for (int c = 0; c < N; ++c) {
+        length += axis[c] * axis[c];
+    }
+    length = std::sqrt(length);
+    for (int c = 0; c < N; ++c) {
+        axis[c] /= length;
+    }
+
+    float minProjection = 0.0f, maxProjection = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        float projection = 0.0f;
+        for (int c = 0; c < N; ++c) {
+            projection += (block[i * 4 + c] - mean[c]) * axis[c];
+        }
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+    for (int c = 0; c < N; ++c) {
+        low[c] = std::clamp(mean[c] + axis[c] * minProjection, 0.0f, 255.0f);
+        high[c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.0f, 255.0f);
+    }
+}
+
+// Solves for the two endpoints that best reproduce the block given each texel's weight of
+// the second endpoint. Returns false when all texels use the same weight.
+template <int N>
+static bool fit_least_squares(const uint8_t block[64], const float weights[16], float low[N], float high[N]) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[N] = {}, bx[N] = {};
+    for (int i = 0; i < 16; ++i) {
+        float b = weights[i];
+        float a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < N; ++c) {
+            ax[c] += a * block[i * 4 + c];
+            bx[c] += b * block[i * 4 + c];
+        }
+    }
+    float determinant = aa * bb - ab * ab;
+    if (std::fabs(determinant) < 1e-6f) {
+        return false;
+    }
+    for (int c = 0; c < N; ++c) {
+        low[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+        high[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+static uint16_t pack_565(const float color[3]) {
+    uint16_t r = static_cast<uint16_t>(std::lround(color[0] * 31.0f / 255.0f));
+    uint16_t g = static_cast<uint16_t>(std::lround(color[1] * 63.0f / 255.0f));
+    uint16_t b = static_cast<uint16_t>(std::lround(color[2] * 31.0f / 255.0f));
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void unpack_565(uint16_t packed, int color[3]) {
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+static void bc1_palette(uint16_t color0, uint16_t color1, bool fourColor, int palette[4][3]) {
+    unpack_565(color0, palette[0]);
+    unpack_565(color1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+        if (fourColor) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+}
+
+// Picks the nearest four-color palette entry per texel and returns the squared error. The
+// endpoints may still be in either order; encode_bc1 swaps them before writing the block.
+static int bc1_assign(const uint8_t block[64], uint16_t color0, uint16_t color1, uint8_t indices[16]) {
+    int palette[4][3];
+    bc1_palette(color0, color1, true, palette);
+    int total = 0;
+    for (int i = 0; i < 16; ++i) {
+        int best = INT32_MAX;
+        for (int p = 0; p < 4; ++p) {
+            int dr = block[i * 4] - palette[p][0], dg = block[i * 4 + 1] - palette[p][1], db = block[i * 4 + 2] - palette[p][2];
+            int error = dr * dr + dg * dg + db * db;
+            if (error < best) {
+                best = error;
+                indices[i] = static_cast<uint8_t>(p);
+            }
+        }
+        total += best;
+    }
+    return total;
+}
+
+// Opaque four-color BC1: principal axis endpoints refined by least squares.
+static void encode_bc1(const uint8_t block[64], uint8_t* out) {
+    static const float INDEX_WEIGHTS[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+    float low[3], high[3];
+    fit_principal_axis<3>(block, low, high);
+    uint16_t bestColor0 = pack_565(high), bestColor1 = pack_565(low);
+    uint8_t bestIndices[16];
+    int bestError = bc1_assign(block, bestColor0, bestColor1, bestIndices);
+
+    for (int iteration = 0; iteration < 2 && bestError > 0; ++iteration) {
+        float weights[16];
+        for (int i = 0; i < 16; ++i) {
+            weights[i] = INDEX_WEIGHTS[bestIndices[i]];
+        }
+        if (!fit_least_squares<3>(block, weights, high, low)) {
+            break;
+        }
+        uint16_t color0 = pack_565(high), color1 = pack_565(low);
+        uint8_t indices[16];
+        int error = bc1_assign(block, color0, color1, indices);
+        if (error >= bestError) {
+            break;
+        }
+        bestError = error;
+        bestColor0 = color0;
+        bestColor1 = color1;
+        memcpy(bestIndices, indices, sizeof(indices));
+    }
+
+    // color0 > color1 selects the four-color mode.
+    if (bestColor0 < bestColor1) {
+        std::swap(bestColor0, bestColor1);
+        for (uint8_t& index : bestIndices) {
+            index ^= 1;
+        }
+    } else if (bestColor0 == bestColor1) {
+        memset(bestIndices, 0, sizeof(bestIndices));
+    }
+
+    uint32_t packedIndices = 0;
+    for (int i = 0; i < 16; ++i) {
+        packedIndices |= uint32_t(bestIndices[i]) << (i * 2);
+    }
+    memcpy(out, &bestColor0, 2);
+    memcpy(out + 2, &bestColor1, 2);
+    memcpy(out + 4, &packedIndices, 4);
+}
+
+static void decode_bc1(const uint8_t* in, uint8_t block[64]) {
+    uint16_t color0, color1;
+    uint32_t indices;
+    memcpy(&color0, in, 2);
+    memcpy(&color1, in + 2, 2);
+    memcpy(&indices, in + 4, 4);
+    int palette[4][3];
+    bc1_palette(color0, color1, color0 > color1, palette);
+    for (int i = 0; i < 16; ++i) {
+        uint32_t index = (indices >> (i * 2)) & 3;
+        for (int c = 0; c < 3; ++c) {
+            block[i * 4 + c] = static_cast<uint8_t>(palette[index][c]);
+        }
+        block[i * 4 + 3] = (color0 <= color1 && index == 3) ? 0 : 255;
+    }
+}
+
+// A BC7 mode 6 endpoint: 7 bits per channel plus a shared low bit.
+struct Bc7Endpoint {
+    uint8_t channels[4];
+    uint8_t pBit;
+
+    int value(int channel) const { return (channels[channel] << 1) | pBit; }
+};
+
+static Bc7Endpoint quantize_bc7(const float color[4]) {
+    Bc7Endpoint best{};
+    float bestError = INFINITY;
+    for (uint8_t pBit = 0; pBit < 2; ++pBit) {
+        Bc7Endpoint candidate{};
+        candidate.pBit = pBit;
+        float error = 0.0f;
+        for (int c = 0; c < 4; ++c) {
+            candidate.channels[c] = static_cast<uint8_t>(std::clamp(std::lround((color[c] - pBit) / 2.0f), 0L, 127L));
+            float difference = candidate.value(c) - color[c];
+            error += difference * difference;
+        }
+        if (error < bestError) {
+            bestError = error;
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+static int bc7_assign(const uint8_t block[64], const Bc7Endpoint& low, const Bc7Endpoint& high, uint8_t indices[16]) {
+    int palette[16][4];
+    for (int p = 0; p < 16; ++p) {
+        for (int c = 0; c < 4; ++c) {
+            palette[p][c] = ((64 - BC7_WEIGHTS[p]) * low.value(c) + BC7_WEIGHTS[p] * high.value(c) + 32) >> 6;
+        }
+    }
+    int total = 0;
+    for (int i = 0; i < 16; ++i) {
+        int best = INT32_MAX;
+        for (int p = 0; p < 16; ++p) {
+            int error = 0;
+            for (int c = 0; c < 4; ++c) {
+                int difference = block[i * 4 + c] - palette[p][c];
+                error += difference * difference;
+            }
+            if (error < best) {
+                best = error;
+                indices[i] = static_cast<uint8_t>(p);
+            }
+        }
+        total += best;
+    }
+    return total;
+}
+
+struct BitWriter {
+    uint8_t* bytes;
+    uint32_t position = 0;
+
+    void write(uint32_t value, uint32_t count) {
+        for (uint32_t i = 0; i < count; ++i, ++position) {
+            bytes[position / 8] |= static_cast<uint8_t>(((value >> i) & 1) << (position % 8));
+        }
+    }
+};
+
+struct BitReader {
+    const uint8_t* bytes;
+    uint32_t position = 0;
+
+    uint32_t read(uint32_t count) {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < count; ++i, ++position) {
+            value |= uint32_t((bytes[position / 8] >> (position % 8)) & 1) << i;
+        }
+        return value;
+    }
+};
+
+// BC7 mode 6: one subset, RGBA endpoints and 4-bit indices. It handles smooth color and
+// alpha well and needs no partition search, which keeps baking fast.
+static void encode_bc7(const uint8_t block[64], uint8_t* out) {
+    float low[4], high[4];
+    fit_principal_axis<4>(block, low, high);
+    Bc7Endpoint bestLow = quantize_bc7(low), bestHigh = quantize_bc7(high);
+    uint8_t bestIndices[16];
+    int bestError = bc7_assign(block, bestLow, bestHigh, bestIndices);
+
+    for (int iteration = 0; iteration < 2 && bestError > 0; ++iteration) {
+        float weights[16];
+        for (int i = 0; i < 16; ++i) {
+            weights[i] = BC7_WEIGHTS[bestIndices[i]] / 64.0f;
+        }
+        if (!fit_least_squares<4>(block, weights, low, high)) {
+            break;
+        }
+        Bc7Endpoint candidateLow = quantize_bc7(low), candidateHigh = quantize_bc7(high);
+        uint8_t indices[16];
+        int error = bc7_assign(block, candidateLow, candidateHigh, indices);
+        if (error >= bestError) {
+            break;
+        }
+        bestError = error;
+        bestLow = candidateLow;
+        bestHigh = candidateHigh;
+        memcpy(bestIndices, indices, sizeof(indices));
+    }
+
+    // The first texel's index is stored without its top bit, so it must be below 8. The
+    // weights are symmetric, which makes swapping the endpoints lossless.
+    if (bestIndices[0] >= 8) {
+        std::swap(bestLow, bestHigh);
+        for (uint8_t& index : bestIndices) {
+            index = static_cast<uint8_t>(15 - index);
+        }
+    }
+
+    memset(out, 0, 16);
+    BitWriter writer{out};
+    writer.write(1u << 6, 7);
+    for (int c = 0; c < 4; ++c) {
+        writer.write(bestLow.channels[c], 7);
+        writer.write(bestHigh.channels[c], 7);
+    }
+    writer.write(bestLow.pBit, 1);
+    writer.write(bestHigh.pBit, 1);
+    writer.write(bestIndices[0], 3);
+    for (int i = 1; i < 16; ++i) {
+        writer.write(bestIndices[i], 4);
+    }
+}
+
+// Decodes the mode 6 blocks encode_bc7 writes; other modes never appear in baked files.
+static void decode_bc7(const uint8_t* in, uint8_t block[64]) {
+    BitReader reader{in};
+    if (reader.read(7) != (1u << 6)) {
+        throw std::runtime_error("failed to decode BC7 block: only mode 6 is supported.");
+    }
+    Bc7Endpoint low{}, high{};
+    for (int c = 0; c < 4; ++c) {
+        low.channels[c] = static_cast<uint8_t>(reader.read(7));
+        high.channels[c] = static_cast<uint8_t>(reader.read(7));
+    }
+    low.pBit = static_cast<uint8_t>(reader.read(1));
+    high.pBit = static_cast<uint8_t>(reader.read(1));
+    for (int i = 0; i < 16; ++i) {
+        int weight = BC7_WEIGHTS[reader.read(i == 0 ? 3 : 4)];
+        for (int c = 0; c < 4; ++c) {
+            block[i * 4 + c] = static_cast<uint8_t>(((64 - weight) * low.value(c) + weight * high.value(c) + 32) >> 6);
+        }
+    }
+}
+
+// Block rows claimed by an encoder thread at a time.
+static const size_t ROW_CHUNK = 16;
+
+const char* texture_compress::format_name(TextureFormat format) {
+    switch (format) {
+        case TextureFormat::RGBA8: return "RGBA8";
+        case TextureFormat::BC1:   return "BC1";
+        case TextureFormat::BC7:   return "BC7";
+        default:                   return "unknown";
+    }
+}
+
+TextureImage texture_compress::from_pixels(const uint8_t* rgba, uint32_t width, uint32_t height) {
+    TextureImage image;
+    image.width = width;
+    image.height = height;
+    image.data.assign(rgba, rgba + level_size(TextureFormat::RGBA8, width, height));
+    image.mips.push_back({width, height, 0, image.data.size()});
+    return image;
+}
+
+TextureImage texture_compress::generate_mips(const TextureImage& image) {
+    if (image.format != TextureFormat::RGBA8 || image.mips.empty()) {
+        throw std::runtime_error("failed to generate mips: the image is not RGBA8.");
+    }
+    const std::array<float, 256>& toLinear = srgb_to_linear_table();
+
+    TextureImage result = from_pixels(image.data.data(), image.width, image.height);
+    uint32_t width = image.width, height = image.height;
+    while (width > 1 || height > 1) {
+        const TextureMip source = result.mips.back();
+        uint32_t mipWidth = std::max(width / 2, 1u), mipHeight = std::max(height / 2, 1u);
+        TextureMip mip{mipWidth, mipHeight, result.data.size(), level_size(TextureFormat::RGBA8, mipWidth, mipHeight)};
+        result.data.resize(result.data.size() + mip.size);
+
+        const uint8_t* src = result.data.data() + source.offset;
+        uint8_t* dst = result.data.data() + mip.offset;
+        for (uint32_t y = 0; y < mipHeight; ++y) {
+            uint32_t y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+            for (uint32_t x = 0; x < mipWidth; ++x) {
+                uint32_t x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+                const uint8_t* texels[4] = {src + (size_t(y0) * width + x0) * 4, src + (size_t(y0) * width + x1) * 4,
+                                            src + (size_t(y1) * width + x0) * 4, src + (size_t(y1) * width + x1) * 4};
+                uint8_t* out = dst + (size_t(y) * mipWidth + x) * 4;
+                for (int c = 0; c < 3; ++c) {
+                    float sum = toLinear[texels[0][c]] + toLinear[texels[1][c]] + toLinear[texels[2][c]] + toLinear[texels[3][c]];
+                    out[c] = linear_to_srgb(sum * 0.25f);
+                }
+                out[3] = static_cast<uint8_t>((texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3] + 2) / 4);
+            }
+        }
+
+        result.mips.push_back(mip);
+        width = mipWidth;
+        height = mipHeight;
+    }
+    return result;
+}
+
+TextureImage texture_compress::compress(const TextureImage& image, TextureFormat format, uint32_t threadCount) {
+    if (image.format != TextureFormat::RGBA8) {
+        throw std::runtime_error("failed to compress texture: the image is already compressed.");
+    }
+    if (format == TextureFormat::RGBA8) {
+        return image;
+    }
+
+    TextureImage result;
+    result.format = format;
+    result.width = image.width;
+    result.height = image.height;
+
+    // Every block row of every level is one work item.
+    struct BlockRow {
+        size_t mip;
+        uint32_t row;
+    };
+    std::vector<BlockRow> rows;
+    for (size_t m = 0; m < image.mips.size(); ++m) {
+        const TextureMip& source = image.mips[m];
+        result.mips.push_back({source.width, source.height, result.data.size(), level_size(format, source.width, source.height)});
+        result.data.resize(result.data.size() + result.mips.back().size);
+        for (uint32_t row = 0; row < (source.height + 3) / 4; ++row) {
+            rows.push_back({m, row});
+        }
+    }
+
+    const size_t blockSize = block_bytes(format);
+    parallel::parallel_for(rows.size(), ROW_CHUNK, threadCount, [&](size_t first, size_t last) {
+        uint8_t block[64];
+        for (size_t r = first; r < last; ++r) {
+            const TextureMip& source = image.mips[rows[r].mip];
+            const TextureMip& target = result.mips[rows[r].mip];
+            uint32_t blocksWide = (source.width + 3) / 4;
+            uint8_t* out = result.data.data() + target.offset + size_t(rows[r].row) * blocksWide * blockSize;
+            for (uint32_t blockX = 0; blockX < blocksWide; ++blockX, out += blockSize) {
+                load_block(image.data.data() + source.offset, source.width, source.height, blockX, rows[r].row, block);
+                if (format == TextureFormat::BC1) {
+                    encode_bc1(block, out);
+                } else {
+                    encode_bc7(block, out);
+                }
+            }
+        }
+    });
+    return result;
+}
+
+TextureImage texture_compress::decompress(const TextureImage& image) {
+    if (image.format == TextureFormat::RGBA8) {
+        return image;
+    }
+
+    TextureImage result;
+    result.width = image.width;
+    result.height = image.height;
+    const size_t blockSize = block_bytes(image.format);
+    uint8_t block[64];
+    for (const TextureMip& source : image.mips) {
+        TextureMip mip{source.width, source.height, result.data.size(), level_size(TextureFormat::RGBA8, source.width, source.height)};
+        result.data.resize(result.data.size() + mip.size);
+        const uint8_t* in = image.data.data() + source.offset;
+        for (uint32_t blockY = 0; blockY < (source.height + 3) / 4; ++blockY) {
+            for (uint32_t blockX = 0; blockX < (source.width + 3) / 4; ++blockX, in += blockSize) {
+                if (image.format == TextureFormat::BC1) {
+                    decode_bc1(in, block);
+                } else {
+                    decode_bc7(in, block);
+                }
+                store_block(block, result.data.data() + mip.offset, source.width, source.height, blockX, blockY);
+            }
+        }
+        result.mips.push_back(mip);
+    }
+    return result;
+}
+
+void texture_compress::write_file(const std::string& path, const TextureImage& image) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("failed to open " + path + " for writing.");
+    }
+
+    FileHeader header{static_cast<uint32_t>(image.format), image.width, image.height, static_cast<uint32_t>(image.mips.size())};
+    uint64_t dataStart = sizeof(FILE_IDENTIFIER) + sizeof(header) + sizeof(FileLevel) * image.mips.size();
+    file.write(reinterpret_cast<const char*>(FILE_IDENTIFIER), sizeof(FILE_IDENTIFIER));
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const TextureMip& mip : image.mips) {
+        FileLevel level{dataStart + mip.offset, mip.size};
+        file.write(reinterpret_cast<const char*>(&level), sizeof(level));
+    }
+    file.write(reinterpret_cast<const char*>(image.data.data()), static_cast<std::streamsize>(image.data.size()));
+    if (!file) {
+        throw std::runtime_error("failed to write " + path + ".");
+    }
+}
+
+TextureImage texture_compress::read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("failed to open " + path + ".");
+    }
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    uint8_t identifier[sizeof(FILE_IDENTIFIER)];
+    FileHeader header{};
+    file.read(reinterpret_cast<char*>(identifier), sizeof(identifier));
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || memcmp(identifier, FILE_IDENTIFIER, sizeof(identifier)) != 0) {
+        throw std::runtime_error(path + " is not a baked texture.");
+    }
+    if (header.format > static_cast<uint32_t>(TextureFormat::BC7) || header.width == 0 || header.height == 0 ||
+        header.levelCount == 0 || header.levelCount > MAX_FILE_LEVELS || header.levelCount > full_level_count(header.width, header.height)) {
+        throw std::runtime_error(path + " has a malformed header.");
+    }
+
+    TextureImage image;
+    image.format = static_cast<TextureFormat>(header.format);
+    image.width = header.width;
+    image.height = header.height;
+    std::vector<FileLevel> levels(header.levelCount);
+    file.read(reinterpret_cast<char*>(levels.data()), static_cast<std::streamsize>(sizeof(FileLevel) * levels.size()));
+
+    for (uint32_t i = 0; i < header.levelCount; ++i) {
+        uint32_t width = std::max(header.width >> i, 1u), height = std::max(header.height >> i, 1u);
+        if (!file || levels[i].byteLength != level_size(image.format, width, height) || levels[i].byteOffset > fileSize ||
+            levels[i].byteLength > fileSize - levels[i].byteOffset) {
+            throw std::runtime_error(path + " has a malformed level " + std::to_string(i) + ".");
+        }
+        image.mips.push_back({width, height, image.data.size(), levels[i].byteLength});
+        image.data.resize(image.data.size() + levels[i].byteLength);
+        file.seekg(static_cast<std::streamoff>(levels[i].byteOffset));
+        file.read(reinterpret_cast<char*>(image.data.data() + image.mips.back().offset), static_cast<std::streamsize>(levels[i].byteLength));
+    }
+    if (!file) {
+        throw std::runtime_error("failed to read " + path + ".");
+    }
+    return image;
+}
+
+std::string texture_compress::baked_path(const std::string& imagePath) {
+    size_t dot = imagePath.find_last_of('.');
+    size_t slash = imagePath.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return imagePath + BAKED_EXTENSION;
+    }
+    return imagePath.substr(0, dot) + BAKED_EXTENSION;
+}
+
+void texture_compress::bake_files(const std::vector<std::string>& files, TextureFormat format) {
+    uint32_t threadCount = parallel::resolve_thread_count(0);
+    for (const std::string& path : files) {
+        int width = 0, height = 0, channels = 0;
+        stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        if (!pixels) {
+            throw std::runtime_error("failed to load texture " + path + ": " + stbi_failure_reason());
+        }
+        TextureImage source = from_pixels(pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+        stbi_image_free(pixels);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        TextureImage mips = generate_mips(source);
+        TextureImage baked = compress(mips, format, threadCount);
+        double bakeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        std::string output = baked_path(path);
+        write_file(output, baked);
+
+        // Peak signal to noise ratio of level 0 after a round trip through the format.
+        TextureImage decoded = decompress(baked);
+        double squaredError = 0.0;
+        size_t channelCount = format == TextureFormat::BC1 ? 3 : 4;
+        for (size_t i = 0; i < mips.mips[0].size; i += 4) {
+            for (size_t c = 0; c < channelCount; ++c) {
+                double difference = double(mips.data[i + c]) - decoded.data[i + c];
+                squaredError += difference * difference;
+            }
+        }
+        double meanSquaredError = squaredError / (double(mips.mips[0].size) / 4 * channelCount);
+        double psnr = meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : INFINITY;
+
+        std::cout << "[INFO] Baked " << path << " -> " << output << ": " << format_name(format) << ", " << width << "x" << height << ", "
+                  << baked.mips.size() << " mips, " << mips.data.size() / (1024.0 * 1024.0) << " MiB as RGBA8 -> "
+                  << baked.data.size() / (1024.0 * 1024.0) << " MiB, PSNR " << psnr << " dB, " << bakeMs << " ms on " << threadCount
+                  << " threads" << std::endl;
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class TextureFormat : uint32_t {
+    // 4 bytes per texel, sRGB color and linear alpha.
+    RGBA8 = 0,
+    // 8 bytes per 4x4 block, opaque sRGB color.
+    BC1 = 1,
+    // 16 bytes per 4x4 block, sRGB color and alpha.
+    BC7 = 2
+};
+
+// One mip level inside TextureImage::data.
+struct TextureMip {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;
+    uint64_t size;
+};
+
+// A texture with its levels laid out back to back, largest first, ready to be copied into a
+// staging buffer. Block-compressed levels store rows of 4x4 blocks, edge blocks padded.
+struct TextureImage {
+    TextureFormat format = TextureFormat::RGBA8;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<TextureMip> mips;
+    std::vector<uint8_t> data;
+};
+
+namespace texture_compress {
+    // Extension of baked texture files.
+    const char* const BAKED_EXTENSION = ".btx";
+
+    const char* format_name(TextureFormat format);
+
+    // Wraps tightly packed RGBA8 pixels as a single-level image.
+    TextureImage from_pixels(const uint8_t* rgba, uint32_t width, uint32_t height);
+
+    // Returns an RGBA8 image with the full mip chain of level 0, box-filtered in linear space.
+    TextureImage generate_mips(const TextureImage& image);
+
+    // Encodes every level of an RGBA8 image into format on threadCount threads (0 uses every core).
+    TextureImage compress(const TextureImage& image, TextureFormat format, uint32_t threadCount = 0);
+
+    // Decodes a block-compressed image back to RGBA8, keeping its levels. Used when the GPU
+    // cannot sample the baked format.
+    TextureImage decompress(const TextureImage& image);
+
+    // Reads and writes the baked container: a 12-byte identifier, a header with the format,
+    // size and level count, a level index of byte offsets and lengths, then the level data.
+    // Both throw on I/O errors or malformed files.
+    void write_file(const std::string& path, const TextureImage& image);
+    TextureImage read_file(const std::string& path);
+
+    // Path of the baked file for a source image: the same path with BAKED_EXTENSION.
+    std::string baked_path(const std::string& imagePath);
+
+    // Decodes each image file, builds its mips, compresses them into format and writes the
+    // result to baked_path(file), logging sizes and timings.
+    void bake_files(const std::vector<std::string>& files, TextureFormat format);
+}
@@ -0,0 +1,305 @@
+#include "transform_batch.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define TRANSFORM_BATCH_SSE 1
+#else
+#define TRANSFORM_BATCH_SSE 0
+#endif
+
+// GCC and Clang can compile the AVX kernel into a baseline build and pick it at runtime;
+// MSVC only gets it when the whole build targets AVX (/arch:AVX).
+#if TRANSFORM_BATCH_SSE && (defined(__GNUC__) || defined(__clang__))
+#define TRANSFORM_BATCH_AVX 1
+#define TRANSFORM_BATCH_AVX_TARGET __attribute__((target("avx")))
+#elif TRANSFORM_BATCH_SSE && defined(__AVX__)
+#define TRANSFORM_BATCH_AVX 1
+#define TRANSFORM_BATCH_AVX_TARGET
+#else
+#define TRANSFORM_BATCH_AVX 0
+#endif
+
+void TransformSoA::resize(size_t count) {
+    for (std::vector<float>* component : {&px, &py, &pz, &qx, &qy, &qz, &qw, &scale}) {
+        component->resize(count);
+    }
+}
+
+void TransformSoA::set(size_t index, const glm::vec3& position, const glm::quat& rotation, float uniformScale) {
+    px[index] = position.x;
+    py[index] = position.y;
+    pz[index] = position.z;
+    qx[index] = rotation.x;
+    qy[index] = rotation.y;
+    qz[index] = rotation.z;
+    qw[index] = rotation.w;
+    scale[index] = uniformScale;
+}
+
+static uint8_t* object_ptr(void* dst, size_t dstStride, size_t index) {
+    return static_cast<uint8_t*>(dst) + index * dstStride;
+}
+
+void transform_batch::compose_scalar(const TransformSoA& src, size_t first, size_t count, void* dst, size_t dstStride, TransformLayout layout) {
+    for (size_t n = 0; n < count; ++n) {
+        size_t i = first + n;
+        float x = src.qx[i], y = src.qy[i], z = src.qz[i], w = src.qw[i], s = src.scale[i];
+
+        // Rotation matrix of the quaternion, element rc = row r, column c, times the scale.
+        float r00 = (1.0f - 2.0f * (y * y + z * z)) * s;
+        float r01 = 2.0f * (x * y - w * z) * s;
+        float r02 = 2.0f * (x * z + w * y) * s;
+        float r10 = 2.0f * (x * y + w * z) * s;
+        float r11 = (1.0f - 2.0f * (x * x + z * z)) * s;
+        float r12 = 2.0f * (y * z - w * x) * s;
+        float r20 = 2.0f * (x * z - w * y) * s;
+        float r21 = 2.0f * (y * z + w * x) * s;
+        float r22 = (1.0f - 2.0f * (x * x + y * y)) * s;
+
+        float out[16];
+        size_t size;
+        if (layout == TransformLayout::Affine3x4) {
+            const float rows[12] = {r00, r01, r02, src.px[i], r10, r11, r12, src.py[i], r20, r21, r22, src.pz[i]};
+            std::memcpy(out, rows, sizeof(rows));
+            size = sizeof(rows);
+        } else {
+            const float columns[16] = {r00, r10, r20, 0.0f, r01, r11, r21, 0.0f, r02, r12, r22, 0.0f, src.px[i], src.py[i], src.pz[i], 1.0f};
+            std::memcpy(out, columns, sizeof(columns));
+            size = sizeof(columns);
+        }
+        std::memcpy(object_ptr(dst, dstStride, n), out, size);
+    }
+}
+
+#if TRANSFORM_BATCH_SSE
+
+// Transposes four lane-vectors (one matrix element for four objects each) into one
+// 4-float row or column per object and stores it at the given offset.
+static inline void store_transposed(__m128 a, __m128 b, __m128 c, __m128 d, void* dst, size_t dstStride, size_t offsetFloats) {
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+    _mm_storeu_ps(reinterpret_cast<float*>(object_ptr(dst, dstStride, 0)) + offsetFloats, a);
+    _mm_storeu_ps(reinterpret_cast<float*>(object_ptr(dst, dstStride, 1)) + offsetFloats, b);
+    _mm_storeu_ps(reinterpret_cast<float*>(object_ptr(dst, dstStride, 2)) + offsetFloats, c);
+    _mm_storeu_ps(reinterpret_cast<float*>(object_ptr(dst, dstStride, 3)) + offsetFloats, d);
+}
+
+// The twelve matrix elements for a group of four objects, each as one lane-vector.
+struct Elements4 {
+    __m128 r00, r01, r02, r10, r11, r12, r20, r21, r22, tx, ty, tz;
+};
+
+static inline void store_group(const Elements4& e, void* dst, size_t dstStride, TransformLayout layout) {
+    if (layout == TransformLayout::Affine3x4) {
+        store_transposed(e.r00, e.r01, e.r02, e.tx, dst, dstStride, 0);
+        store_transposed(e.r10, e.r11, e.r12, e.ty, dst, dstStride, 4);
+        store_transposed(e.r20, e.r21, e.r22, e.tz, dst, dstStride, 8);
+    } else {
+        const __m128 zero = _mm_setzero_ps();
+        store_transposed(e.r00, e.r10, e.r20, zero, dst, dstStride, 0);
+        store_transposed(e.r01, e.r11, e.r21, zero, dst, dstStride, 4);
+        store_transposed(e.r02, e.r12, e.r22, zero, dst, dstStride, 8);
+        store_transposed(e.tx, e.ty, e.tz, _mm_set1_ps(1.0f), dst, dstStride, 12);
+    }
+}
+
+static size_t compose_sse(const TransformSoA& src, size_t first, size_t count, void* dst, size_t dstStride, TransformLayout layout) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+
+    size_t n = 0;
+    for (; n + 4 <= count; n += 4) {
+        size_t i = first + n;
+        __m128 x = _mm_loadu_ps(&src.qx[i]);
+        __m128 y = _mm_loadu_ps(&src.qy[i]);
+        __m128 z = _mm_loadu_ps(&src.qz[i]);
+        __m128 w = _mm_loadu_ps(&src.qw[i]);
+        __m128 s = _mm_loadu_ps(&src.scale[i]);
+        __m128 s2 = _mm_mul_ps(s, two);
+
+        __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+        Elements4 e;
+        e.r00 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), s);
+        e.r11 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), s);
+        e.r22 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), s);
+        e.r01 = _mm_mul_ps(_mm_sub_ps(xy, wz), s2);
+        e.r10 = _mm_mul_ps(_mm_add_ps(xy, wz), s2);
+        e.r02 = _mm_mul_ps(_mm_add_ps(xz, wy), s2);
+        e.r20 = _mm_mul_ps(_mm_sub_ps(xz, wy), s2);
+        e.r12 = _mm_mul_ps(_mm_sub_ps(yz, wx), s2);
+        e.r21 = _mm_mul_ps(_mm_add_ps(yz, wx), s2);
+        e.tx = _mm_loadu_ps(&src.px[i]);
+        e.ty = _mm_loadu_ps(&src.py[i]);
+        e.tz = _mm_loadu_ps(&src.pz[i]);
+
+        store_group(e, object_ptr(dst, dstStride, n), dstStride, layout);
+    }
+    return n;
+}
+
+#endif
+
+#if TRANSFORM_BATCH_AVX
+
+// Eight objects per iteration. The element math runs at 256 bits; the transposes and stores
+// reuse the 128-bit path on each half, which is also what splits the output per object.
+TRANSFORM_BATCH_AVX_TARGET
+static size_t compose_avx(const TransformSoA& src, size_t first, size_t count, void* dst, size_t dstStride, TransformLayout layout) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+
+    size_t n = 0;
+    for (; n + 8 <= count; n += 8) {
+        size_t i = first + n;
+        __m256 x = _mm256_loadu_ps(&src.qx[i]);
+        __m256 y = _mm256_loadu_ps(&src.qy[i]);
+        __m256 z = _mm256_loadu_ps(&src.qz[i]);
+        __m256 w = _mm256_loadu_ps(&src.qw[i]);
+        __m256 s = _mm256_loadu_ps(&src.scale[i]);
+        __m256 s2 = _mm256_mul_ps(s, two);
+
+        __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+        __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+        __m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+        __m256 elements[12] = {
+            _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), s),
+            _mm256_mul_ps(_mm256_sub_ps(xy, wz), s2),
+            _mm256_mul_ps(_mm256_add_ps(xz, wy), s2),
+            _mm256_mul_ps(_mm256_add_ps(xy, wz), s2),
+            _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), s),
+            _mm256_mul_ps(_mm256_sub_ps(yz, wx), s2),
+            _mm256_mul_ps(_mm256_sub_ps(xz, wy), s2),
+            _mm256_mul_ps(_mm256_add_ps(yz, wx), s2),
+            _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), s),
+            _mm256_loadu_ps(&src.px[i]),
+            _mm256_loadu_ps(&src.py[i]),
+            _mm256_loadu_ps(&src.pz[i])
+        };
+
+        for (int half = 0; half < 2; ++half) {
+            __m128 lanes[12];
+            for (int k = 0; k < 12; ++k) {
+                lanes[k] = half == 0 ? _mm256_castps256_ps128(elements[k]) : _mm256_extractf128_ps(elements[k], 1);
+            }
+            Elements4 e{lanes[0], lanes[1], lanes[2], lanes[3], lanes[4], lanes[5], lanes[6], lanes[7], lanes[8], lanes[9], lanes[10], lanes[11]};
+            store_group(e, object_ptr(dst, dstStride, n + half * 4), dstStride, layout);
+        }
+    }
+    return n;
+}
+
+static bool cpu_has_avx() {
+#if defined(__GNUC__) || defined(__clang__)
+    static const bool supported = __builtin_cpu_supports("avx");
+    return supported;
+#else
+    return true;
+#endif
+}
+
+#endif
+
+void transform_batch::compose(const TransformSoA& src, size_t first, size_t count, void* dst, size_t dstStride, TransformLayout layout) {
+    size_t done = 0;
+#if TRANSFORM_BATCH_AVX
+    if (cpu_has_avx()) {
+        done = compose_avx(src, first, count, dst, dstStride, layout);
+    }
+#endif
+#if TRANSFORM_BATCH_SSE
+    done += compose_sse(src, first + done, count - done, object_ptr(dst, dstStride, done), dstStride, layout);
+#endif
+    compose_scalar(src, first + done, count - done, object_ptr(dst, dstStride, done), dstStride, layout);
+}
+
+const char* transform_batch::kernel_name() {
+#if TRANSFORM_BATCH_AVX
+    if (cpu_has_avx()) {
+        return "AVX";
+    }
+#endif
+#if TRANSFORM_BATCH_SSE
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+
+void transform_batch::run_benchmark(size_t count) {
+    const int iterations = 20;
+
+    TransformSoA transforms;
+    transforms.resize(count);
+    std::vector<glm::vec3> positions(count);
+    std::vector<glm::quat> rotations(count);
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (size_t i = 0; i < count; ++i) {
+        positions[i] = glm::vec3(unit(rng), unit(rng), unit(rng)) * 10.0f;
+        rotations[i] = glm::normalize(glm::quat(unit(rng), unit(rng), unit(rng), unit(rng)));
+        transforms.set(i, positions[i], rotations[i], 0.5f);
+    }
+
+    std::vector<glm::mat4> glmResult(count);
+    std::vector<glm::mat4> mat4Result(count);
+    std::vector<float> affineResult(count * 12);
+
+    auto time_ns_per_object = [&](auto&& body) {
+        body();
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int it = 0; it < iterations; ++it) {
+            body();
+        }
+        double elapsed = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count();
+        return elapsed / (static_cast<double>(iterations) * count);
+    };
+
+    // The per-object path update_scene used: three full mat4 constructions and two multiplies.
+    double glmNs = time_ns_per_object([&] {
+        glm::mat4 scaleMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));
+        for (size_t i = 0; i < count; ++i) {
+            glmResult[i] = glm::translate(glm::mat4(1.0f), positions[i]) * glm::mat4_cast(rotations[i]) * scaleMatrix;
+        }
+    });
+    double scalarNs = time_ns_per_object([&] {
+        compose_scalar(transforms, 0, count, affineResult.data(), 12 * sizeof(float), TransformLayout::Affine3x4);
+    });
+    double affineNs = time_ns_per_object([&] {
+        compose(transforms, 0, count, affineResult.data(), 12 * sizeof(float), TransformLayout::Affine3x4);
+    });
+    double mat4Ns = time_ns_per_object([&] {
+        compose(transforms, 0, count, mat4Result.data(), sizeof(glm::mat4), TransformLayout::Mat4);
+    });
+
+    float maxError = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            for (int r = 0; r < 4; ++r) {
+                maxError = std::max(maxError, std::abs(glmResult[i][c][r] - mat4Result[i][c][r]));
+                if (r < 3) {
+                    maxError = std::max(maxError, std::abs(glmResult[i][c][r] - affineResult[i * 12 + r * 4 + c]));
+                }
+            }
+        }
+    }
+
+    std::cout << "[PERF] Transform composition, " << count << " objects, " << kernel_name() << " kernel:\n"
+              << "       glm translate * mat4_cast * scale: " << glmNs << " ns/object\n"
+              << "       scalar 3x4:                        " << scalarNs << " ns/object\n"
+              << "       batched 3x4:                       " << affineNs << " ns/object (" << glmNs / affineNs << "x)\n"
+              << "       batched mat4:                      " << mat4Ns << " ns/object (" << glmNs / mat4Ns << "x)\n"
+              << "       max abs difference from glm:       " << maxError << std::endl;
+}
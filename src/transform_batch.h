@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Structure-of-arrays transforms: translation, unit quaternion and uniform scale.
+// Each component lives in its own array so the kernel can load several objects per register.
+struct TransformSoA {
+    std::vector<float> px, py, pz;
+    std::vector<float> qx, qy, qz, qw;
+    std::vector<float> scale;
+
+    void resize(size_t count);
+    size_t size() const { return px.size(); }
+    void set(size_t index, const glm::vec3& position, const glm::quat& rotation, float uniformScale);
+};
+
+enum class TransformLayout {
+    // 12 floats per object: three rows of [R*s | t], as in VkTransformMatrixKHR or a GLSL mat3x4 row array.
+    Affine3x4,
+    // 16 floats per object in glm::mat4 (column-major) order.
+    Mat4
+};
+
+namespace transform_batch {
+    // Composes translate(p) * mat4_cast(q) * scale(s) for objects [first, first + count) and writes
+    // object i to dst + (i - first) * dstStride bytes. dst may be mapped GPU memory or the
+    // transform field of an array of structs; it needs no particular alignment.
+    void compose(const TransformSoA& src, size_t first, size_t count, void* dst, size_t dstStride, TransformLayout layout);
+
+    // Portable reference path used for the tails and on CPUs without SSE.
+    void compose_scalar(const TransformSoA& src, size_t first, size_t count, void* dst, size_t dstStride, TransformLayout layout);
+
+    // Name of the kernel compose() dispatches to on this CPU: "AVX", "SSE" or "scalar".
+    const char* kernel_name();
+
+    // Times the glm path against the batched kernel for count objects and prints the results.
+    void run_benchmark(size_t count);
+}
@@ -12,8 +12,10 @@
 #include <limits>
 #include <array>
 #include <optional>
+#include <map>
 #include <set>
 #include <unordered_map>
+#include <thread>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -21,21 +23,45 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 
-const uint32_t WIDTH = 800;
-const uint32_t HEIGHT = 600;
+#include <glm/gtc/packing.hpp>
 
 const std::string MODEL_PATH = "models/sphere.obj";
 const std::string TEXTURE_PATH = "textures/viking_room.png";
-const int MAX_FRAMES_IN_FLIGHT = 2;
+const std::chrono::microseconds SIM_TICK_INTERVAL(1000000 / 240);
+const std::chrono::seconds TIMING_REPORT_INTERVAL(5);
+const float CAMERA_FOV_DEGREES = 45.0f;
+const float CAMERA_NEAR_PLANE = 0.1f;
+const float CAMERA_FAR_PLANE = 100.0f;
+// The lamp's shadow map looks straight down from the bulb. Its near plane sits past the lamp
+// shade around the bulb, which would otherwise shadow the whole table.
+const uint32_t SHADOW_MAP_SIZE = 2048;
+const float SHADOW_FOV_DEGREES = 120.0f;
+const float SHADOW_NEAR_PLANE = 0.75f;
+// Extra lights circle these points over the table at this height and radius.
+const float EXTRA_LIGHT_HEIGHT = 1.2f;
+const float EXTRA_LIGHT_ORBIT = 0.6f;
+// Hard per-frame vertex budget of the debug line buffers.
+const uint32_t DEBUG_DRAW_MAX_VERTICES = 65536;
+const size_t DEBUG_TRAIL_LENGTH = 64;
+// Occlusion rays of the static batch count hits up to this far, in world units.
+const float AO_MAX_DISTANCE = 1.0f;
+// Mesh that holds every static renderable, pre-transformed into world space.
+const std::string STATIC_BATCH_MESH = "static_batch";
+// Quad shared by every sphere impostor draw.
+const std::string IMPOSTOR_QUAD_MESH = "impostor_quad";
+// Simplification stops once a level would deviate by more than this fraction of the mesh radius.
+const float LOD_MAX_ERROR_FRACTION = 0.25f;
 
 const std::vector<const char*> validationLayers = {
     "VK_LAYER_KHRONOS_validation"
 };
 
-const std::vector<const char*> deviceExtensions = {
+const std::vector<const char*> presentDeviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+const VkFormat OFFSCREEN_COLOR_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+
 #ifdef NDEBUG
 const bool enableValidationLayers = false;
 #else
@@ -73,6 +99,27 @@ static std::vector<char> readFile(const std::string& filename) {
     return buffer;
 }
 
+static glm::vec3 camera_position(const CameraState& camera) {
+    glm::vec3 lookAtTarget = glm::vec3(0.0f, 0.0f, 0.0f);
+    return {
+        lookAtTarget.x + camera.distance * cos(camera.pitch) * cos(camera.yaw),
+        lookAtTarget.y + camera.distance * sin(camera.pitch),
+        lookAtTarget.z + camera.distance * cos(camera.pitch) * sin(camera.yaw)
+    };
+}
+
+// The camera always looks at the origin.
+static glm::mat4 camera_view(const CameraState& camera) {
+    return glm::lookAt(camera_position(camera), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+// World to clip space of the lamp's downward shadow map; the far plane is the light's range.
+static glm::mat4 shadow_view_proj(const Light& light) {
+    glm::mat4 view = glm::lookAt(light.position, light.position - glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    glm::mat4 proj = glm::perspective(glm::radians(SHADOW_FOV_DEGREES), 1.0f, SHADOW_NEAR_PLANE, std::max(light.radius, SHADOW_NEAR_PLANE * 2.0f));
+    return proj * view;
+}
+
 namespace std {
     template<> struct hash<Vertex> {
         size_t operator()(Vertex const& vertex) const {
@@ -83,44 +130,124 @@ namespace std {
     };
 }
 
+VulkanApplication::VulkanApplication(const RendererSettings& rendererSettings)
+    : rendererSettings(rendererSettings), maxFramesInFlight(std::clamp<uint32_t>(rendererSettings.framesInFlight, 1, 4)),
+      headless(rendererSettings.headless), captureEnabled(!rendererSettings.captureDirectory.empty()) {
+}
+
 void VulkanApplication::init() {
-    initWindow();
+    profiler::set_enabled(rendererSettings.profile);
+    if (!headless) {
+        initWindow();
+    }
     initVulkan();
 }
 
 void VulkanApplication::run() {
-    mainLoop();
+    if (rendererSettings.bench) {
+        benchLoop();
+    } else if (!rendererSettings.replayInput.empty()) {
+        replayLoop();
+    } else {
+        mainLoop();
+    }
+}
+
+FrameTimings VulkanApplication::getFrameTimings() const {
+    FrameTimings timings;
+    timings.simMs = simFrameMs.load(std::memory_order_relaxed);
+    timings.renderMs = renderFrameMs.load(std::memory_order_relaxed);
+    timings.simTicks = simTicks.load(std::memory_order_relaxed);
+    timings.renderFrames = renderFrames.load(std::memory_order_relaxed);
+    timings.triangles = renderTriangles.load(std::memory_order_relaxed);
+    timings.drawCalls = renderDrawCalls.load(std::memory_order_relaxed);
+    timings.indirectCalls = renderIndirectCalls.load(std::memory_order_relaxed);
+    timings.pipelineBinds = renderPipelineBinds.load(std::memory_order_relaxed);
+    timings.bufferBinds = renderBufferBinds.load(std::memory_order_relaxed);
+    timings.staticCommandRecords = staticCommandRecords.load(std::memory_order_relaxed);
+    timings.impostors = renderImpostors.load(std::memory_order_relaxed);
+    timings.staticShadowRenders = staticShadowRenders.load(std::memory_order_relaxed);
+    timings.shadowRenders = shadowRenders.load(std::memory_order_relaxed);
+    timings.lights = renderLights.load(std::memory_order_relaxed);
+    timings.visibleLights = renderVisibleLights.load(std::memory_order_relaxed);
+    timings.litClusters = renderLitClusters.load(std::memory_order_relaxed);
+    timings.maxClusterLights = renderMaxClusterLights.load(std::memory_order_relaxed);
+    timings.lightIndices = renderLightIndices.load(std::memory_order_relaxed);
+    for (uint32_t lod = 0; lod < MAX_MESH_LODS; ++lod) {
+        timings.objectsPerLod[lod] = renderObjectsPerLod[lod].load(std::memory_order_relaxed);
+    }
+
+    uint64_t samples = inputLatencySamples.load(std::memory_order_relaxed);
+    if (samples > 0) {
+        timings.inputToPresentMs = inputLatencyTotalUs.load(std::memory_order_relaxed) / 1000.0f / samples;
+    }
+    timings.inputToPresentMaxMs = inputLatencyMaxUs.load(std::memory_order_relaxed) / 1000.0f;
+    return timings;
+}
+
+FrameTimings VulkanApplication::consumeFrameTimings() {
+    FrameTimings timings = getFrameTimings();
+    inputLatencyTotalUs.store(0, std::memory_order_relaxed);
+    inputLatencySamples.store(0, std::memory_order_relaxed);
+    inputLatencyMaxUs.store(0, std::memory_order_relaxed);
+    return timings;
 }
 
 void VulkanApplication::cleanup() {
     cleanupSwapChain();
-    
-    vkDestroyBuffer(device, lightBuffer, nullptr);
-    vkFreeMemory(device, lightBufferMemory, nullptr);
+    destroyCaptureResources();
 
-    for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for(size_t i = 0; i < maxFramesInFlight; i++) {
         vkDestroyBuffer(device, uniformBuffers[i], nullptr);
         vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
-    }
+        vkDestroyBuffer(device, drawDataBuffers[i], nullptr);
+        vkFreeMemory(device, drawDataMemory[i], nullptr);
+    }
+    for (size_t i = 0; i < debugVertexBuffers.size(); i++) {
+        vkDestroyBuffer(device, debugVertexBuffers[i], nullptr);
+        vkFreeMemory(device, debugVertexMemory[i], nullptr);
+    }
+    vkDestroyBuffer(device, impostorBuffer, nullptr);
+    vkFreeMemory(device, impostorBufferMemory, nullptr);
+
+    vkDestroySampler(device, shadowSampler, nullptr);
+    vkDestroyFramebuffer(device, staticShadowFramebuffer, nullptr);
+    vkDestroyFramebuffer(device, shadowFramebuffer, nullptr);
+    vkDestroyImageView(device, staticShadowImageView, nullptr);
+    vkDestroyImage(device, staticShadowImage, nullptr);
+    vkFreeMemory(device, staticShadowImageMemory, nullptr);
+    vkDestroyImageView(device, shadowImageView, nullptr);
+    vkDestroyImage(device, shadowImage, nullptr);
+    vkFreeMemory(device, shadowImageMemory, nullptr);
 
     vkDestroyDescriptorPool(device, descriptorPool, nullptr);
     vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, textureSetLayout, nullptr);
     
     for (auto const& [name, mesh] : _meshes) {
         vkDestroyBuffer(device, mesh._vertexBuffer, nullptr);
         vkFreeMemory(device, mesh._vertexBufferMemory, nullptr);
         vkDestroyBuffer(device, mesh._indexBuffer, nullptr);
         vkFreeMemory(device, mesh._indexBufferMemory, nullptr);
+        vkDestroyBuffer(device, mesh._occlusionBuffer, nullptr);
+        vkFreeMemory(device, mesh._occlusionBufferMemory, nullptr);
     }
 
     vkDestroyPipeline(device, graphicsPipeline, nullptr);
+    vkDestroyPipeline(device, translucentPipeline, nullptr);
+    vkDestroyPipeline(device, bakedAoPipeline, nullptr);
+    vkDestroyPipeline(device, debugLinePipeline, nullptr);
+    vkDestroyPipeline(device, impostorPipeline, nullptr);
+    vkDestroyPipeline(device, shadowPipeline, nullptr);
     vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
     vkDestroyRenderPass(device, renderPass, nullptr);
+    vkDestroyRenderPass(device, staticShadowRenderPass, nullptr);
+    vkDestroyRenderPass(device, shadowRenderPass, nullptr);
     
-    for(size_t i = 0; i < swapChainImages.size(); i++) {
-        vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
-    }
-    for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    gpuQueries.destroy();
+    textureCache.destroy();
+    destroyRenderFinishedSemaphores();
+    for(size_t i = 0; i < maxFramesInFlight; i++) {
         vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
         vkDestroyFence(device, inFlightFences[i], nullptr);
     }
@@ -132,20 +259,29 @@ void VulkanApplication::cleanup() {
         DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
     }
     
-    vkDestroySurfaceKHR(instance, surface, nullptr);
+    if (!headless) {
+        vkDestroySurfaceKHR(instance, surface, nullptr);
+    }
     vkDestroyInstance(instance, nullptr);
     
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    if (!headless) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
 }
 
 void VulkanApplication::initWindow() {
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     
-    window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan Pool", nullptr, nullptr);
+    window = glfwCreateWindow(rendererSettings.width, rendererSettings.height, "Vulkan Pool", nullptr, nullptr);
     glfwSetWindowUserPointer(window, this);
     glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(window, &width, &height);
+    framebufferWidth = width;
+    framebufferHeight = height;
 }
 
 void VulkanApplication::setupPoolTable() {
@@ -171,30 +307,56 @@ void VulkanApplication::setupPoolTable() {
     cue.angle = 0.0f;
     cue.power = 10.0f;
 
+    ballTransformDirty.assign(balls.size(), 1);
+    cueTransformDirty = true;
+
     table_min_bounds = {-63.0f * BALL_RADIUS, -25.0f * BALL_RADIUS};
     table_max_bounds = {21.0f * BALL_RADIUS, 25.0f * BALL_RADIUS};
 }
 
-void VulkanApplication::processInput(float deltaTime) {
+uint16_t VulkanApplication::sampleInput() {
+    lastInputSampleTime = std::chrono::steady_clock::now();
+
+    bool dumpKeyDown = glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS;
+    if (dumpKeyDown && !profilerDumpKeyDown && profiler::is_enabled()) {
+        dumpProfilerTrace();
+    }
+    profilerDumpKeyDown = dumpKeyDown;
+
+    static const int keyMap[INPUT_KEY_COUNT] = {
+        GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_E, GLFW_KEY_Q, GLFW_KEY_LEFT, GLFW_KEY_RIGHT, GLFW_KEY_SPACE
+    };
+
+    uint16_t keys = 0;
+    for (uint16_t key = 0; key < INPUT_KEY_COUNT; ++key) {
+        if (glfwGetKey(window, keyMap[key]) == GLFW_PRESS) {
+            keys |= static_cast<uint16_t>(1u << key);
+        }
+    }
+    return keys;
+}
+
+void VulkanApplication::processInput(float deltaTime, const InputFrame& input) {
+    PROFILE_FUNCTION();
     float rotationSpeed = 2.0f * deltaTime;
     float zoomSpeed = 5.0f * deltaTime;
 
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+    if (input.pressed(INPUT_KEY_A)) {
         cameraYaw -= rotationSpeed;
     }
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+    if (input.pressed(INPUT_KEY_D)) {
         cameraYaw += rotationSpeed;
     }
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+    if (input.pressed(INPUT_KEY_W)) {
         cameraPitch -= rotationSpeed;
     }
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+    if (input.pressed(INPUT_KEY_S)) {
         cameraPitch += rotationSpeed;
     }
-    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) {
+    if (input.pressed(INPUT_KEY_E)) {
         cameraDistance -= zoomSpeed;
     }
-    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) {
+    if (input.pressed(INPUT_KEY_Q)) {
         cameraDistance += zoomSpeed;
     }
 
@@ -205,15 +367,15 @@ void VulkanApplication::processInput(float deltaTime) {
 
     float cueRotationSpeed = 2.0f * deltaTime;
 
-    if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
+    if (input.pressed(INPUT_KEY_LEFT)) {
         cue.angle -= cueRotationSpeed;
     }
 
-    if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
+    if (input.pressed(INPUT_KEY_RIGHT)) {
         cue.angle += cueRotationSpeed;
     }
 
-    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
+    if (input.pressed(INPUT_KEY_SPACE)) {
         glm::vec2 direction = {-1 * glm::cos(cue.angle), glm::sin(cue.angle)};
         balls[0].velocity = direction * cue.power;
         balls[0].is_moving = true;
@@ -222,6 +384,7 @@ void VulkanApplication::processInput(float deltaTime) {
 
 
 void VulkanApplication::updatePhysics(float deltaTime) {
+    PROFILE_FUNCTION();
     float friction = 0.5f;
     
     bool any_ball_is_moving = false;
@@ -242,6 +405,7 @@ void VulkanApplication::updatePhysics(float deltaTime) {
             
             ball.is_moving = true;
             any_ball_is_moving = true;
+            ballTransformDirty[&ball - balls.data()] = 1;
         } else {
             ball.velocity = {0.0f, 0.0f};
             ball.is_moving = false;
@@ -261,6 +425,7 @@ void VulkanApplication::updatePhysics(float deltaTime) {
             }
             ball.position.x = table_min_bounds.x + ball.radius;
             ball.velocity.x *= -1;
+            ballTransformDirty[i] = 1;
         }
         if (ball.position.x + ball.radius > table_max_bounds.x) {
             if (i == 0) {
@@ -269,6 +434,7 @@ void VulkanApplication::updatePhysics(float deltaTime) {
             }
             ball.position.x = table_max_bounds.x - ball.radius;
             ball.velocity.x *= -1;
+            ballTransformDirty[i] = 1;
         }
         if (ball.position.y - ball.radius < table_min_bounds.y) {
             if (i == 0) {
@@ -277,6 +443,7 @@ void VulkanApplication::updatePhysics(float deltaTime) {
             }
             ball.position.y = table_min_bounds.y + ball.radius;
             ball.velocity.y *= -1;
+            ballTransformDirty[i] = 1;
         }
         if (ball.position.y + ball.radius > table_max_bounds.y) {
             if (i == 0) {
@@ -285,6 +452,7 @@ void VulkanApplication::updatePhysics(float deltaTime) {
             }
             ball.position.y = table_max_bounds.y - ball.radius;
             ball.velocity.y *= -1;
+            ballTransformDirty[i] = 1;
         }
     }
     
@@ -317,13 +485,24 @@ void VulkanApplication::updatePhysics(float deltaTime) {
                 
                 b1.is_moving = true;
                 b2.is_moving = true;
+                ballTransformDirty[i] = 1;
+                ballTransformDirty[j] = 1;
             }
         }
     }
 }
 
 void VulkanApplication::create_mesh_buffers(Mesh& mesh) {
+    std::vector<PackedVertex> packedVertices;
+    const void* vertexData = mesh._vertices.data();
     VkDeviceSize vertexBufferSize = sizeof(mesh._vertices[0]) * mesh._vertices.size();
+    // Packed here at load rather than stored in a baked asset: meshes come straight from OBJ and are
+    // optimized, simplified and batched first, and the packing is one linear pass over the result.
+    if (rendererSettings.packedVertices) {
+        mesh._quantization = vertex_packing::pack(mesh._vertices, packedVertices);
+        vertexData = packedVertices.data();
+        vertexBufferSize = sizeof(PackedVertex) * packedVertices.size();
+    }
 
     VkBuffer vertexStagingBuffer;
     VkDeviceMemory vertexStagingBufferMemory;
@@ -332,7 +511,7 @@ void VulkanApplication::create_mesh_buffers(Mesh& mesh) {
 
     void* data;
     vkMapMemory(device, vertexStagingBufferMemory, 0, vertexBufferSize, 0, &data);
-    memcpy(data, mesh._vertices.data(), (size_t)vertexBufferSize);
+    memcpy(data, vertexData, (size_t)vertexBufferSize);
     vkUnmapMemory(device, vertexStagingBufferMemory);
 
     createBuffer(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
@@ -343,13 +522,24 @@ void VulkanApplication::create_mesh_buffers(Mesh& mesh) {
     vkDestroyBuffer (device, vertexStagingBuffer, nullptr);
     vkFreeMemory(device, vertexStagingBufferMemory, nullptr);
 
+    // Meshes whose vertices all fit in 16 bits are uploaded with half-size indices.
+    std::vector<uint16_t> compactIndices;
+    const void* indexData = mesh._indices.data();
     VkDeviceSize indexBufferSize = sizeof(mesh._indices[0]) * mesh._indices.size();
+    mesh._indexType = VK_INDEX_TYPE_UINT32;
+    if (mesh._vertices.size() <= UINT16_MAX + 1u) {
+        compactIndices.assign(mesh._indices.begin(), mesh._indices.end());
+        indexData = compactIndices.data();
+        indexBufferSize = sizeof(uint16_t) * compactIndices.size();
+        mesh._indexType = VK_INDEX_TYPE_UINT16;
+    }
+
     VkBuffer indexStagingBuffer;
     VkDeviceMemory indexStagingBufferMemory;
     createBuffer(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, indexStagingBuffer, indexStagingBufferMemory);
 
     vkMapMemory(device, indexStagingBufferMemory, 0, indexBufferSize, 0, &data);
-    memcpy(data, mesh._indices.data(), (size_t)indexBufferSize);
+    memcpy(data, indexData, (size_t)indexBufferSize);
     vkUnmapMemory(device, indexStagingBufferMemory);
 
     createBuffer(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh._indexBuffer, mesh._indexBufferMemory);
@@ -358,6 +548,105 @@ void VulkanApplication::create_mesh_buffers(Mesh& mesh) {
     vkDestroyBuffer(device, indexStagingBuffer, nullptr);
     vkFreeMemory(device, indexStagingBufferMemory, nullptr);
 
+    if (mesh._occlusion.empty()) {
+        return;
+    }
+    VkDeviceSize occlusionBufferSize = mesh._occlusion.size();
+
+    VkBuffer occlusionStagingBuffer;
+    VkDeviceMemory occlusionStagingBufferMemory;
+    createBuffer(occlusionBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 occlusionStagingBuffer, occlusionStagingBufferMemory);
+
+    vkMapMemory(device, occlusionStagingBufferMemory, 0, occlusionBufferSize, 0, &data);
+    memcpy(data, mesh._occlusion.data(), (size_t)occlusionBufferSize);
+    vkUnmapMemory(device, occlusionStagingBufferMemory);
+
+    createBuffer(occlusionBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 mesh._occlusionBuffer, mesh._occlusionBufferMemory);
+    copyBuffer(occlusionStagingBuffer, mesh._occlusionBuffer, occlusionBufferSize);
+
+    vkDestroyBuffer(device, occlusionStagingBuffer, nullptr);
+    vkFreeMemory(device, occlusionStagingBufferMemory, nullptr);
+}
+
+void VulkanApplication::reportMeshMemory() const {
+    // Summed over the live meshes, so static batch sources freed after merging are not counted.
+    const VkDeviceSize vertexStride = rendererSettings.packedVertices ? sizeof(PackedVertex) : sizeof(Vertex);
+    uint64_t vertexCount = 0;
+    VkDeviceSize vertexBytes = 0;
+    VkDeviceSize indexBytes = 0;
+    VkDeviceSize indexBytesSaved = 0;
+    for (const auto& [name, mesh] : _meshes) {
+        const VkDeviceSize indexStride = mesh._indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        vertexCount += mesh._vertices.size();
+        vertexBytes += vertexStride * mesh._vertices.size() + mesh._occlusion.size();
+        indexBytes += indexStride * mesh._indices.size();
+        indexBytesSaved += (sizeof(uint32_t) - indexStride) * mesh._indices.size();
+    }
+    std::cout << "[INFO] Vertex buffers: " << vertexCount << " vertices, " << vertexBytes / 1024 << " KiB (" << vertexStride
+              << " bytes/vertex)" << std::endl;
+    std::cout << "[INFO] Index buffers: " << indexBytes / 1024 << " KiB, " << indexBytesSaved / 1024 << " KiB saved by 16-bit indices"
+              << std::endl;
+}
+
+void VulkanApplication::build_mesh_lods(Mesh& mesh, const std::vector<IndexRange>& ranges, uint32_t levelCount) {
+    glm::vec3 minimum = mesh._vertices[0].pos;
+    glm::vec3 maximum = minimum;
+    for (const Vertex& vertex : mesh._vertices) {
+        minimum = glm::min(minimum, vertex.pos);
+        maximum = glm::max(maximum, vertex.pos);
+    }
+    mesh._boundsCenter = (minimum + maximum) * 0.5f;
+    mesh._boundsRadius = 0.0f;
+    for (const Vertex& vertex : mesh._vertices) {
+        mesh._boundsRadius = std::max(mesh._boundsRadius, glm::length(vertex.pos - mesh._boundsCenter));
+    }
+
+    mesh._lods.clear();
+    mesh._lods.push_back({0, static_cast<uint32_t>(mesh._subMeshes.size()), static_cast<uint32_t>(mesh._indices.size() / 3), 0.0f});
+    if (levelCount == 0) {
+        return;
+    }
+
+    // The simplified ranges are appended to _indices and reuse the materials of the ranges they came from.
+    levelCount = std::min(levelCount, MAX_MESH_LODS - 1);
+    std::vector<LodLevel> levels = mesh_optimizer::build_lod_chain(mesh._vertices, mesh._indices, ranges, levelCount,
+                                                                   mesh._boundsRadius * LOD_MAX_ERROR_FRACTION);
+    for (const LodLevel& level : levels) {
+        MeshLod lod{static_cast<uint32_t>(mesh._subMeshes.size()), static_cast<uint32_t>(level.ranges.size()), level.triangleCount, level.error};
+        for (size_t i = 0; i < level.ranges.size(); ++i) {
+            SubMesh submesh = mesh._subMeshes[i];
+            submesh.firstIndex = level.ranges[i].firstIndex;
+            submesh.indexCount = level.ranges[i].indexCount;
+            mesh._subMeshes.push_back(submesh);
+        }
+        mesh._lods.push_back(lod);
+    }
+}
+
+uint32_t VulkanApplication::selectLod(const Mesh& mesh, const glm::mat4& transform, const glm::vec3& cameraPosition, float pixelsPerUnit) const {
+    if (mesh._lods.size() < 2 || rendererSettings.lodPixelError <= 0.0f) {
+        return 0;
+    }
+
+    float scale = std::max({glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))});
+    glm::vec3 center = glm::vec3(transform * glm::vec4(mesh._boundsCenter, 1.0f));
+    // Distance to the nearest point of the bounding sphere, so the estimate never undershoots.
+    float distance = glm::length(center - cameraPosition) - mesh._boundsRadius * scale;
+    if (distance <= 0.0f) {
+        return 0;
+    }
+
+    float pixelsPerObjectUnit = scale * pixelsPerUnit / distance;
+    uint32_t selected = 0;
+    for (uint32_t lod = 1; lod < mesh._lods.size(); ++lod) {
+        if (mesh._lods[lod].error * pixelsPerObjectUnit > rendererSettings.lodPixelError) {
+            break;
+        }
+        selected = lod;
+    }
+    return selected;
 }
 
 void VulkanApplication::load_model(const char* filename) {
@@ -376,6 +665,10 @@ void VulkanApplication::load_model(const char* filename) {
         if (_materials.find(mat.name) == _materials.end()) {
             Material newMaterial;
             newMaterial.color = {mat.diffuse[0], mat.diffuse[1], mat.diffuse[2]};
+            newMaterial.opacity = std::clamp(static_cast<float>(mat.dissolve), 0.0f, 1.0f);
+            if (!mat.diffuse_texname.empty()) {
+                newMaterial.texture = textureCache.request(mtl_basedir + mat.diffuse_texname);
+            }
             _materials[mat.name] = newMaterial;
         }
     }
@@ -447,6 +740,30 @@ void VulkanApplication::load_model(const char* filename) {
             continue;
         }
 
+        // Each SubMesh is optimized in place, so firstIndex/indexCount stay valid.
+        std::vector<IndexRange> ranges;
+        for (const SubMesh& submesh : newMesh._subMeshes) {
+            ranges.push_back({submesh.firstIndex, submesh.indexCount});
+        }
+        if (rendererSettings.optimizeMeshes) {
+            auto [before, after] = mesh_optimizer::optimize_mesh(newMesh._vertices, newMesh._indices, ranges);
+            std::cout << "[INFO] " << filename << " (" << shape.name << "): " << newMesh._indices.size() / 3
+                      << " triangles, ACMR " << before.acmr << " -> " << after.acmr
+                      << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+        } else {
+            VertexCacheStats stats = mesh_optimizer::analyze_vertex_cache(newMesh._indices.data(), newMesh._indices.size(), newMesh._vertices.size());
+            std::cout << "[INFO] " << filename << " (" << shape.name << "): " << newMesh._indices.size() / 3
+                      << " triangles, ACMR " << stats.acmr << ", ATVR " << stats.atvr << std::endl;
+        }
+        build_mesh_lods(newMesh, ranges, rendererSettings.lodLevels);
+        if (newMesh._lods.size() > 1) {
+            std::cout << "[INFO] " << filename << " (" << shape.name << ") LODs:";
+            for (const MeshLod& lod : newMesh._lods) {
+                std::cout << " " << lod.triangleCount << " tris (error " << lod.error << ")";
+            }
+            std::cout << std::endl;
+        }
+
         create_mesh_buffers(newMesh);
         _meshes[shape.name] = newMesh;
     }
@@ -495,6 +812,15 @@ void VulkanApplication::setup_scene() {
     }
     std::cout << "[INFO] Models loaded. Total meshes: " << _meshes.size() << std::endl;
 
+    for (const auto& [materialName, texturePath] : rendererSettings.materialTextures) {
+        auto material = _materials.find(materialName);
+        if (material == _materials.end()) {
+            std::cerr << "[ERROR] --texture: no material named " << materialName << std::endl;
+            continue;
+        }
+        material->second.texture = textureCache.request(texturePath);
+    }
+
     _staticRenderables.clear();
     _dynamicRenderables.clear();
 
@@ -558,155 +884,249 @@ void VulkanApplication::setup_scene() {
     std::cout << "[INFO] Scene setup complete. Dynamic renderables: " << _dynamicRenderables.size() << " | Physics balls: " << balls.size() << std::endl;
 }
 
-void VulkanApplication::create_debug_axes() {
-    _materials["debug_red"] = Material{{0.8f, 0.1f, 0.1f}};
-    _materials["debug_green"] = Material{{0.1f, 0.8f, 0.1f}};
-    _materials["debug_blue"] = Material{{0.1f, 0.1f, 0.8f}};
-
-    const float length = 1.5f;
-    const float width = 0.05f;
-
-    {
-        Mesh xAxisMesh;
-        xAxisMesh._vertices.push_back({{0, -width, 0}, {0,0}});
-        xAxisMesh._vertices.push_back({{0, width, 0}, {0,0}});
-        xAxisMesh._vertices.push_back({{length, width, 0}, {0,0}});
-        xAxisMesh._vertices.push_back({{length, -width, 0}, {0,0}});
-        xAxisMesh._indices = {0, 1, 2, 0, 2, 3};
-        
-        SubMesh submesh;
-        submesh.materialName = "debug_red";
-        submesh.firstIndex = 0;
-        submesh.indexCount = 6;
-        xAxisMesh._subMeshes.push_back(submesh);
-
-        create_mesh_buffers(xAxisMesh);
-        _meshes["debug_axis_x"] = xAxisMesh;
-
-        RenderObject axis_x_object;
-        axis_x_object.meshName = "debug_axis_x";
-        axis_x_object.transformMatrix = glm::mat4(1.0f);
-        _staticRenderables.push_back(axis_x_object);
+void VulkanApplication::build_static_batch() {
+    if (_staticRenderables.empty()) {
+        return;
     }
 
-    {
-        Mesh yAxisMesh;
-        yAxisMesh._vertices.push_back({{-width, 0, 0}, {0,0}});
-        yAxisMesh._vertices.push_back({{width, 0, 0}, {0,0}});
-        yAxisMesh._vertices.push_back({{width, length, 0}, {0,0}});
-        yAxisMesh._vertices.push_back({{-width, length, 0}, {0,0}});
-        yAxisMesh._indices = {0, 1, 2, 0, 2, 3};
-
-        SubMesh submesh;
-        submesh.materialName = "debug_green";
-        submesh.firstIndex = 0;
-        submesh.indexCount = 6;
-        yAxisMesh._subMeshes.push_back(submesh);
+    Mesh batch;
+    std::map<std::string, std::vector<uint32_t>> indices_by_material;
+    std::set<std::string> sourceMeshes;
+    size_t objectCount = 0;
 
-        create_mesh_buffers(yAxisMesh);
-        _meshes["debug_axis_y"] = yAxisMesh;
+    for (const RenderObject& renderable : _staticRenderables) {
+        auto mesh_it = _meshes.find(renderable.meshName);
+        if (mesh_it == _meshes.end()) {
+            continue;
+        }
+        const Mesh& mesh = mesh_it->second;
+        sourceMeshes.insert(renderable.meshName);
+        objectCount++;
+
+        const glm::mat4& transform = renderable.transformMatrix;
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+        // Mirroring transforms flip the winding, which back-face culling would see.
+        const bool mirrored = glm::determinant(glm::mat3(transform)) < 0.0f;
+        const uint32_t baseVertex = static_cast<uint32_t>(batch._vertices.size());
+        for (const Vertex& vertex : mesh._vertices) {
+            Vertex world = vertex;
+            world.pos = glm::vec3(transform * glm::vec4(vertex.pos, 1.0f));
+            glm::vec3 normal = normalMatrix * vertex.normal;
+            world.normal = glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : normal;
+            batch._vertices.push_back(world);
+        }
 
-        RenderObject axis_y_object;
-        axis_y_object.meshName = "debug_axis_y";
-        axis_y_object.transformMatrix = glm::mat4(1.0f);
-        _staticRenderables.push_back(axis_y_object);
+        // Only the full-resolution submeshes; the batch builds its own LOD chain.
+        size_t subMeshCount = mesh._lods.empty() ? mesh._subMeshes.size() : mesh._lods[0].subMeshCount;
+        for (size_t s = 0; s < subMeshCount; ++s) {
+            const SubMesh& submesh = mesh._subMeshes[s];
+            std::vector<uint32_t>& indices = indices_by_material[submesh.materialName];
+            for (uint32_t i = 0; i + 2 < submesh.indexCount; i += 3) {
+                const uint32_t* triangle = &mesh._indices[submesh.firstIndex + i];
+                indices.push_back(baseVertex + triangle[0]);
+                indices.push_back(baseVertex + triangle[mirrored ? 2 : 1]);
+                indices.push_back(baseVertex + triangle[mirrored ? 1 : 2]);
+            }
+        }
     }
 
-    {
-        Mesh zAxisMesh;
-        zAxisMesh._vertices.push_back({{-width, 0, 0}, {0,0}});
-        zAxisMesh._vertices.push_back({{width, 0, 0}, {0,0}});
-        zAxisMesh._vertices.push_back({{width, 0, length}, {0,0}});
-        zAxisMesh._vertices.push_back({{-width, 0, length}, {0,0}});
-        zAxisMesh._indices = {0, 1, 2, 0, 2, 3};
+    if (objectCount == 0) {
+        return;
+    }
 
+    std::vector<IndexRange> ranges;
+    for (const auto& [materialName, indices] : indices_by_material) {
         SubMesh submesh;
-        submesh.materialName = "debug_blue";
-        submesh.firstIndex = 0;
-        submesh.indexCount = 6;
-        zAxisMesh._subMeshes.push_back(submesh);
+        submesh.materialName = materialName;
+        submesh.firstIndex = static_cast<uint32_t>(batch._indices.size());
+        submesh.indexCount = static_cast<uint32_t>(indices.size());
+        batch._subMeshes.push_back(submesh);
+        batch._indices.insert(batch._indices.end(), indices.begin(), indices.end());
+        ranges.push_back({submesh.firstIndex, submesh.indexCount});
+    }
+    if (rendererSettings.aoRays > 0) {
+        bake_occlusion(batch);
+    }
+    // Full resolution only: one scene-wide bounding sphere would switch the whole table and lamp
+    // to a coarser level at once, and the batch stays close to the camera anyway.
+    build_mesh_lods(batch, ranges, 0);
+    create_mesh_buffers(batch);
+
+    // Source meshes nothing dynamic draws are no longer needed on the GPU.
+    std::set<std::string> dynamicMeshes;
+    for (const RenderObject& renderable : _dynamicRenderables) {
+        dynamicMeshes.insert(renderable.meshName);
+    }
+    for (const std::string& name : sourceMeshes) {
+        if (dynamicMeshes.count(name)) {
+            continue;
+        }
+        Mesh& mesh = _meshes.at(name);
+        vkDestroyBuffer(device, mesh._vertexBuffer, nullptr);
+        vkFreeMemory(device, mesh._vertexBufferMemory, nullptr);
+        vkDestroyBuffer(device, mesh._indexBuffer, nullptr);
+        vkFreeMemory(device, mesh._indexBufferMemory, nullptr);
+        _meshes.erase(name);
+    }
 
-        create_mesh_buffers(zAxisMesh);
-        _meshes["debug_axis_z"] = zAxisMesh;
+    std::cout << "[INFO] Static batch: " << objectCount << " objects (" << sourceMeshes.size() << " meshes) -> "
+              << batch._subMeshes.size() << " materials, " << batch._vertices.size() << " vertices, "
+              << batch._indices.size() / 3 << " triangles" << std::endl;
 
-        RenderObject axis_z_object;
-        axis_z_object.meshName = "debug_axis_z";
-        axis_z_object.transformMatrix = glm::mat4(1.0f);
-        _staticRenderables.push_back(axis_z_object);
-    }
+    _meshes[STATIC_BATCH_MESH] = batch;
+    RenderObject batch_object;
+    batch_object.meshName = STATIC_BATCH_MESH;
+    batch_object.transformMatrix = glm::mat4(1.0f);
+    _staticRenderables.assign(1, batch_object);
 }
 
-void VulkanApplication::draw_debug_vertical_line(glm::vec2 xz_pos, float height, const std::string& name, const std::string& materialName) {
-    const float width = 0.02f;
+void VulkanApplication::bake_occlusion(Mesh& mesh) {
+    auto start = std::chrono::high_resolution_clock::now();
+    TriangleBvh bvh;
+    bvh.build(mesh._vertices, mesh._indices);
+    double buildMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
 
-    Mesh lineMesh;
-    lineMesh._vertices.push_back({{xz_pos.x - width, 0.0f, xz_pos.y}, {0,0}});
-    lineMesh._vertices.push_back({{xz_pos.x + width, 0.0f, xz_pos.y}, {0,0}});
-    lineMesh._vertices.push_back({{xz_pos.x + width, height, xz_pos.y}, {0,0}});
-    lineMesh._vertices.push_back({{xz_pos.x - width, height, xz_pos.y}, {0,0}});
-    lineMesh._indices = {0, 1, 2, 0, 2, 3};
+    const uint32_t threadCount = parallel::resolve_thread_count(0);
+    start = std::chrono::high_resolution_clock::now();
+    mesh._occlusion = ao_bake::bake(mesh._vertices, bvh, rendererSettings.aoRays, AO_MAX_DISTANCE, threadCount);
+    double bakeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
 
-    SubMesh submesh;
-    submesh.materialName = materialName;
-    submesh.firstIndex = 0;
-    submesh.indexCount = 6;
-    lineMesh._subMeshes.push_back(submesh);
+    uint64_t openness = 0;
+    for (uint8_t value : mesh._occlusion) {
+        openness += value;
+    }
+    double meanOcclusion = mesh._occlusion.empty() ? 0.0 : 1.0 - openness / (255.0 * mesh._occlusion.size());
+    std::cout << "[INFO] Baked AO: " << mesh._vertices.size() << " vertices x " << rendererSettings.aoRays << " rays against "
+              << bvh.triangleCount() << " triangles (BVH " << bvh.nodeCount() << " nodes, depth " << bvh.depth() << ", " << buildMs
+              << " ms) in " << bakeMs << " ms on " << threadCount << " threads, mean occlusion " << meanOcclusion << std::endl;
+}
 
-    create_mesh_buffers(lineMesh);
-    _meshes[name] = lineMesh;
+void VulkanApplication::setup_lights() {
+    sceneLights.clear();
+    lightAnchors.clear();
+    // Placeholder for the lamp; publish_snapshot refreshes it from sceneLight every frame.
+    sceneLights.push_back({sceneLight.position, sceneLight.radius, glm::vec3(1.0f), sceneLight.intensity});
 
-    RenderObject line_object;
-    line_object.meshName = name;
-    line_object.transformMatrix = glm::mat4(1.0f);
-    _staticRenderables.push_back(line_object);
+    // The extras sit on a grid over the table, each with its own hue.
+    const uint32_t count = rendererSettings.extraLights;
+    if (count == 0) {
+        return;
+    }
+    const glm::vec2 extent = table_max_bounds - table_min_bounds;
+    const uint32_t columns = std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(count * extent.x / extent.y))));
+    const uint32_t rows = (count + columns - 1) / columns;
+    for (uint32_t i = 0; i < count; ++i) {
+        float u = (i % columns + 0.5f) / columns;
+        float v = (i / columns + 0.5f) / rows;
+        glm::vec3 anchor(table_min_bounds.x + u * extent.x, EXTRA_LIGHT_HEIGHT, table_min_bounds.y + v * extent.y);
+        float hue = std::fmod(i * 0.618034f, 1.0f) * 6.0f;
+        glm::vec3 color = glm::clamp(glm::vec3(std::fabs(hue - 3.0f) - 1.0f, 2.0f - std::fabs(hue - 2.0f), 2.0f - std::fabs(hue - 4.0f)), 0.0f, 1.0f);
+        lightAnchors.push_back(anchor);
+        sceneLights.push_back({anchor, 2.5f, color, 0.8f});
+    }
+    std::cout << "[INFO] Lights: lamp + " << count << " extra, clustered into " << light_clusters::GRID_X << "x" << light_clusters::GRID_Y
+              << "x" << light_clusters::GRID_Z << " froxels" << std::endl;
 }
 
-void VulkanApplication::create_debug_bounds_lines() {
-    _materials["debug_white"] = Material{{1.0f, 1.0f, 1.0f}};
+void VulkanApplication::update_lights(float deltaTime) {
+    if (lightAnchors.empty()) {
+        return;
+    }
+    lightTime += deltaTime;
+    for (size_t i = 0; i < lightAnchors.size(); ++i) {
+        float angle = lightTime * (0.5f + 0.1f * (i % 5)) + i;
+        sceneLights[i + 1].position = lightAnchors[i] + glm::vec3(std::cos(angle), 0.0f, std::sin(angle)) * EXTRA_LIGHT_ORBIT;
+    }
+}
 
-    const float lineHeight = 2.0f;
+void VulkanApplication::draw_debug_shapes(const FrameSnapshot& snapshot) {
+    DebugVertex* vertices = debugVertexMapped.empty() ? nullptr : static_cast<DebugVertex*>(debugVertexMapped[currentFrame]);
+    debugDraw.begin(vertices, DEBUG_DRAW_MAX_VERTICES);
+    if (!rendererSettings.debugDraw) {
+        return;
+    }
 
-    glm::vec2 min = table_min_bounds;
-    glm::vec2 max = table_max_bounds;
+    debugDraw.axes(glm::mat4(1.0f), 1.5f);
+    debugDraw.box(glm::vec3(table_min_bounds.x, 0.0f, table_min_bounds.y), glm::vec3(table_max_bounds.x, 2.0f, table_max_bounds.y),
+                  debug_color(1.0f, 1.0f, 1.0f));
+    debugDraw.sphere(snapshot.light.position, 0.1f, debug_color(1.0f, 0.9f, 0.3f));
+    debugDraw.sphere(snapshot.light.position, snapshot.light.radius, debug_color(1.0f, 0.9f, 0.3f, 0.3f), 48);
 
-    glm::vec2 p1 = {min.x, min.y};
-    glm::vec2 p2 = {max.x, min.y};
-    glm::vec2 p3 = {max.x, max.y};
-    glm::vec2 p4 = {min.x, max.y};
+    // Each ball keeps its last DEBUG_TRAIL_LENGTH rendered positions, oldest first.
+    size_t ballCount = std::min(balls.size(), snapshot.dynamicTransforms.size());
+    if (debugTrails.size() != ballCount * DEBUG_TRAIL_LENGTH) {
+        debugTrails.resize(ballCount * DEBUG_TRAIL_LENGTH);
+        for (size_t i = 0; i < ballCount; ++i) {
+            std::fill_n(&debugTrails[i * DEBUG_TRAIL_LENGTH], DEBUG_TRAIL_LENGTH, glm::vec3(snapshot.dynamicTransforms[i][3]));
+        }
+    }
+    for (size_t i = 0; i < ballCount; ++i) {
+        glm::vec3 position = glm::vec3(snapshot.dynamicTransforms[i][3]);
+        glm::vec3* trail = &debugTrails[i * DEBUG_TRAIL_LENGTH];
+        std::copy(trail + 1, trail + DEBUG_TRAIL_LENGTH, trail);
+        trail[DEBUG_TRAIL_LENGTH - 1] = position;
+        debugDraw.trajectory(trail, DEBUG_TRAIL_LENGTH, debug_color(0.2f, 0.8f, 1.0f));
+        debugDraw.sphere(position, BALL_RADIUS, debug_color(0.2f, 1.0f, 0.2f), 12);
+    }
 
-    draw_debug_vertical_line(p1, lineHeight, "debug_line_1", "debug_white");
-    draw_debug_vertical_line(p2, lineHeight, "debug_line_2", "debug_white");
-    draw_debug_vertical_line(p3, lineHeight, "debug_line_3", "debug_white");
-    draw_debug_vertical_line(p4, lineHeight, "debug_line_4", "debug_white");
+    if (debugDraw.droppedVertices() > 0 && !debugBudgetWarned) {
+        debugBudgetWarned = true;
+        std::cerr << "[ERROR] Debug draw budget of " << DEBUG_DRAW_MAX_VERTICES << " vertices exceeded; "
+                  << debugDraw.droppedVertices() << " vertices dropped this frame." << std::endl;
+    }
 }
 
 void VulkanApplication::update_scene(float deltaTime) {
-    glm::vec3 scale_vector(MODEL_SCALE);
-    glm::mat4 y_to_z_up_rotation = glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    PROFILE_FUNCTION();
+    _changedRenderables.clear();
+    update_lights(deltaTime);
 
     if (_dynamicRenderables.size() != balls.size() + 1) {
         return;
     }
 
+    _ballTransforms.resize(balls.size());
     for (size_t i = 0; i < balls.size(); ++i) {
-        const PoolBall& ball_phys = balls[i];
-        RenderObject& ball_renderable = _dynamicRenderables[i];
+        if (ballTransformDirty[i]) {
+            const PoolBall& ball_phys = balls[i];
+            _ballTransforms.set(i, glm::vec3(ball_phys.position.x, BALL_RADIUS, ball_phys.position.y), ball_phys.rotation, MODEL_SCALE);
+        }
+    }
+
+    // Each run of consecutive dirty balls is composed in one batch, straight into the renderables.
+    size_t i = 0;
+    while (i < balls.size()) {
+        if (!ballTransformDirty[i]) {
+            ++i;
+            continue;
+        }
+        size_t runStart = i;
+        for (; i < balls.size() && ballTransformDirty[i]; ++i) {
+            ballTransformDirty[i] = 0;
+            _changedRenderables.push_back(static_cast<uint32_t>(i));
+        }
+        transform_batch::compose(_ballTransforms, runStart, i - runStart, &_dynamicRenderables[runStart].transformMatrix,
+                                 sizeof(RenderObject), TransformLayout::Mat4);
+    }
 
-        glm::vec3 ball_position_3d = glm::vec3(ball_phys.position.x, BALL_RADIUS, ball_phys.position.y);
-        glm::mat4 translation_matrix = glm::translate(glm::mat4(1.0f), ball_position_3d);
-        glm::mat4 rotation_matrix = glm::mat4_cast(ball_phys.rotation);
-        glm::mat4 scale_matrix = glm::scale(glm::mat4(1.0f), scale_vector);
-        ball_renderable.transformMatrix = translation_matrix * rotation_matrix * scale_matrix;
+    // The cue follows the resting cue ball and the aim angle, and is parked off-table while
+    // the cue ball rolls; rebuild it only when one of those inputs changed.
+    bool cueHidden = balls[0].is_moving;
+    bool cueMoved = !_changedRenderables.empty() && _changedRenderables.front() == 0;
+    if (!cueTransformDirty && cueHidden == cueWasHidden && cue.angle == cueAngleAtUpdate && (cueHidden || !cueMoved)) {
+        return;
     }
+    cueTransformDirty = false;
+    cueWasHidden = cueHidden;
+    cueAngleAtUpdate = cue.angle;
 
     RenderObject& cue_renderable = _dynamicRenderables.back();
 
-    if (!balls[0].is_moving) {
+    if (!cueHidden) {
         const PoolBall& cue_ball_phys = balls[0];
         glm::vec3 cue_ball_pos_3d = glm::vec3(cue_ball_phys.position.x, BALL_RADIUS, cue_ball_phys.position.y);
 
-        glm::mat4 scale_matrix = glm::scale(glm::mat4(1.0f), scale_vector);
-        glm::mat4 base_transform = y_to_z_up_rotation * scale_matrix;
+        glm::mat4 base_transform = _yToZUpRotation * _modelScaleMatrix;
 
         glm::mat4 gameplay_rotation = glm::rotate(glm::mat4(1.0f), cue.angle, glm::vec3(0.0f, 1.0f, 0.0f));
 
@@ -717,6 +1137,7 @@ void VulkanApplication::update_scene(float deltaTime) {
     } else {
         cue_renderable.transformMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(100.0f));
     }
+    _changedRenderables.push_back(static_cast<uint32_t>(_dynamicRenderables.size() - 1));
 }
 
 void VulkanApplication::initVulkan() {
@@ -725,14 +1146,21 @@ void VulkanApplication::initVulkan() {
     std::cout << "       - Instance created." << std::endl;
     setupDebugMessenger();
     std::cout << "       - Debug messenger set up." << std::endl;
-    createSurface();
-    std::cout << "       - Surface created." << std::endl;
+    if (!headless) {
+        createSurface();
+        std::cout << "       - Surface created." << std::endl;
+    }
     pickPhysicalDevice();
     std::cout << "       - Physical device picked." << std::endl;
     createLogicalDevice();
     std::cout << "       - Logical device created." << std::endl;
-    createSwapChain();
-    std::cout << "       - Swap chain created." << std::endl;
+    if (headless) {
+        createOffscreenTargets();
+        std::cout << "       - Offscreen targets created." << std::endl;
+    } else {
+        createSwapChain();
+        std::cout << "       - Swap chain created." << std::endl;
+    }
     createImageViews();
     std::cout << "       - Image views created." << std::endl;
     createRenderPass();
@@ -747,16 +1175,31 @@ void VulkanApplication::initVulkan() {
     std::cout << "       - Depth resources created." << std::endl;
     createFramebuffers();
     std::cout << "       - Framebuffers created." << std::endl;
+    textureCache.init(physicalDevice, device, graphicsQueue, findQueueFamilies(physicalDevice).graphicsFamily.value(), textureSetLayout,
+                      static_cast<VkDeviceSize>(rendererSettings.textureBudgetMB) * 1024 * 1024, maxFramesInFlight,
+                      textureCompressionSupported, rendererSettings.loadBakedTextures);
+    std::cout << "       - Texture cache created." << std::endl;
 
     _materials["default"] = Material();
     std::cout << "       - Default material created." << std::endl;
     setupPoolTable();
     std::cout << "       - Pool table set up." << std::endl;
     setup_scene();
+    setup_lights();
     std::cout << "       - Scene set up." << std::endl;
+    if (rendererSettings.staticBatching) {
+        build_static_batch();
+    }
+    createImpostorResources();
+    reportMeshMemory();
 
     createUniformBuffers();
     std::cout << "       - Uniform buffers created." << std::endl;
+    createMaterialTable();
+    createDrawDataBuffers();
+    std::cout << "       - Material table and draw data buffers created." << std::endl;
+    createDebugDrawResources();
+    createShadowResources();
     createDescriptorPool();
     std::cout << "       - Descriptor pool created." << std::endl;
     createDescriptorSets();
@@ -765,30 +1208,370 @@ void VulkanApplication::initVulkan() {
     std::cout << "       - Command buffer created." << std::endl;
     createSyncObjects();
     std::cout << "       - Sync objects created." << std::endl;
+    gpuQueries.init(device, physicalDevice, findQueueFamilies(physicalDevice).graphicsFamily.value(), maxFramesInFlight, pipelineStatisticsSupported);
+    std::cout << "       - GPU query pools created." << std::endl;
+    if (captureEnabled) {
+        createCaptureResources();
+        captureEncoder.start(rendererSettings.captureDirectory, rendererSettings.captureFormat, static_cast<uint32_t>(captureBuffers.size()));
+        std::cout << "       - Capture resources created." << std::endl;
+    }
     std::cout << "[INFO] Vulkan initialized successfully." << std::endl;
 }
 void VulkanApplication::mainLoop(){
-    static auto lastTime = std::chrono::high_resolution_clock::now();
-    
-    while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
+    auto lastTime = std::chrono::high_resolution_clock::now();
+    auto lastReport = lastTime;
+
+    profiler::set_thread_name("Simulation");
+    if (!rendererSettings.recordInput.empty()) {
+        inputRecorder.open(rendererSettings.recordInput);
+    }
+    publish_snapshot();
+    renderStartTime = std::chrono::steady_clock::now();
+    renderThreadRunning = true;
+    renderThread = std::thread(&VulkanApplication::renderLoop, this);
+
+    while (renderThreadRunning) {
+        if (headless) {
+            if (renderFrames >= rendererSettings.frameCount) {
+                break;
+            }
+        } else if (glfwWindowShouldClose(window) || (rendererSettings.frameCount > 0 && renderFrames >= rendererSettings.frameCount)) {
+            break;
+        }
+
+        auto tickStart = std::chrono::high_resolution_clock::now();
+        if (!headless) {
+            glfwPollEvents();
+        }
         
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        float deltaTime = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - lastTime).count();
-        lastTime = currentTime;
+        float deltaTime = std::chrono::duration<float, std::chrono::seconds::period>(tickStart - lastTime).count();
+        lastTime = tickStart;
         
         if (deltaTime > 0.05f) {
             deltaTime = 0.05f;
         }
         
-        processInput(deltaTime);
+        InputFrame input{0, deltaTime};
+        if (!headless) {
+            input.keys = sampleInput();
+            processInput(deltaTime, input);
+        }
+        if (inputRecorder.isOpen()) {
+            inputRecorder.write(input);
+        }
         updatePhysics(deltaTime);
         update_scene(deltaTime);
-        
+        publish_snapshot();
+
+        auto tickEnd = std::chrono::high_resolution_clock::now();
+        simFrameMs.store(std::chrono::duration<float, std::milli>(tickEnd - tickStart).count(), std::memory_order_relaxed);
+        simTicks.fetch_add(1, std::memory_order_relaxed);
+
+        if (tickEnd - lastReport >= TIMING_REPORT_INTERVAL) {
+            FrameTimings timings = consumeFrameTimings();
+            std::cout << "[PERF] Sim: " << timings.simMs << " ms/tick (" << timings.simTicks << " ticks) | Render: "
+                      << timings.renderMs << " ms/frame (" << timings.renderFrames << " frames) | Input->present: "
+                      << timings.inputToPresentMs << " ms avg, " << timings.inputToPresentMaxMs << " ms max" << std::endl;
+            std::cout << "[PERF] Triangles: " << timings.triangles << "/frame | Objects per LOD: " << timings.objectsPerLod[0];
+            for (uint32_t lod = 1; lod < MAX_MESH_LODS; ++lod) {
+                std::cout << "/" << timings.objectsPerLod[lod];
+            }
+            std::cout << " | Draws: " << timings.drawCalls << " (" << timings.indirectCalls << " indirect) | Binds: "
+                      << timings.pipelineBinds << " pipeline, " << timings.bufferBinds << " buffer | Static commands recorded: "
+                      << timings.staticCommandRecords << " | Shadow renders: " << timings.staticShadowRenders << " static, "
+                      << timings.shadowRenders << " composited";
+            if (rendererSettings.ballImpostors) {
+                std::cout << " | Impostors: " << timings.impostors;
+            }
+            std::cout << std::endl;
+            std::cout << "[PERF] Lights: " << timings.lights << " (" << timings.visibleLights << " in view) | Clusters: " << timings.litClusters
+                      << "/" << light_clusters::CLUSTER_COUNT << " lit, " << timings.maxClusterLights << " lights max, "
+                      << timings.lightIndices << " light indices" << std::endl;
+            gpuQueries.printReport();
+            textureCache.printReport();
+            if (captureEnabled) {
+                reportCaptureStats();
+            }
+            lastReport = tickEnd;
+        }
+
+        std::this_thread::sleep_until(tickStart + SIM_TICK_INTERVAL);
+    }
+
+    renderThreadRunning = false;
+    renderThread.join();
+    vkDeviceWaitIdle(device);
+
+    if (inputRecorder.isOpen()) {
+        inputRecorder.close();
+        std::cout << "[INFO] Recorded " << inputRecorder.frameCount() << " input frames to " << rendererSettings.recordInput
+                  << " (ball state checksum " << std::hex << ballStateChecksum() << std::dec << ")" << std::endl;
+    }
+
+    if (captureEnabled) {
+        pollCaptures();
+        captureEncoder.stop();
+        reportCaptureStats();
+    }
+
+    if (profiler::is_enabled()) {
+        dumpProfilerTrace();
+    }
+
+    if (renderThreadError) {
+        std::rethrow_exception(renderThreadError);
+    }
+}
+
+void VulkanApplication::benchLoop() {
+    BenchScript script = rendererSettings.benchScript.empty() ? bench::default_script() : bench::load_script(rendererSettings.benchScript);
+    const uint32_t frames = rendererSettings.frameCount;
+    const float deltaTime = rendererSettings.benchTimestep;
+
+    std::cout << "[INFO] Benchmark: script '" << script.name << "', " << frames << " frames at dt " << deltaTime << " s" << std::endl;
+
+    profiler::set_thread_name("Bench");
+    gpuQueries.setHistoryCapacity(frames);
+    RollingStats cpuFrameStats(frames);
+    RollingStats physicsStats(frames);
+    double drawCalls = 0.0, triangles = 0.0, pipelineBinds = 0.0, vertexBufferBinds = 0.0, indexBufferBinds = 0.0, indirectCalls = 0.0;
+    size_t nextShot = 0;
+
+    // Simulation and rendering run in lockstep on this thread, so every run simulates and
+    // draws exactly the same frames regardless of how fast the machine is.
+    renderStartTime = std::chrono::steady_clock::now();
+    uint32_t frame = 0;
+    for (; frame < frames; ++frame) {
+        if (!headless) {
+            glfwPollEvents();
+            if (glfwWindowShouldClose(window)) {
+                break;
+            }
+        }
+
+        auto frameStart = std::chrono::high_resolution_clock::now();
+        applyBenchEvents(script, frame, deltaTime, nextShot);
+
+        auto physicsStart = std::chrono::high_resolution_clock::now();
+        updatePhysics(deltaTime);
+        physicsStats.add(std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - physicsStart).count());
+
+        update_scene(deltaTime);
+        publish_snapshot();
         drawFrame();
+
+        cpuFrameStats.add(std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - frameStart).count());
+        renderFrames.fetch_add(1, std::memory_order_relaxed);
+
+        drawCalls += frameDrawStats.drawCalls;
+        triangles += frameDrawStats.triangles;
+        pipelineBinds += frameDrawStats.pipelineBinds;
+        vertexBufferBinds += frameDrawStats.vertexBufferBinds;
+        indexBufferBinds += frameDrawStats.indexBufferBinds;
+        indirectCalls += frameDrawStats.indirectCalls;
     }
-    
+
+    vkDeviceWaitIdle(device);
+    for (uint32_t slot = 0; slot < maxFramesInFlight; slot++) {
+        gpuQueries.collect(slot);
+    }
+    double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - renderStartTime).count();
+
+    if (captureEnabled) {
+        pollCaptures();
+        captureEncoder.stop();
+        reportCaptureStats();
+    }
+    if (profiler::is_enabled()) {
+        dumpProfilerTrace();
+    }
+
+    GpuFrameStats gpu = gpuQueries.stats();
+    double frameCount = std::max<uint32_t>(frame, 1);
+
+    BenchResults results;
+    results.script = script.name;
+    results.frames = frame;
+    results.timestep = deltaTime;
+    results.headless = headless;
+    results.width = swapChainExtent.width;
+    results.height = swapChainExtent.height;
+    results.framesInFlight = maxFramesInFlight;
+    results.presentMode = headless ? "none" : settings::present_mode_name(rendererSettings.presentMode);
+    results.wallTimeSeconds = wallTime;
+    results.shotsFired = static_cast<uint32_t>(nextShot);
+    results.cpuFrameMs = cpuFrameStats.summarize();
+    results.physicsMs = physicsStats.summarize();
+    results.gpuTimestamps = gpu.timestamps && gpu.samples > 0;
+    results.gpuFrameMs = gpu.passMs;
+    results.gpuStaticMs = gpu.staticMs;
+    results.gpuDynamicMs = gpu.dynamicMs;
+    results.gpuStatistics = gpu.pipelineStatistics && gpu.samples > 0;
+    results.staticVertexInvocations = gpu.vertexInvocations[DRAW_GROUP_STATIC];
+    results.staticFragmentInvocations = gpu.fragmentInvocations[DRAW_GROUP_STATIC];
+    results.dynamicVertexInvocations = gpu.vertexInvocations[DRAW_GROUP_DYNAMIC];
+    results.dynamicFragmentInvocations = gpu.fragmentInvocations[DRAW_GROUP_DYNAMIC];
+    results.drawCalls = drawCalls / frameCount;
+    results.triangles = triangles / frameCount;
+    results.pipelineBinds = pipelineBinds / frameCount;
+    results.vertexBufferBinds = vertexBufferBinds / frameCount;
+    results.indexBufferBinds = indexBufferBinds / frameCount;
+    results.indirectCalls = indirectCalls / frameCount;
+
+    std::cout << "[BENCH] " << frame << " frames in " << wallTime << " s | CPU frame: p50 " << results.cpuFrameMs.p50
+              << " / p95 " << results.cpuFrameMs.p95 << " / p99 " << results.cpuFrameMs.p99 << " ms | Physics: "
+              << results.physicsMs.average << " ms avg | Draws: " << results.drawCalls << "/frame" << std::endl;
+    if (results.gpuTimestamps) {
+        std::cout << "[BENCH] GPU frame: p50 " << gpu.passMs.p50 << " / p95 " << gpu.passMs.p95 << " / p99 " << gpu.passMs.p99 << " ms" << std::endl;
+    }
+
+    if (bench::write_results(rendererSettings.benchOutput, results)) {
+        std::cout << "[INFO] Benchmark results written to " << rendererSettings.benchOutput << std::endl;
+    } else {
+        throw std::runtime_error("failed to write benchmark results " + rendererSettings.benchOutput);
+    }
+}
+
+void VulkanApplication::replayLoop() {
+    InputReplay replay;
+    replay.open(rendererSettings.replayInput);
+    std::cout << "[INFO] Replaying input from " << rendererSettings.replayInput << std::endl;
+
+    profiler::set_thread_name("Replay");
+    renderStartTime = std::chrono::steady_clock::now();
+
+    // The simulation sees exactly the recorded keys and timesteps, so ball trajectories match
+    // the recorded session. Every tick is drawn, which makes the frame workload repeatable too.
+    InputFrame input;
+    while (rendererSettings.frameCount == 0 || renderFrames < rendererSettings.frameCount) {
+        if (!headless) {
+            glfwPollEvents();
+            if (glfwWindowShouldClose(window)) {
+                break;
+            }
+        }
+        if (!replay.next(input)) {
+            break;
+        }
+
+        auto tickStart = std::chrono::high_resolution_clock::now();
+        lastInputSampleTime = std::chrono::steady_clock::now();
+        processInput(input.deltaTime, input);
+        updatePhysics(input.deltaTime);
+        update_scene(input.deltaTime);
+        publish_snapshot();
+        auto tickEnd = std::chrono::high_resolution_clock::now();
+        simFrameMs.store(std::chrono::duration<float, std::milli>(tickEnd - tickStart).count(), std::memory_order_relaxed);
+        simTicks.fetch_add(1, std::memory_order_relaxed);
+
+        drawFrame();
+        renderFrameMs.store(std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - tickEnd).count(), std::memory_order_relaxed);
+        renderFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+
     vkDeviceWaitIdle(device);
+    std::cout << "[INFO] Replayed " << replay.frameCount() << " input frames (ball state checksum "
+              << std::hex << ballStateChecksum() << std::dec << ")" << std::endl;
+    gpuQueries.printReport();
+
+    if (captureEnabled) {
+        pollCaptures();
+        captureEncoder.stop();
+        reportCaptureStats();
+    }
+    if (profiler::is_enabled()) {
+        dumpProfilerTrace();
+    }
+}
+
+uint64_t VulkanApplication::ballStateChecksum() const {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+
+    for (const PoolBall& ball : balls) {
+        mix(&ball.position, sizeof(ball.position));
+        mix(&ball.velocity, sizeof(ball.velocity));
+        mix(&ball.rotation, sizeof(ball.rotation));
+    }
+    return hash;
+}
+
+void VulkanApplication::applyBenchEvents(const BenchScript& script, uint32_t frame, float deltaTime, size_t& nextShot) {
+    for (const BenchEvent& event : script.events) {
+        switch (event.type) {
+            case BenchEventType::Camera:
+                if (frame == event.frame) {
+                    cameraYaw = glm::radians(event.values[0]);
+                    cameraPitch = glm::clamp(glm::radians(event.values[1]), glm::radians(5.0f), glm::radians(85.0f));
+                    cameraDistance = glm::clamp(event.values[2], 2.0f, 50.0f);
+                }
+                break;
+            case BenchEventType::Orbit:
+                if (frame >= event.frame && frame < event.endFrame) {
+                    cameraYaw += glm::radians(event.values[0]) * deltaTime;
+                }
+                break;
+            case BenchEventType::Rack:
+                if (frame == event.frame) {
+                    setupPoolTable();
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (nextShot < script.shots.size() && script.shots[nextShot].frame <= frame && !balls[0].is_moving) {
+        const BenchEvent& shot = script.shots[nextShot++];
+        cue.angle = glm::radians(shot.values[0]);
+        cue.power = shot.values[1];
+        glm::vec2 direction = {-1 * glm::cos(cue.angle), glm::sin(cue.angle)};
+        balls[0].velocity = direction * cue.power;
+        balls[0].is_moving = true;
+    }
+}
+
+void VulkanApplication::renderLoop() {
+    profiler::set_thread_name("Render");
+
+    try {
+        while (renderThreadRunning) {
+            auto frameStart = std::chrono::high_resolution_clock::now();
+            drawFrame();
+            auto frameEnd = std::chrono::high_resolution_clock::now();
+            renderFrameMs.store(std::chrono::duration<float, std::milli>(frameEnd - frameStart).count(), std::memory_order_relaxed);
+            renderFrames.fetch_add(1, std::memory_order_relaxed);
+        }
+    } catch (...) {
+        renderThreadError = std::current_exception();
+        renderThreadRunning = false;
+    }
+}
+
+void VulkanApplication::publish_snapshot() {
+    PROFILE_FUNCTION();
+    FrameSnapshot& snapshot = _snapshots.back();
+
+    snapshot.dynamicTransforms.resize(_dynamicRenderables.size());
+    for (size_t i = 0; i < _dynamicRenderables.size(); ++i) {
+        snapshot.dynamicTransforms[i] = _dynamicRenderables[i].transformMatrix;
+    }
+    snapshot.camera = {cameraYaw, cameraPitch, cameraDistance};
+    snapshot.light = sceneLight;
+    snapshot.lights = sceneLights;
+    // Lighting and the shadow map both follow sceneLight.
+    snapshot.lights[0].position = sceneLight.position;
+    snapshot.lights[0].radius = sceneLight.radius;
+    snapshot.lights[0].intensity = sceneLight.intensity;
+    snapshot.simTick = ++simTickCounter;
+    snapshot.inputSampleTime = lastInputSampleTime;
+
+    _snapshots.publish();
 }
 
 void VulkanApplication::createInstance() {
@@ -801,7 +1584,8 @@ void VulkanApplication::createInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "MarioRender";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // 1.2 for descriptor indexing, which the bindless texture array needs.
+    appInfo.apiVersion = VK_API_VERSION_1_2;
     
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -877,6 +1661,7 @@ void VulkanApplication::createLogicalDevice() {
     
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+    std::vector<const char*> deviceExtensions = getRequiredDeviceExtensions();
     
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -888,10 +1673,30 @@ void VulkanApplication::createLogicalDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
     
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    pipelineStatisticsSupported = supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+    textureCompressionSupported = supportedFeatures.textureCompressionBC == VK_TRUE;
+    indirectDrawSupported = supportedFeatures.multiDrawIndirect == VK_TRUE && supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+    deviceFeatures.multiDrawIndirect = indirectDrawSupported ? VK_TRUE : VK_FALSE;
+    deviceFeatures.drawIndirectFirstInstance = indirectDrawSupported ? VK_TRUE : VK_FALSE;
+
+    // Checked by isDeviceSuitable.
+    VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+    indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = &indexingFeatures;
     
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
@@ -924,6 +1729,9 @@ void VulkanApplication::createSwapChain() {
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
     uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+    if (rendererSettings.swapchainImages > 0) {
+        imageCount = std::max(rendererSettings.swapchainImages, swapChainSupport.capabilities.minImageCount);
+    }
     if(swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
         imageCount = swapChainSupport.capabilities.maxImageCount;
     }
@@ -937,6 +1745,12 @@ void VulkanApplication::createSwapChain() {
     createInfo.imageExtent = extent;
     createInfo.imageArrayLayers = 1;
     createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    if (captureEnabled) {
+        if (!(swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+            throw std::runtime_error("swap chain images cannot be copied from, frame capture is unavailable.");
+        }
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
 
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
     uint32_t queueFamilyIndices[] = {indices.graphicsFamily.value(), indices.presentFamily.value()};
@@ -967,6 +1781,28 @@ void VulkanApplication::createSwapChain() {
 
     swapChainImageFormat = surfaceFormat.format;
     swapChainExtent = extent;
+
+    std::cout << "[INFO] Swap chain: " << imageCount << " images, present mode " << settings::present_mode_name(presentMode)
+              << ", " << maxFramesInFlight << " frames in flight." << std::endl;
+}
+
+void VulkanApplication::createOffscreenTargets() {
+    uint32_t targetCount = std::max(rendererSettings.offscreenTargets, maxFramesInFlight);
+
+    swapChainImageFormat = OFFSCREEN_COLOR_FORMAT;
+    swapChainExtent = {rendererSettings.width, rendererSettings.height};
+    swapChainImages.resize(targetCount);
+    offscreenImagesMemory.resize(targetCount);
+
+    for (uint32_t i = 0; i < targetCount; i++) {
+        createImage(swapChainExtent.width, swapChainExtent.height, swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL,
+                    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                    swapChainImages[i], offscreenImagesMemory[i]);
+    }
+    nextOffscreenTarget = 0;
+
+    std::cout << "[INFO] Headless: " << targetCount << " offscreen targets of " << swapChainExtent.width << "x" << swapChainExtent.height
+              << ", " << maxFramesInFlight << " frames in flight." << std::endl;
 }
 
 void VulkanApplication::createImageViews() {
@@ -994,7 +1830,7 @@ void VulkanApplication::createRenderPass() {
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
     
     VkAttachmentReference colorAttachmentRef{};
     colorAttachmentRef.attachment = 0;
@@ -1027,6 +1863,17 @@ void VulkanApplication::createRenderPass() {
     dependency.srcAccessMask = 0;
     dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
     dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    // Makes the color writes visible to the capture copy recorded after the render pass.
+    VkSubpassDependency captureDependency{};
+    captureDependency.srcSubpass = 0;
+    captureDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+    captureDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    captureDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    captureDependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    captureDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    std::array<VkSubpassDependency, 2> dependencies = {dependency, captureDependency};
     
     std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
     
@@ -1036,8 +1883,8 @@ void VulkanApplication::createRenderPass() {
     renderPassInfo.pAttachments = attachments.data();
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
+    renderPassInfo.dependencyCount = captureEnabled ? 2 : 1;
+    renderPassInfo.pDependencies = dependencies.data();
     
     if(vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
         throw std::runtime_error("failed to create render pass.");
@@ -1045,10 +1892,22 @@ void VulkanApplication::createRenderPass() {
 }  
 
 void VulkanApplication::createDescriptorSetLayout() {
-    VkDescriptorSetLayoutBinding uboLayoutBinding = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0);
-    VkDescriptorSetLayoutBinding lightLayoutBinding = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1);
-
-    std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, lightLayoutBinding};
+    // impostor.frag ray-traces from the camera, so it reads the matrices too.
+    VkDescriptorSetLayoutBinding uboLayoutBinding = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0);
+    VkDescriptorSetLayoutBinding objectsBinding = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 2);
+    VkDescriptorSetLayoutBinding drawsBinding = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 3);
+    VkDescriptorSetLayoutBinding materialsBinding = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 4);
+    VkDescriptorSetLayoutBinding impostorsBinding = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 5);
+    VkDescriptorSetLayoutBinding markingsBinding = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 6);
+    VkDescriptorSetLayoutBinding lightsBinding = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 7);
+    VkDescriptorSetLayoutBinding clustersBinding = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 8);
+    VkDescriptorSetLayoutBinding lightIndicesBinding = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 9);
+    VkDescriptorSetLayoutBinding shadowMapBinding = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 10);
+
+    // Binding 1 is unused; the lamp is the first entry of the lights at binding 7.
+    std::array<VkDescriptorSetLayoutBinding, 10> bindings = {uboLayoutBinding, objectsBinding, drawsBinding, materialsBinding,
+                                                             impostorsBinding, markingsBinding, lightsBinding, clustersBinding, lightIndicesBinding,
+                                                             shadowMapBinding};
 
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -1058,6 +1917,27 @@ void VulkanApplication::createDescriptorSetLayout() {
     if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor set layout.");
     }
+
+    // Textures are written as they stream in, while earlier frames using other slots are in flight.
+    VkDescriptorSetLayoutBinding textureBinding = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0);
+    textureBinding.descriptorCount = MAX_TEXTURES;
+    VkDescriptorBindingFlags textureBindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                                   VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = 1;
+    bindingFlagsInfo.pBindingFlags = &textureBindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo textureLayoutInfo{};
+    textureLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    textureLayoutInfo.pNext = &bindingFlagsInfo;
+    textureLayoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    textureLayoutInfo.bindingCount = 1;
+    textureLayoutInfo.pBindings = &textureBinding;
+
+    if (vkCreateDescriptorSetLayout(device, &textureLayoutInfo, nullptr, &textureSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create texture descriptor set layout.");
+    }
 }
 
 void VulkanApplication::createGraphicsPipeline() {
@@ -1071,8 +1951,20 @@ void VulkanApplication::createGraphicsPipeline() {
     VkPipelineShaderStageCreateInfo fragShaderStageInfo = vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderModule);
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    // The packed variant only changes the vertex formats; shader.vert decodes the octahedral
+    // normal when the PACKED_NORMALS specialization constant is set.
+    const bool packed = rendererSettings.packedVertices;
+    auto bindingDescription = packed ? PackedVertex::getBindingDescription() : Vertex::getBindingDescription();
+    auto attributeDescriptions = packed ? PackedVertex::getAttributeDescriptions() : Vertex::getAttributeDescriptions();
+
+    VkBool32 packedNormals = packed ? VK_TRUE : VK_FALSE;
+    VkSpecializationMapEntry specializationEntry{0, 0, sizeof(VkBool32)};
+    VkSpecializationInfo specializationInfo{};
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &specializationEntry;
+    specializationInfo.dataSize = sizeof(packedNormals);
+    specializationInfo.pData = &packedNormals;
+    shaderStages[0].pSpecializationInfo = &specializationInfo;
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -1107,17 +1999,11 @@ void VulkanApplication::createGraphicsPipeline() {
     dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
     dynamicState.pDynamicStates = dynamicStates.data();
 
-    VkPushConstantRange pushConstantRange{};
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    pushConstantRange.offset = 0;
-    pushConstantRange.size = sizeof(GPUDrawPushConstants);
-
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    std::array<VkDescriptorSetLayout, 2> setLayouts = {descriptorSetLayout, textureSetLayout};
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
 
     if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
         throw std::runtime_error("failed to create pipeline layout!");
@@ -1143,6 +2029,46 @@ void VulkanApplication::createGraphicsPipeline() {
         throw std::runtime_error("failed to create graphics pipeline.");
     }
 
+    // Translucent draws blend over what is behind them and test against, but never write, depth.
+    depthStencil = vkinit::depth_stencil_create_info(true, false, VK_COMPARE_OP_LESS);
+    colorBlendAttachment.blendEnable = VK_TRUE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    if(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &translucentPipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create translucent graphics pipeline.");
+    }
+
+    vkDestroyShaderModule(device, fragShaderModule, nullptr);
+    vkDestroyShaderModule(device, vertShaderModule, nullptr);
+
+    // The baked AO variant is opaque again and adds the per-vertex UNORM8 occlusion stream,
+    // compiled from the same shaders with BAKED_AO defined.
+    auto aoVertShaderCode = readFile("shaders/vert_ao.spv");
+    auto aoFragShaderCode = readFile("shaders/frag_ao.spv");
+    vertShaderModule = createShaderModule(aoVertShaderCode);
+    fragShaderModule = createShaderModule(aoFragShaderCode);
+    shaderStages[0].module = vertShaderModule;
+    shaderStages[1].module = fragShaderModule;
+
+    std::array<VkVertexInputBindingDescription, 2> aoBindings = {bindingDescription, VkVertexInputBindingDescription{1, sizeof(uint8_t), VK_VERTEX_INPUT_RATE_VERTEX}};
+    std::vector<VkVertexInputAttributeDescription> aoAttributes(attributeDescriptions.begin(), attributeDescriptions.end());
+    aoAttributes.push_back({3, 1, VK_FORMAT_R8_UNORM, 0});
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(aoBindings.size());
+    vertexInputInfo.pVertexBindingDescriptions = aoBindings.data();
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(aoAttributes.size());
+    vertexInputInfo.pVertexAttributeDescriptions = aoAttributes.data();
+    depthStencil = vkinit::depth_stencil_create_info(true, true, VK_COMPARE_OP_LESS);
+    colorBlendAttachment = vkinit::color_blend_attachment_state();
+
+    if(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &bakedAoPipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create baked AO graphics pipeline.");
+    }
+
     vkDestroyShaderModule(device, fragShaderModule, nullptr);
     vkDestroyShaderModule(device, vertShaderModule, nullptr);
 }
@@ -1184,65 +2110,570 @@ void VulkanApplication::createFramebuffers() {
 void VulkanApplication::createUniformBuffers() {
     VkDeviceSize bufferSize = sizeof(UniformBufferObject);
     
-    uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-    uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+    uniformBuffers.resize(maxFramesInFlight);
+    uniformBuffersMemory.resize(maxFramesInFlight);
+    uniformBuffersMapped.resize(maxFramesInFlight);
     
-    for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for(size_t i = 0; i < maxFramesInFlight; i++) {
         createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
         vkMapMemory(device, uniformBuffersMemory[i], 0, bufferSize, 0, &uniformBuffersMapped[i]);
     }
-
-    VkDeviceSize lightBufferSize = sizeof(Light);
-    createBuffer(lightBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, lightBuffer, lightBufferMemory);
-    vkMapMemory(device, lightBufferMemory, 0, lightBufferSize, 0, &lightBufferMapped);
 }
 
-void VulkanApplication::createDescriptorPool() {
-    std::array<VkDescriptorPoolSize, 2> poolSizes{};
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-    poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-
-    VkDescriptorPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-    poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+void VulkanApplication::createMaterialTable() {
+    _materialTable.clear();
+    for (auto& [name, material] : _materials) {
+        material.index = static_cast<uint32_t>(_materialTable.size());
+        _materialTable.push_back(&material);
+    }
 
-    if(vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+    const uint32_t defaultIndex = _materials.at("Default").index;
+    for (auto& [name, mesh] : _meshes) {
+        for (SubMesh& submesh : mesh._subMeshes) {
+            auto material = _materials.find(submesh.materialName);
+            submesh.materialIndex = material != _materials.end() ? material->second.index : defaultIndex;
+        }
+    }
+}
+
+void VulkanApplication::createDrawDataBuffers() {
+    drawDataLayout = DrawDataLayout{};
+    drawDataLayout.objectCapacity = static_cast<uint32_t>(_staticRenderables.size() + _dynamicRenderables.size());
+    for (const std::vector<RenderObject>* renderables : {&_staticRenderables, &_dynamicRenderables}) {
+        for (const RenderObject& renderable : *renderables) {
+            auto mesh = _meshes.find(renderable.meshName);
+            if (mesh != _meshes.end()) {
+                drawDataLayout.drawCapacity += static_cast<uint32_t>(mesh->second._subMeshes.size());
+            }
+        }
+    }
+    drawDataLayout.materialCount = static_cast<uint32_t>(_materialTable.size());
+    drawDataLayout.lightCapacity = std::min(static_cast<uint32_t>(sceneLights.size()), light_clusters::MAX_LIGHTS);
+    // Storage buffer ranges may not be empty.
+    drawDataLayout.objectCapacity = std::max(drawDataLayout.objectCapacity, 1u);
+    drawDataLayout.drawCapacity = std::max(drawDataLayout.drawCapacity, 1u);
+    drawDataLayout.lightCapacity = std::max(drawDataLayout.lightCapacity, 1u);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    const VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment;
+    auto align = [alignment](VkDeviceSize offset) { return (offset + alignment - 1) / alignment * alignment; };
+
+    drawDataLayout.objectsOffset = 0;
+    drawDataLayout.drawsOffset = align(drawDataLayout.objectsOffset + sizeof(GPUObjectData) * drawDataLayout.objectCapacity);
+    drawDataLayout.materialsOffset = align(drawDataLayout.drawsOffset + sizeof(GPUDrawData) * drawDataLayout.drawCapacity);
+    drawDataLayout.indirectOffset = align(drawDataLayout.materialsOffset + sizeof(GPUMaterialData) * drawDataLayout.materialCount);
+    drawDataLayout.lightsOffset = align(drawDataLayout.indirectOffset + sizeof(VkDrawIndexedIndirectCommand) * drawDataLayout.drawCapacity);
+    drawDataLayout.clustersOffset = align(drawDataLayout.lightsOffset + sizeof(GPUPointLight) * drawDataLayout.lightCapacity);
+    drawDataLayout.lightIndicesOffset = align(drawDataLayout.clustersOffset + sizeof(GPUClusterGrid) + sizeof(LightCluster) * light_clusters::CLUSTER_COUNT);
+    drawDataLayout.size = drawDataLayout.lightIndicesOffset + sizeof(uint32_t) * light_clusters::MAX_LIGHT_INDICES;
+
+    drawDataBuffers.resize(maxFramesInFlight);
+    drawDataMemory.resize(maxFramesInFlight);
+    drawDataMapped.resize(maxFramesInFlight);
+    for (size_t i = 0; i < maxFramesInFlight; i++) {
+        createBuffer(drawDataLayout.size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, drawDataBuffers[i], drawDataMemory[i]);
+        vkMapMemory(device, drawDataMemory[i], 0, drawDataLayout.size, 0, &drawDataMapped[i]);
+    }
+
+    uint32_t meshSortId = 0;
+    for (auto& [name, mesh] : _meshes) {
+        mesh._sortId = meshSortId++;
+    }
+
+    frameDrawRuns.reserve(drawDataLayout.drawCapacity);
+    frameMaterialUsed.assign(drawDataLayout.materialCount, 0);
+    framePendingDraws.reserve(drawDataLayout.drawCapacity);
+    frameOpaqueEntries.reserve(drawDataLayout.drawCapacity);
+    frameTranslucentEntries.reserve(drawDataLayout.drawCapacity);
+    frameSortScratch.reserve(drawDataLayout.drawCapacity);
+
+    std::cout << "[INFO] Draw data: " << drawDataLayout.objectCapacity << " objects, " << drawDataLayout.drawCapacity << " draws, "
+              << drawDataLayout.materialCount << " materials, " << drawDataLayout.size / 1024.0 << " KiB per frame, "
+              << (indirectDrawSupported ? "multi-draw indirect" : "direct draws") << std::endl;
+}
+
+void VulkanApplication::createDebugDrawResources() {
+    if (!rendererSettings.debugDraw) {
+        return;
+    }
+
+    auto vertShaderCode = readFile("shaders/debug_vert.spv");
+    auto fragShaderCode = readFile("shaders/debug_frag.spv");
+    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
+    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+
+    VkPipelineShaderStageCreateInfo shaderStages[] = {
+        vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule),
+        vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderModule)
+    };
+
+    auto bindingDescription = DebugVertex::getBindingDescription();
+    auto attributeDescriptions = DebugVertex::getAttributeDescriptions();
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo = vkinit::input_assembly_create_info(VK_PRIMITIVE_TOPOLOGY_LINE_LIST);
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer = vkinit::rasterization_state_create_info(VK_POLYGON_MODE_FILL);
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    VkPipelineMultisampleStateCreateInfo multisampling = vkinit::multisampling_state_create_info();
+    // Lines are hidden by the scene but never occlude it or each other.
+    VkPipelineDepthStencilStateCreateInfo depthStencil = vkinit::depth_stencil_create_info(true, false, VK_COMPARE_OP_LESS_OR_EQUAL);
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment = vkinit::color_blend_attachment_state();
+    colorBlendAttachment.blendEnable = VK_TRUE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    // The scene's layout, so the descriptor sets bound for the scene stay valid.
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = 0;
+
+    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &debugLinePipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create debug line pipeline.");
+    }
+
+    vkDestroyShaderModule(device, fragShaderModule, nullptr);
+    vkDestroyShaderModule(device, vertShaderModule, nullptr);
+
+    const VkDeviceSize bufferSize = sizeof(DebugVertex) * DEBUG_DRAW_MAX_VERTICES;
+    debugVertexBuffers.resize(maxFramesInFlight);
+    debugVertexMemory.resize(maxFramesInFlight);
+    debugVertexMapped.resize(maxFramesInFlight);
+    for (size_t i = 0; i < maxFramesInFlight; i++) {
+        createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                     debugVertexBuffers[i], debugVertexMemory[i]);
+        vkMapMemory(device, debugVertexMemory[i], 0, bufferSize, 0, &debugVertexMapped[i]);
+    }
+}
+
+void VulkanApplication::createImpostorResources() {
+    std::vector<GPUImpostorData> table;
+    std::vector<uint32_t> texels;
+
+    // Same layout update_scene relies on: one renderable per ball, then the cue.
+    if (rendererSettings.ballImpostors && _dynamicRenderables.size() == balls.size() + 1) {
+        for (size_t i = 0; i < balls.size(); ++i) {
+            auto mesh_it = _meshes.find(_dynamicRenderables[i].meshName);
+            if (mesh_it == _meshes.end() || mesh_it->second._impostorIndex >= 0) {
+                continue;
+            }
+            Mesh& mesh = mesh_it->second;
+
+            std::vector<ColoredRange> ranges;
+            size_t subMeshCount = mesh._lods.empty() ? mesh._subMeshes.size() : mesh._lods[0].subMeshCount;
+            for (size_t s = 0; s < subMeshCount; ++s) {
+                const SubMesh& submesh = mesh._subMeshes[s];
+                auto material = _materials.find(submesh.materialName);
+                glm::vec3 color = material != _materials.end() ? material->second.color : glm::vec3(1.0f);
+                ranges.push_back({{submesh.firstIndex, submesh.indexCount}, glm::packUnorm4x8(glm::vec4(color, 1.0f))});
+            }
+            if (ranges.empty()) {
+                continue;
+            }
+
+            // The largest range is the ball's body: it defines the sphere and fills texels nothing else covers.
+            auto body = std::max_element(ranges.begin(), ranges.end(),
+                                         [](const ColoredRange& a, const ColoredRange& b) { return a.range.indexCount < b.range.indexCount; });
+            std::iter_swap(ranges.begin(), body);
+            glm::vec4 sphere = impostor::range_sphere(mesh._vertices, mesh._indices, ranges[0].range);
+            std::vector<uint32_t> markings = impostor::bake_markings(mesh._vertices, mesh._indices, ranges, glm::vec3(sphere));
+
+            mesh._impostorIndex = static_cast<int32_t>(table.size());
+            table.push_back({sphere, static_cast<uint32_t>(texels.size()), impostor::MARKING_WIDTH, impostor::MARKING_HEIGHT, 0});
+            texels.insert(texels.end(), markings.begin(), markings.end());
+        }
+    }
+
+    // Descriptor set 0 always points at this buffer, so it exists even without impostors.
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    const VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment;
+    impostorTableSize = sizeof(GPUImpostorData) * std::max<size_t>(table.size(), 1);
+    impostorTexelsOffset = (impostorTableSize + alignment - 1) / alignment * alignment;
+    impostorTexelsSize = sizeof(uint32_t) * std::max<size_t>(texels.size(), 1);
+    const VkDeviceSize bufferSize = impostorTexelsOffset + impostorTexelsSize;
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 stagingBuffer, stagingBufferMemory);
+    void* data;
+    vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
+    memset(data, 0, static_cast<size_t>(bufferSize));
+    memcpy(data, table.data(), sizeof(GPUImpostorData) * table.size());
+    memcpy(static_cast<uint8_t*>(data) + impostorTexelsOffset, texels.data(), sizeof(uint32_t) * texels.size());
+    vkUnmapMemory(device, stagingBufferMemory);
+
+    createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 impostorBuffer, impostorBufferMemory);
+    copyBuffer(stagingBuffer, impostorBuffer, bufferSize);
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    vkFreeMemory(device, stagingBufferMemory, nullptr);
+
+    if (table.empty()) {
+        return;
+    }
+
+    // Every impostor draws the same quad; impostor.vert places its corners from gl_VertexIndex.
+    Mesh quad;
+    for (glm::vec2 corner : {glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, -1.0f), glm::vec2(1.0f, 1.0f), glm::vec2(-1.0f, 1.0f)}) {
+        quad._vertices.push_back({glm::vec3(corner, 0.0f), corner * 0.5f + 0.5f, glm::vec3(0.0f, 0.0f, 1.0f)});
+    }
+    quad._indices = {0, 1, 2, 0, 2, 3};
+    SubMesh quadSubMesh;
+    quadSubMesh.materialName = "Default";
+    quadSubMesh.firstIndex = 0;
+    quadSubMesh.indexCount = static_cast<uint32_t>(quad._indices.size());
+    quad._subMeshes.push_back(quadSubMesh);
+    create_mesh_buffers(quad);
+    _meshes[IMPOSTOR_QUAD_MESH] = quad;
+
+    auto vertShaderCode = readFile("shaders/impostor_vert.spv");
+    auto fragShaderCode = readFile("shaders/impostor_frag.spv");
+    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
+    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+
+    VkPipelineShaderStageCreateInfo shaderStages[] = {
+        vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule),
+        vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderModule)
+    };
+
+    // No vertex attributes: the quad's vertex buffer is bound like any mesh's but never read.
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo = vkinit::input_assembly_create_info(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer = vkinit::rasterization_state_create_info(VK_POLYGON_MODE_FILL);
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    VkPipelineMultisampleStateCreateInfo multisampling = vkinit::multisampling_state_create_info();
+    VkPipelineDepthStencilStateCreateInfo depthStencil = vkinit::depth_stencil_create_info(true, true, VK_COMPARE_OP_LESS);
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment = vkinit::color_blend_attachment_state();
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = 0;
+
+    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &impostorPipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create impostor pipeline.");
+    }
+
+    vkDestroyShaderModule(device, fragShaderModule, nullptr);
+    vkDestroyShaderModule(device, vertShaderModule, nullptr);
+
+    std::cout << "[INFO] Ball impostors: " << table.size() << " meshes, " << impostor::MARKING_WIDTH << "x" << impostor::MARKING_HEIGHT
+              << " markings, " << sizeof(uint32_t) * texels.size() / 1024 << " KiB" << std::endl;
+}
+
+void VulkanApplication::createShadowResources() {
+    shadowFormat = findSupportedFormat({VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM}, VK_IMAGE_TILING_OPTIMAL,
+                                       VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                                       VK_FORMAT_FEATURE_TRANSFER_SRC_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT);
+
+    createImage(SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, shadowFormat, VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                staticShadowImage, staticShadowImageMemory);
+    staticShadowImageView = createImageView(staticShadowImage, shadowFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+    createImage(SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, shadowFormat, VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, shadowImage, shadowImageMemory);
+    shadowImageView = createImageView(shadowImage, shadowFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+    // The static layer is cleared and left ready to be copied; the composited map starts from that
+    // copy and ends up ready for the scene's fragment shaders.
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = shadowFormat;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    VkAttachmentReference depthAttachmentRef{};
+    depthAttachmentRef.attachment = 0;
+    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+    // Earlier copies out of the layer finish before it is cleared, and its depth is written
+    // before the next copy reads it.
+    std::array<VkSubpassDependency, 2> dependencies{};
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[0].srcAccessMask = 0;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &depthAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassInfo.pDependencies = dependencies.data();
+
+    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &staticShadowRenderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create static shadow render pass.");
+    }
+
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    dependencies[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &shadowRenderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow render pass.");
+    }
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = staticShadowRenderPass;
+    framebufferInfo.attachmentCount = 1;
+    framebufferInfo.pAttachments = &staticShadowImageView;
+    framebufferInfo.width = SHADOW_MAP_SIZE;
+    framebufferInfo.height = SHADOW_MAP_SIZE;
+    framebufferInfo.layers = 1;
+    if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &staticShadowFramebuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create static shadow framebuffer.");
+    }
+    framebufferInfo.renderPass = shadowRenderPass;
+    framebufferInfo.pAttachments = &shadowImageView;
+    if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &shadowFramebuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow framebuffer.");
+    }
+
+    // Hardware depth comparison with bilinear filtering gives 2x2 PCF per lookup. Outside the map is lit.
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    samplerInfo.compareEnable = VK_TRUE;
+    samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    samplerInfo.maxLod = 0.0f;
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &shadowSampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow sampler.");
+    }
+
+    // Depth only: positions through the scene's object and draw buffers, no fragment shader.
+    auto vertShaderCode = readFile("shaders/shadow_vert.spv");
+    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
+    VkPipelineShaderStageCreateInfo shaderStage = vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule);
+
+    const bool packed = rendererSettings.packedVertices;
+    auto bindingDescription = packed ? PackedVertex::getBindingDescription() : Vertex::getBindingDescription();
+    auto attributeDescriptions = packed ? PackedVertex::getAttributeDescriptions() : Vertex::getAttributeDescriptions();
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    // Location 0 is the position in both vertex layouts.
+    vertexInputInfo.vertexAttributeDescriptionCount = 1;
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo = vkinit::input_assembly_create_info(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    // Thin geometry like the table cloth casts from both faces; the bias keeps surfaces from shadowing themselves.
+    VkPipelineRasterizationStateCreateInfo rasterizer = vkinit::rasterization_state_create_info(VK_POLYGON_MODE_FILL);
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.depthBiasEnable = VK_TRUE;
+    rasterizer.depthBiasConstantFactor = 1.25f;
+    rasterizer.depthBiasSlopeFactor = 1.75f;
+    VkPipelineMultisampleStateCreateInfo multisampling = vkinit::multisampling_state_create_info();
+    VkPipelineDepthStencilStateCreateInfo depthStencil = vkinit::depth_stencil_create_info(true, true, VK_COMPARE_OP_LESS_OR_EQUAL);
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.attachmentCount = 0;
+
+    std::vector<VkDynamicState> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    // Both shadow render passes are compatible, so one pipeline serves the two layers.
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 1;
+    pipelineInfo.pStages = &shaderStage;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.renderPass = shadowRenderPass;
+    pipelineInfo.subpass = 0;
+
+    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &shadowPipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow pipeline.");
+    }
+
+    vkDestroyShaderModule(device, vertShaderModule, nullptr);
+
+    std::cout << "[INFO] Shadow maps: 2x " << SHADOW_MAP_SIZE << "x" << SHADOW_MAP_SIZE << (shadowFormat == VK_FORMAT_D32_SFLOAT ? " D32" : " D16")
+              << (rendererSettings.shadows ? (rendererSettings.shadowCache ? ", cached static and dynamic layers" : ", re-rendered every frame") : ", disabled")
+              << std::endl;
+}
+
+void VulkanApplication::createDescriptorPool() {
+    std::array<VkDescriptorPoolSize, 3> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = static_cast<uint32_t>(maxFramesInFlight);
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = static_cast<uint32_t>(maxFramesInFlight) * 8;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[2].descriptorCount = static_cast<uint32_t>(maxFramesInFlight);
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = static_cast<uint32_t>(maxFramesInFlight);
+
+    if(vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor pool.");
     }
 }
 
 void VulkanApplication::createDescriptorSets() {
-    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
+    std::vector<VkDescriptorSetLayout> layouts(maxFramesInFlight, descriptorSetLayout);
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    allocInfo.descriptorSetCount = static_cast<uint32_t>(maxFramesInFlight);
     allocInfo.pSetLayouts = layouts.data();
 
-    descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+    descriptorSets.resize(maxFramesInFlight);
     if(vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate descriptor sets.");
     }
 
-    for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for(size_t i = 0; i < maxFramesInFlight; i++) {
         VkDescriptorBufferInfo bufferInfo{};
         bufferInfo.buffer = uniformBuffers[i];
         bufferInfo.offset = 0;
         bufferInfo.range = sizeof(UniformBufferObject);
 
-        VkDescriptorBufferInfo lightBufferInfo{};
-        lightBufferInfo.buffer = lightBuffer;
-        lightBufferInfo.offset = 0;
-        lightBufferInfo.range = sizeof(Light);
+        VkDescriptorBufferInfo objectsInfo{drawDataBuffers[i], drawDataLayout.objectsOffset, sizeof(GPUObjectData) * drawDataLayout.objectCapacity};
+        VkDescriptorBufferInfo drawsInfo{drawDataBuffers[i], drawDataLayout.drawsOffset, sizeof(GPUDrawData) * drawDataLayout.drawCapacity};
+        VkDescriptorBufferInfo materialsInfo{drawDataBuffers[i], drawDataLayout.materialsOffset, sizeof(GPUMaterialData) * drawDataLayout.materialCount};
+
+        VkDescriptorBufferInfo impostorsInfo{impostorBuffer, 0, impostorTableSize};
+        VkDescriptorBufferInfo markingsInfo{impostorBuffer, impostorTexelsOffset, impostorTexelsSize};
 
-        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+        VkDescriptorBufferInfo lightsInfo{drawDataBuffers[i], drawDataLayout.lightsOffset, sizeof(GPUPointLight) * drawDataLayout.lightCapacity};
+        VkDescriptorBufferInfo clustersInfo{drawDataBuffers[i], drawDataLayout.clustersOffset, sizeof(GPUClusterGrid) + sizeof(LightCluster) * light_clusters::CLUSTER_COUNT};
+        VkDescriptorBufferInfo lightIndicesInfo{drawDataBuffers[i], drawDataLayout.lightIndicesOffset, sizeof(uint32_t) * light_clusters::MAX_LIGHT_INDICES};
+
+        VkDescriptorImageInfo shadowMapInfo{shadowSampler, shadowImageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+
+        std::array<VkWriteDescriptorSet, 10> descriptorWrites{};
         descriptorWrites[0] = vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, descriptorSets[i], &bufferInfo, 0);
-        descriptorWrites[1] = vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, descriptorSets[i], &lightBufferInfo, 1);
+        descriptorWrites[1] = vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, descriptorSets[i], &objectsInfo, 2);
+        descriptorWrites[2] = vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, descriptorSets[i], &drawsInfo, 3);
+        descriptorWrites[3] = vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, descriptorSets[i], &materialsInfo, 4);
+        descriptorWrites[4] = vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, descriptorSets[i], &impostorsInfo, 5);
+        descriptorWrites[5] = vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, descriptorSets[i], &markingsInfo, 6);
+        descriptorWrites[6] = vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, descriptorSets[i], &lightsInfo, 7);
+        descriptorWrites[7] = vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, descriptorSets[i], &clustersInfo, 8);
+        descriptorWrites[8] = vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, descriptorSets[i], &lightIndicesInfo, 9);
+        descriptorWrites[9] = vkinit::write_descriptor_image(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, descriptorSets[i], &shadowMapInfo, 10);
 
         vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
     }
@@ -1250,7 +2681,7 @@ void VulkanApplication::createDescriptorSets() {
 
 
 void VulkanApplication::createCommandBuffer() {
-    commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    commandBuffers.resize(maxFramesInFlight);
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.commandPool = commandPool;
@@ -1260,24 +2691,28 @@ void VulkanApplication::createCommandBuffer() {
     if(vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate command buffers.");
     }
+
+    staticCommandBuffers.resize(maxFramesInFlight);
+    dynamicCommandBuffers.resize(maxFramesInFlight);
+    staticCommandCaches.assign(maxFramesInFlight, StaticCommandCache{});
+    VkCommandBufferAllocateInfo secondaryInfo = vkinit::command_buffer_allocate_info(commandPool, maxFramesInFlight, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    if (vkAllocateCommandBuffers(device, &secondaryInfo, staticCommandBuffers.data()) != VK_SUCCESS ||
+        vkAllocateCommandBuffers(device, &secondaryInfo, dynamicCommandBuffers.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate secondary command buffers.");
+    }
 }
 
 void VulkanApplication::createSyncObjects() {
-    imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    renderFinishedSemaphores.resize(swapChainImages.size());
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    imageAvailableSemaphores.resize(maxFramesInFlight);
+    inFlightFences.resize(maxFramesInFlight);
     
     VkSemaphoreCreateInfo semaphoreInfo = vkinit::semaphore_create_info(0);
     
     VkFenceCreateInfo fenceInfo = vkinit::fence_create_info(VK_FENCE_CREATE_SIGNALED_BIT);  
     
-    for(size_t i = 0; i < swapChainImages.size(); i++) {
-        if(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create semaphores;");
-        }
-    }
+    createRenderFinishedSemaphores();
     
-    for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for(size_t i = 0; i < maxFramesInFlight; i++) {
         if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
             vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create semaphores!");
@@ -1285,11 +2720,53 @@ void VulkanApplication::createSyncObjects() {
     }
 }
 
+void VulkanApplication::createRenderFinishedSemaphores() {
+    renderFinishedSemaphores.resize(swapChainImages.size());
+
+    VkSemaphoreCreateInfo semaphoreInfo = vkinit::semaphore_create_info(0);
+
+    for(size_t i = 0; i < swapChainImages.size(); i++) {
+        if(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create semaphores;");
+        }
+    }
+}
+
+void VulkanApplication::destroyRenderFinishedSemaphores() {
+    for (VkSemaphore semaphore : renderFinishedSemaphores) {
+        vkDestroySemaphore(device, semaphore, nullptr);
+    }
+    renderFinishedSemaphores.clear();
+}
+
 void VulkanApplication::drawFrame() {
-    vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    PROFILE_FUNCTION();
+    const FrameSnapshot& snapshot = _snapshots.latest();
+
+    // Frame slots are reused round-robin, so the slot we are about to record into holds the
+    // oldest submission still in flight. Waiting on it caps the CPU at maxFramesInFlight frames
+    // ahead of the GPU: 1 gives the lowest latency, 3-4 the highest throughput.
+    {
+        PROFILE_SCOPE("WaitForFences");
+        vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    }
+    gpuQueries.collect(currentFrame);
+    textureCache.update();
+
+    // Must run before this slot's fence is reset, or readbacks tied to it would never complete.
+    if (captureEnabled) {
+        pollCaptures();
+    }
     
     uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    VkResult result = VK_SUCCESS;
+    if (headless) {
+        imageIndex = nextOffscreenTarget;
+        nextOffscreenTarget = (nextOffscreenTarget + 1) % static_cast<uint32_t>(swapChainImages.size());
+    } else {
+        PROFILE_SCOPE("AcquireNextImage");
+        result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    }
     
     if(result == VK_ERROR_OUT_OF_DATE_KHR) {
         recreateSwapChain();
@@ -1298,36 +2775,60 @@ void VulkanApplication::drawFrame() {
         throw std::runtime_error("failed to acquire swap chain image.");
     }
     
-    updateUniformBuffer(currentFrame);
+    updateUniformBuffer(currentFrame, snapshot);
     
+    frameCaptureSlot = acquireCaptureBuffer();
+
     vkResetFences(device, 1, &inFlightFences[currentFrame]);
     vkResetCommandBuffer(commandBuffers[currentFrame], 0);
-    recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+    recordCommandBuffer(commandBuffers[currentFrame], imageIndex, snapshot);
     
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     
     VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
     VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.waitSemaphoreCount = headless ? 0 : 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
     
-    VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[imageIndex]};
-    submitInfo.signalSemaphoreCount = 1;
+    VkSemaphore signalSemaphores[] = {headless ? VK_NULL_HANDLE : renderFinishedSemaphores[imageIndex]};
+    submitInfo.signalSemaphoreCount = headless ? 0 : 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
     
-    if(vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame])!= VK_SUCCESS) {
-        throw std::runtime_error("failed to submit draw command buffer.");
+    {
+        PROFILE_SCOPE("QueueSubmit");
+        gpuQueries.markSubmitted(currentFrame, profiler::now_ticks());
+        if(vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame])!= VK_SUCCESS) {
+            throw std::runtime_error("failed to submit draw command buffer.");
+        }
+    }
+
+    if (headless) {
+        currentFrame = (currentFrame + 1) % maxFramesInFlight;
+        return;
     }
     
     VkSwapchainKHR swapChains[] = {swapChain};
     
     VkPresentInfoKHR presentInfo = vkinit::present_info(1, signalSemaphores, 1, swapChains, &imageIndex);
     
-    result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    if (snapshot.inputSampleTime.time_since_epoch().count() != 0) {
+        auto latency = std::chrono::steady_clock::now() - snapshot.inputSampleTime;
+        uint64_t latencyUs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+        inputLatencyTotalUs.fetch_add(latencyUs, std::memory_order_relaxed);
+        inputLatencySamples.fetch_add(1, std::memory_order_relaxed);
+        uint64_t previousMax = inputLatencyMaxUs.load(std::memory_order_relaxed);
+        while (latencyUs > previousMax && !inputLatencyMaxUs.compare_exchange_weak(previousMax, latencyUs, std::memory_order_relaxed)) {
+        }
+    }
+
+    {
+        PROFILE_SCOPE("QueuePresent");
+        result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    }
     
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
         framebufferResized = false;
@@ -1336,43 +2837,429 @@ void VulkanApplication::drawFrame() {
         throw std::runtime_error("failed to present swap chain image!");
     }
     
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    currentFrame = (currentFrame + 1) % maxFramesInFlight;
 }
 
-void VulkanApplication::updateUniformBuffer(uint32_t currentImage) {
+void VulkanApplication::updateUniformBuffer(uint32_t currentImage, const FrameSnapshot& snapshot) {
+    PROFILE_FUNCTION();
     UniformBufferObject ubo{};
 
-    glm::vec3 lookAtTarget = glm::vec3(0.0f, 0.0f, 0.0f);
-
-    glm::vec3 cameraPos;
-    cameraPos.x = lookAtTarget.x + cameraDistance * cos(cameraPitch) * cos(cameraYaw);
-    cameraPos.y = lookAtTarget.y + cameraDistance * sin(cameraPitch);
-    cameraPos.z = lookAtTarget.z + cameraDistance * cos(cameraPitch) * sin(cameraYaw);
-
-    glm::vec3 upVector = glm::vec3(0.0f, 1.0f, 0.0f);
+    ubo.view = camera_view(snapshot.camera);
 
-    ubo.view = glm::lookAt(cameraPos, lookAtTarget, upVector);
-
-    ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float)swapChainExtent.height, 0.1f, 100.0f);
+    ubo.proj = glm::perspective(glm::radians(CAMERA_FOV_DEGREES), swapChainExtent.width / (float)swapChainExtent.height, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE);
 
     ubo.proj[1][1] *= -1;
 
-    memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
+    ubo.shadowViewProj = shadow_view_proj(snapshot.light);
 
-    Light light;
-    light.position = glm::vec3(-3.0f, 5.5f, 0.0f);
-    light.radius = 13.0f;
-    light.intensity = 1.2f;
-    memcpy(lightBufferMapped, &light, sizeof(light));
+    memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
 }
 
-void VulkanApplication::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+void VulkanApplication::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, const FrameSnapshot& snapshot) {
+    PROFILE_FUNCTION();
     VkCommandBufferBeginInfo beginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 
     if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
         throw std::runtime_error("failed to begin recording command buffer.");
     }
 
+    gpuQueries.beginFrame(commandBuffer, currentFrame);
+    gpuQueries.writeTimestamp(commandBuffer, currentFrame, TIMESTAMP_PASS_BEGIN, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+
+    frameDrawStats = DrawStats{};
+
+    const glm::vec3 cameraPosition = camera_position(snapshot.camera);
+    // The camera always looks at the origin.
+    const glm::vec3 cameraForward = glm::normalize(-cameraPosition);
+    // Pixels covered by one world unit at distance 1 along the view axis.
+    const float pixelsPerUnit = swapChainExtent.height / (2.0f * std::tan(glm::radians(CAMERA_FOV_DEGREES) * 0.5f));
+
+    // Objects, draws and indirect commands go straight into this frame's mapped draw data.
+    uint8_t* drawData = static_cast<uint8_t*>(drawDataMapped[currentFrame]);
+    GPUObjectData* objects = reinterpret_cast<GPUObjectData*>(drawData + drawDataLayout.objectsOffset);
+    GPUDrawData* draws = reinterpret_cast<GPUDrawData*>(drawData + drawDataLayout.drawsOffset);
+    GPUMaterialData* materials = reinterpret_cast<GPUMaterialData*>(drawData + drawDataLayout.materialsOffset);
+    VkDrawIndexedIndirectCommand* commands = reinterpret_cast<VkDrawIndexedIndirectCommand*>(drawData + drawDataLayout.indirectOffset);
+    uint32_t objectCount = 0;
+    uint32_t drawCount = 0;
+    frameDrawRuns.clear();
+    framePendingDraws.clear();
+    frameOpaqueEntries.clear();
+    frameTranslucentEntries.clear();
+    std::fill(frameMaterialUsed.begin(), frameMaterialUsed.end(), 0);
+
+    // Pipeline field of the sort keys.
+    const std::array<VkPipeline, 4> keyPipelines = {graphicsPipeline, translucentPipeline, impostorPipeline, bakedAoPipeline};
+    auto impostorQuad = _meshes.find(IMPOSTOR_QUAD_MESH);
+    const Mesh* impostorMesh = impostorQuad != _meshes.end() ? &impostorQuad->second : nullptr;
+
+    // Collects an object's submeshes with their sort keys. Opaque draws are sorted per group;
+    // translucent ones are sorted across both groups and drawn last.
+    auto add_renderable = [&](const RenderObject& renderable, const glm::mat4& transform) {
+        auto mesh_it = _meshes.find(renderable.meshName);
+        if (mesh_it == _meshes.end()) { return; }
+
+        const Mesh& mesh = mesh_it->second;
+        if (mesh._vertexBuffer == VK_NULL_HANDLE || mesh._indexBuffer == VK_NULL_HANDLE) { return; }
+
+        // An impostor replaces every LOD with one quad; its draw's material field selects the impostor.
+        if (mesh._impostorIndex >= 0 && impostorMesh != nullptr) {
+            uint32_t objectIndex = objectCount++;
+            objects[objectIndex].transform = transform;
+            objects[objectIndex].positionScale = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+            objects[objectIndex].positionOffset = glm::vec4(0.0f);
+            glm::vec3 center = glm::vec3(transform * glm::vec4(mesh._boundsCenter, 1.0f));
+            uint32_t depth = draw_sort::depth_bucket(glm::dot(center - cameraPosition, cameraForward), CAMERA_FAR_PLANE);
+            uint32_t impostorIndex = static_cast<uint32_t>(mesh._impostorIndex);
+            uint64_t key = draw_sort::make_key(DrawLayer::Opaque, 2, impostorMesh->_sortId, impostorIndex, depth);
+            const SubMesh& quad = impostorMesh->_subMeshes[0];
+            frameOpaqueEntries.push_back({key, static_cast<uint32_t>(framePendingDraws.size())});
+            framePendingDraws.push_back({impostorMesh, objectIndex, impostorIndex, quad.indexCount, quad.firstIndex});
+            frameDrawStats.triangles += quad.indexCount / 3;
+            frameDrawStats.impostors++;
+            return;
+        }
+
+        size_t firstSubMesh = 0;
+        size_t subMeshCount = mesh._subMeshes.size();
+        uint32_t lodIndex = selectLod(mesh, transform, cameraPosition, pixelsPerUnit);
+        if (!mesh._lods.empty()) {
+            firstSubMesh = mesh._lods[lodIndex].firstSubMesh;
+            subMeshCount = mesh._lods[lodIndex].subMeshCount;
+        }
+        frameDrawStats.objectsPerLod[lodIndex]++;
+
+        uint32_t objectIndex = objectCount++;
+        objects[objectIndex].transform = transform;
+        objects[objectIndex].positionScale = glm::vec4(mesh._quantization.scale, 0.0f);
+        objects[objectIndex].positionOffset = glm::vec4(mesh._quantization.offset, 0.0f);
+
+        glm::vec3 center = glm::vec3(transform * glm::vec4(mesh._boundsCenter, 1.0f));
+        uint32_t depth = draw_sort::depth_bucket(glm::dot(center - cameraPosition, cameraForward), CAMERA_FAR_PLANE);
+
+        for (size_t s = firstSubMesh; s < firstSubMesh + subMeshCount; ++s) {
+            const SubMesh& submesh = mesh._subMeshes[s];
+            if (submesh.indexCount == 0) {
+                continue;
+            }
+            bool translucent = _materialTable[submesh.materialIndex]->opacity < 1.0f;
+            DrawLayer layer = translucent ? DrawLayer::Translucent : DrawLayer::Opaque;
+            uint32_t pipeline = translucent ? 1 : (mesh._occlusionBuffer != VK_NULL_HANDLE ? 3 : 0);
+            uint64_t key = draw_sort::make_key(layer, pipeline, mesh._sortId, submesh.materialIndex, depth);
+            uint32_t pendingIndex = static_cast<uint32_t>(framePendingDraws.size());
+            framePendingDraws.push_back({&mesh, objectIndex, submesh.materialIndex, submesh.indexCount, submesh.firstIndex});
+            (translucent ? frameTranslucentEntries : frameOpaqueEntries).push_back({key, pendingIndex});
+            frameMaterialUsed[submesh.materialIndex] = 1;
+            frameDrawStats.triangles += submesh.indexCount / 3;
+        }
+    };
+
+    // Writes a group's draws in key order and splits them into runs of one pipeline and mesh.
+    // Without sorting, entries keep their collection order.
+    auto emit_group = [&](std::vector<SortEntry>& entries) {
+        if (rendererSettings.sortDraws) {
+            draw_sort::radix_sort(entries, frameSortScratch);
+        }
+        const size_t groupFirstRun = frameDrawRuns.size();
+        for (const SortEntry& entry : entries) {
+            const PendingDraw& pending = framePendingDraws[entry.index];
+            VkPipeline pipeline = keyPipelines[draw_sort::key_pipeline(entry.key)];
+            if (frameDrawRuns.size() == groupFirstRun || frameDrawRuns.back().mesh != pending.mesh || frameDrawRuns.back().pipeline != pipeline) {
+                frameDrawRuns.push_back({pipeline, pending.mesh, drawCount, 0});
+            }
+            draws[drawCount] = {pending.objectIndex, pending.materialIndex};
+            // firstInstance selects the draw's entry through gl_InstanceIndex.
+            commands[drawCount] = {pending.indexCount, 1, pending.firstIndex, 0, drawCount};
+            drawCount++;
+            frameDrawRuns.back().drawCount++;
+        }
+        entries.clear();
+    };
+
+    // Runs never span the static and dynamic groups, which are timed separately.
+    for (const auto& renderable : _staticRenderables) {
+        add_renderable(renderable, renderable.transformMatrix);
+    }
+    emit_group(frameOpaqueEntries);
+    const size_t staticRunCount = frameDrawRuns.size();
+    size_t dynamicCount = std::min(_dynamicRenderables.size(), snapshot.dynamicTransforms.size());
+    for (size_t i = 0; i < dynamicCount; ++i) {
+        add_renderable(_dynamicRenderables[i], snapshot.dynamicTransforms[i]);
+    }
+    emit_group(frameOpaqueEntries);
+    const size_t dynamicRunEnd = frameDrawRuns.size();
+    emit_group(frameTranslucentEntries);
+
+    for (uint32_t m = 0; m < drawDataLayout.materialCount; ++m) {
+        materials[m].color = glm::vec4(_materialTable[m]->color, _materialTable[m]->opacity);
+        // Only textures drawn this frame are marked used in the texture cache.
+        materials[m].textureIndex = frameMaterialUsed[m] ? textureCache.bindlessIndex(_materialTable[m]->texture) : 0;
+    }
+
+    // Lights are binned against this frame's camera and read by the fragment shaders from the draw data.
+    {
+        PROFILE_SCOPE("light_clusters");
+        ClusterCamera clusterCamera{camera_view(snapshot.camera), glm::radians(CAMERA_FOV_DEGREES),
+                                    swapChainExtent.width / static_cast<float>(swapChainExtent.height), CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE,
+                                    swapChainExtent.width, swapChainExtent.height};
+        lightClusters.build(snapshot.lights, clusterCamera);
+        size_t lightCount = std::min(snapshot.lights.size(), static_cast<size_t>(drawDataLayout.lightCapacity));
+        memcpy(drawData + drawDataLayout.lightsOffset, snapshot.lights.data(), sizeof(GPUPointLight) * lightCount);
+        memcpy(drawData + drawDataLayout.clustersOffset, &lightClusters.grid(), sizeof(GPUClusterGrid));
+        memcpy(drawData + drawDataLayout.clustersOffset + sizeof(GPUClusterGrid), lightClusters.clusters().data(),
+               sizeof(LightCluster) * lightClusters.clusters().size());
+        memcpy(drawData + drawDataLayout.lightIndicesOffset, lightClusters.indices().data(), sizeof(uint32_t) * lightClusters.indices().size());
+        if (lightClusters.droppedIndices() > 0 && !lightBudgetWarned) {
+            lightBudgetWarned = true;
+            std::cerr << "[ERROR] Light index budget of " << light_clusters::MAX_LIGHT_INDICES << " exceeded; "
+                      << lightClusters.droppedIndices() << " cluster entries dropped this frame." << std::endl;
+        }
+        renderLights.store(static_cast<uint32_t>(lightCount), std::memory_order_relaxed);
+        renderVisibleLights.store(lightClusters.visibleLights(), std::memory_order_relaxed);
+        renderLitClusters.store(lightClusters.occupiedClusters(), std::memory_order_relaxed);
+        renderMaxClusterLights.store(lightClusters.maxClusterLights(), std::memory_order_relaxed);
+        renderLightIndices.store(static_cast<uint32_t>(lightClusters.indices().size()), std::memory_order_relaxed);
+    }
+
+    VkDescriptorSet textureSet = textureCache.bindlessSet();
+
+    // Secondary buffers inherit no state, so each binds the descriptor sets and dynamic state itself.
+    auto begin_secondary = [&](VkCommandBuffer secondary, VkCommandBufferUsageFlags flags, VkFramebuffer framebuffer) {
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = renderPass;
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = framebuffer;
+
+        VkCommandBufferBeginInfo secondaryBeginInfo = vkinit::command_buffer_begin_info(flags | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT);
+        secondaryBeginInfo.pInheritanceInfo = &inheritanceInfo;
+        if (vkBeginCommandBuffer(secondary, &secondaryBeginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording secondary command buffer.");
+        }
+
+        std::array<VkDescriptorSet, 2> sets = {descriptorSets[currentFrame], textureSet};
+        vkCmdBindDescriptorSets(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, static_cast<uint32_t>(sets.size()), sets.data(), 0, nullptr);
+
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = static_cast<float>(swapChainExtent.width);
+        viewport.height = static_cast<float>(swapChainExtent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(secondary, 0, 1, &viewport);
+
+        VkRect2D scissor{};
+        scissor.offset = {0, 0};
+        scissor.extent = swapChainExtent;
+        vkCmdSetScissor(secondary, 0, 1, &scissor);
+    };
+
+    // Records runs into cmd; binds are only recorded when a run changes the state bound in cmd.
+    auto record_runs = [&](VkCommandBuffer cmd, size_t firstRun, size_t lastRun) {
+        VkPipeline boundPipeline = VK_NULL_HANDLE;
+        const Mesh* boundMesh = nullptr;
+        for (size_t r = firstRun; r < lastRun; ++r) {
+            const DrawRun& run = frameDrawRuns[r];
+            if (run.drawCount == 0) {
+                continue;
+            }
+
+            if (run.pipeline != boundPipeline) {
+                vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, run.pipeline);
+                boundPipeline = run.pipeline;
+                frameDrawStats.pipelineBinds++;
+            }
+            if (run.mesh != boundMesh) {
+                // Baked occlusion rides along in binding 1; pipelines that do not read it ignore it.
+                VkBuffer vertexBuffers[] = {run.mesh->_vertexBuffer, run.mesh->_occlusionBuffer};
+                VkDeviceSize offsets[] = {0, 0};
+                vkCmdBindVertexBuffers(cmd, 0, run.mesh->_occlusionBuffer != VK_NULL_HANDLE ? 2 : 1, vertexBuffers, offsets);
+                vkCmdBindIndexBuffer(cmd, run.mesh->_indexBuffer, 0, run.mesh->_indexType);
+                boundMesh = run.mesh;
+                frameDrawStats.vertexBufferBinds++;
+                frameDrawStats.indexBufferBinds++;
+            }
+
+            if (indirectDrawSupported) {
+                VkDeviceSize commandOffset = drawDataLayout.indirectOffset + sizeof(VkDrawIndexedIndirectCommand) * run.firstDraw;
+                vkCmdDrawIndexedIndirect(cmd, drawDataBuffers[currentFrame], commandOffset, run.drawCount, sizeof(VkDrawIndexedIndirectCommand));
+                frameDrawStats.indirectCalls++;
+            } else {
+                for (uint32_t d = run.firstDraw; d < run.firstDraw + run.drawCount; ++d) {
+                    vkCmdDrawIndexed(cmd, commands[d].indexCount, 1, commands[d].firstIndex, 0, commands[d].firstInstance);
+                }
+            }
+            frameDrawStats.drawCalls += run.drawCount;
+        }
+    };
+
+    // The static group's commands only depend on its runs and the target size: indirect draws
+    // read their order and counts from the draw data at execution time. Direct draws bake
+    // them in, so the fallback also compares the commands.
+    StaticCommandCache& staticCache = staticCommandCaches[currentFrame];
+    bool staticValid = staticCache.valid && staticCache.extent.width == swapChainExtent.width &&
+                       staticCache.extent.height == swapChainExtent.height && staticCache.runs.size() == staticRunCount;
+    for (size_t r = 0; staticValid && r < staticRunCount; ++r) {
+        const DrawRun& cached = staticCache.runs[r];
+        const DrawRun& run = frameDrawRuns[r];
+        staticValid = cached.pipeline == run.pipeline && cached.mesh == run.mesh && cached.firstDraw == run.firstDraw && cached.drawCount == run.drawCount;
+    }
+    uint32_t staticDrawCount = staticRunCount > 0 ? frameDrawRuns[staticRunCount - 1].firstDraw + frameDrawRuns[staticRunCount - 1].drawCount : 0;
+    if (staticValid && !indirectDrawSupported) {
+        staticValid = staticCache.commands.size() == staticDrawCount &&
+                      std::memcmp(staticCache.commands.data(), commands, sizeof(VkDrawIndexedIndirectCommand) * staticDrawCount) == 0;
+    }
+
+    VkCommandBuffer staticCommands = staticCommandBuffers[currentFrame];
+    if (staticValid) {
+        frameDrawStats.drawCalls += staticCache.stats.drawCalls;
+        frameDrawStats.pipelineBinds += staticCache.stats.pipelineBinds;
+        frameDrawStats.vertexBufferBinds += staticCache.stats.vertexBufferBinds;
+        frameDrawStats.indexBufferBinds += staticCache.stats.indexBufferBinds;
+        frameDrawStats.indirectCalls += staticCache.stats.indirectCalls;
+    } else {
+        vkResetCommandBuffer(staticCommands, 0);
+        // The framebuffer changes with the acquired image, so the cached buffer does not name one.
+        begin_secondary(staticCommands, 0, VK_NULL_HANDLE);
+        gpuQueries.writeTimestamp(staticCommands, currentFrame, TIMESTAMP_STATIC_BEGIN, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+        gpuQueries.beginStatistics(staticCommands, currentFrame, DRAW_GROUP_STATIC);
+        record_runs(staticCommands, 0, staticRunCount);
+        gpuQueries.endStatistics(staticCommands, currentFrame, DRAW_GROUP_STATIC);
+        gpuQueries.writeTimestamp(staticCommands, currentFrame, TIMESTAMP_STATIC_END, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+        if (vkEndCommandBuffer(staticCommands) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record static command buffer.");
+        }
+
+        // Nothing else has been recorded yet, so the counters hold the static group's.
+        staticCache.valid = true;
+        staticCache.extent = swapChainExtent;
+        staticCache.runs.assign(frameDrawRuns.begin(), frameDrawRuns.begin() + staticRunCount);
+        staticCache.commands.clear();
+        if (!indirectDrawSupported) {
+            staticCache.commands.assign(commands, commands + staticDrawCount);
+        }
+        staticCache.stats = frameDrawStats;
+        staticCommandRecords.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    VkCommandBuffer dynamicCommands = dynamicCommandBuffers[currentFrame];
+    vkResetCommandBuffer(dynamicCommands, 0);
+    begin_secondary(dynamicCommands, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, swapChainFramebuffers[imageIndex]);
+    gpuQueries.writeTimestamp(dynamicCommands, currentFrame, TIMESTAMP_DYNAMIC_BEGIN, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+    gpuQueries.beginStatistics(dynamicCommands, currentFrame, DRAW_GROUP_DYNAMIC);
+    record_runs(dynamicCommands, staticRunCount, dynamicRunEnd);
+    gpuQueries.endStatistics(dynamicCommands, currentFrame, DRAW_GROUP_DYNAMIC);
+    gpuQueries.writeTimestamp(dynamicCommands, currentFrame, TIMESTAMP_DYNAMIC_END, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+    // Translucent draws of both groups go last, inside the render pass timing only.
+    record_runs(dynamicCommands, dynamicRunEnd, frameDrawRuns.size());
+    draw_debug_shapes(snapshot);
+    if (debugDraw.vertexCount() > 0) {
+        VkDeviceSize offset = 0;
+        vkCmdBindPipeline(dynamicCommands, VK_PIPELINE_BIND_POINT_GRAPHICS, debugLinePipeline);
+        vkCmdBindVertexBuffers(dynamicCommands, 0, 1, &debugVertexBuffers[currentFrame], &offset);
+        vkCmdDraw(dynamicCommands, debugDraw.vertexCount(), 1, 0, 0);
+        frameDrawStats.pipelineBinds++;
+        frameDrawStats.vertexBufferBinds++;
+        frameDrawStats.drawCalls++;
+    }
+    if (vkEndCommandBuffer(dynamicCommands) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record dynamic command buffer.");
+    }
+
+    // Shadow layers are cached: the static one is only redrawn when the lamp moves, and the
+    // composited map is rebuilt from it only when a dynamic caster moved.
+    const bool lampMoved = snapshot.light.position != shadowLightPosition;
+    const bool staticShadowDirty = !staticShadowValid || (rendererSettings.shadows && (!rendererSettings.shadowCache || lampMoved));
+    const bool shadowDirty = staticShadowDirty ||
+                             (rendererSettings.shadows && (!rendererSettings.shadowCache || shadowCasterTransforms != snapshot.dynamicTransforms));
+    if (shadowDirty) {
+        PROFILE_SCOPE("shadows");
+        std::array<VkDescriptorSet, 2> sets = {descriptorSets[currentFrame], textureSet};
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, static_cast<uint32_t>(sets.size()), sets.data(), 0, nullptr);
+
+        VkClearValue shadowClear{};
+        shadowClear.depthStencil = {1.0f, 0};
+        VkExtent2D shadowExtent{SHADOW_MAP_SIZE, SHADOW_MAP_SIZE};
+        VkViewport shadowViewport{0.0f, 0.0f, static_cast<float>(SHADOW_MAP_SIZE), static_cast<float>(SHADOW_MAP_SIZE), 0.0f, 1.0f};
+        VkRect2D shadowScissor{{0, 0}, shadowExtent};
+
+        // Opaque runs only: translucent surfaces and impostor quads cast no shadows.
+        auto record_shadow_runs = [&](size_t firstRun, size_t lastRun) {
+            if (!rendererSettings.shadows) {
+                return;
+            }
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowPipeline);
+            vkCmdSetViewport(commandBuffer, 0, 1, &shadowViewport);
+            vkCmdSetScissor(commandBuffer, 0, 1, &shadowScissor);
+            frameDrawStats.pipelineBinds++;
+            const Mesh* boundMesh = nullptr;
+            for (size_t r = firstRun; r < lastRun; ++r) {
+                const DrawRun& run = frameDrawRuns[r];
+                if (run.drawCount == 0 || (run.pipeline != graphicsPipeline && run.pipeline != bakedAoPipeline)) {
+                    continue;
+                }
+                if (run.mesh != boundMesh) {
+                    VkBuffer vertexBuffers[] = {run.mesh->_vertexBuffer};
+                    VkDeviceSize offsets[] = {0};
+                    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+                    vkCmdBindIndexBuffer(commandBuffer, run.mesh->_indexBuffer, 0, run.mesh->_indexType);
+                    boundMesh = run.mesh;
+                    frameDrawStats.vertexBufferBinds++;
+                    frameDrawStats.indexBufferBinds++;
+                }
+                if (indirectDrawSupported) {
+                    VkDeviceSize commandOffset = drawDataLayout.indirectOffset + sizeof(VkDrawIndexedIndirectCommand) * run.firstDraw;
+                    vkCmdDrawIndexedIndirect(commandBuffer, drawDataBuffers[currentFrame], commandOffset, run.drawCount, sizeof(VkDrawIndexedIndirectCommand));
+                    frameDrawStats.indirectCalls++;
+                } else {
+                    for (uint32_t d = run.firstDraw; d < run.firstDraw + run.drawCount; ++d) {
+                        vkCmdDrawIndexed(commandBuffer, commands[d].indexCount, 1, commands[d].firstIndex, 0, commands[d].firstInstance);
+                    }
+                }
+                frameDrawStats.drawCalls += run.drawCount;
+            }
+        };
+
+        if (staticShadowDirty) {
+            VkRenderPassBeginInfo staticShadowPassInfo = vkinit::renderpass_begin_info(staticShadowRenderPass, shadowExtent, staticShadowFramebuffer);
+            staticShadowPassInfo.clearValueCount = 1;
+            staticShadowPassInfo.pClearValues = &shadowClear;
+            vkCmdBeginRenderPass(commandBuffer, &staticShadowPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            record_shadow_runs(0, staticRunCount);
+            vkCmdEndRenderPass(commandBuffer);
+            staticShadowValid = true;
+            shadowLightPosition = snapshot.light.position;
+            staticShadowRenders.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Earlier frames may still be sampling the composited map; its old contents are discarded.
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = shadowImage;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        VkImageCopy copyRegion{};
+        copyRegion.srcSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1};
+        copyRegion.dstSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1};
+        copyRegion.extent = {SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 1};
+        vkCmdCopyImage(commandBuffer, staticShadowImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, shadowImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+        VkRenderPassBeginInfo shadowPassInfo = vkinit::renderpass_begin_info(shadowRenderPass, shadowExtent, shadowFramebuffer);
+        vkCmdBeginRenderPass(commandBuffer, &shadowPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        record_shadow_runs(staticRunCount, dynamicRunEnd);
+        vkCmdEndRenderPass(commandBuffer);
+        shadowCasterTransforms = snapshot.dynamicTransforms;
+        shadowRenders.fetch_add(1, std::memory_order_relaxed);
+    }
+
     std::array<VkClearValue, 2> clearValues{};
     clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
     clearValues[1].depthStencil = {1.0f, 0};
@@ -1381,65 +3268,189 @@ void VulkanApplication::recordCommandBuffer(VkCommandBuffer commandBuffer, uint3
     renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
 
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
-
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(swapChainExtent.width);
-    viewport.height = static_cast<float>(swapChainExtent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = swapChainExtent;
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-
-    auto draw_renderables = [&](const std::vector<RenderObject>& renderables) {
-        for (const auto& renderable : renderables) {
-            auto mesh_it = _meshes.find(renderable.meshName);
-            if (mesh_it == _meshes.end()) { continue; }
-
-            const Mesh& mesh = mesh_it->second;
-            if (mesh._vertexBuffer == VK_NULL_HANDLE || mesh._indexBuffer == VK_NULL_HANDLE) { continue; }
-
-            VkBuffer vertexBuffers[] = {mesh._vertexBuffer};
-            VkDeviceSize offsets[] = {0};
-            vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-            vkCmdBindIndexBuffer(commandBuffer, mesh._indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-
-            for (const auto& submesh : mesh._subMeshes) {
-                auto mat_it = _materials.find(submesh.materialName);
-                if (mat_it == _materials.end()) {
-                    mat_it = _materials.find("Default");
-                }
-                const Material& material = mat_it->second;
+    // Draws are recorded into secondary command buffers, executed right away.
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-                GPUDrawPushConstants pushConstants;
-                pushConstants.transform = renderable.transformMatrix;
-                pushConstants.color = glm::vec4(material.color, 1.0f);
+    std::array<VkCommandBuffer, 2> secondaries = {staticCommands, dynamicCommands};
+    vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
 
-                vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(GPUDrawPushConstants), &pushConstants);
+    renderTriangles.store(frameDrawStats.triangles, std::memory_order_relaxed);
+    renderDrawCalls.store(frameDrawStats.drawCalls, std::memory_order_relaxed);
+    renderIndirectCalls.store(frameDrawStats.indirectCalls, std::memory_order_relaxed);
+    renderPipelineBinds.store(frameDrawStats.pipelineBinds, std::memory_order_relaxed);
+    renderImpostors.store(frameDrawStats.impostors, std::memory_order_relaxed);
+    renderBufferBinds.store(frameDrawStats.vertexBufferBinds + frameDrawStats.indexBufferBinds, std::memory_order_relaxed);
+    for (uint32_t lod = 0; lod < MAX_MESH_LODS; ++lod) {
+        renderObjectsPerLod[lod].store(frameDrawStats.objectsPerLod[lod], std::memory_order_relaxed);
+    }
 
-                vkCmdDrawIndexed(commandBuffer, submesh.indexCount, 1, submesh.firstIndex, 0, 0);
-            }
-        }
-    };
+    vkCmdEndRenderPass(commandBuffer);
+    gpuQueries.writeTimestamp(commandBuffer, currentFrame, TIMESTAMP_PASS_END, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
 
-    draw_renderables(_staticRenderables);
-    draw_renderables(_dynamicRenderables);
+    if (frameCaptureSlot >= 0) {
+        recordCaptureCopy(commandBuffer, imageIndex, static_cast<uint32_t>(frameCaptureSlot));
+    }
 
-    vkCmdEndRenderPass(commandBuffer);
     if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to record command buffer.");
     }
 }
 
+void VulkanApplication::createCaptureResources() {
+    VkDeviceSize bufferSize = static_cast<VkDeviceSize>(swapChainExtent.width) * swapChainExtent.height * 4;
+
+    // Cached memory makes the encoder's reads fast; coherent saves the invalidate.
+    const VkMemoryPropertyFlags preferences[] = {
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    };
+
+    captureBuffers.resize(rendererSettings.captureSlots);
+    for (auto& capture : captureBuffers) {
+        bool created = false;
+        for (VkMemoryPropertyFlags properties : preferences) {
+            try {
+                createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, properties, capture.buffer, capture.memory);
+            } catch (const std::runtime_error&) {
+                vkDestroyBuffer(device, capture.buffer, nullptr);
+                capture.buffer = VK_NULL_HANDLE;
+                continue;
+            }
+            capture.coherent = (properties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+            created = true;
+            break;
+        }
+        if (!created) {
+            throw std::runtime_error("failed to allocate capture readback buffer.");
+        }
+
+        vkMapMemory(device, capture.memory, 0, bufferSize, 0, &capture.mapped);
+        capture.pending = false;
+    }
+    nextCaptureSlot = 0;
+}
+
+void VulkanApplication::destroyCaptureResources() {
+    for (auto& capture : captureBuffers) {
+        vkUnmapMemory(device, capture.memory);
+        vkDestroyBuffer(device, capture.buffer, nullptr);
+        vkFreeMemory(device, capture.memory, nullptr);
+    }
+    captureBuffers.clear();
+}
+
+int32_t VulkanApplication::acquireCaptureBuffer() {
+    if (!captureEnabled || renderFrames % rendererSettings.captureInterval != 0) {
+        return -1;
+    }
+    capturesRequested.fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t slotCount = static_cast<uint32_t>(captureBuffers.size());
+    for (uint32_t i = 0; i < slotCount; i++) {
+        uint32_t slot = (nextCaptureSlot + i) % slotCount;
+        if (!captureBuffers[slot].pending && !captureEncoder.isSlotBusy(slot)) {
+            nextCaptureSlot = (slot + 1) % slotCount;
+            captureBuffers[slot].pending = true;
+            captureBuffers[slot].frameSlot = currentFrame;
+            captureBuffers[slot].frameNumber = renderFrames;
+            return static_cast<int32_t>(slot);
+        }
+    }
+
+    // Every buffer is still in flight or being encoded; skipping is cheaper than stalling.
+    capturesDropped.fetch_add(1, std::memory_order_relaxed);
+    return -1;
+}
+
+void VulkanApplication::recordCaptureCopy(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t captureSlot) {
+    VkImageMemoryBarrier toTransfer{};
+    toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    toTransfer.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    toTransfer.oldLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.image = swapChainImages[imageIndex];
+    toTransfer.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {swapChainExtent.width, swapChainExtent.height, 1};
+    vkCmdCopyImageToBuffer(commandBuffer, swapChainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, captureBuffers[captureSlot].buffer, 1, &region);
+
+    VkBufferMemoryBarrier toHost{};
+    toHost.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toHost.buffer = captureBuffers[captureSlot].buffer;
+    toHost.offset = 0;
+    toHost.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &toHost, 0, nullptr);
+
+    if (!headless) {
+        VkImageMemoryBarrier toPresent = toTransfer;
+        toPresent.srcAccessMask = 0;
+        toPresent.dstAccessMask = 0;
+        toPresent.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        toPresent.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &toPresent);
+    }
+}
+
+void VulkanApplication::pollCaptures() {
+    PROFILE_FUNCTION();
+    bool bgra = swapChainImageFormat == VK_FORMAT_B8G8R8A8_SRGB || swapChainImageFormat == VK_FORMAT_B8G8R8A8_UNORM;
+
+    for (uint32_t slot = 0; slot < captureBuffers.size(); slot++) {
+        CaptureBuffer& capture = captureBuffers[slot];
+        if (!capture.pending || vkGetFenceStatus(device, inFlightFences[capture.frameSlot]) != VK_SUCCESS) {
+            continue;
+        }
+
+        if (!capture.coherent) {
+            VkMappedMemoryRange range{};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = capture.memory;
+            range.offset = 0;
+            range.size = VK_WHOLE_SIZE;
+            vkInvalidateMappedMemoryRanges(device, 1, &range);
+        }
+
+        capture.pending = false;
+        captureEncoder.submit({slot, capture.frameNumber, static_cast<const uint8_t*>(capture.mapped), swapChainExtent.width, swapChainExtent.height, bgra});
+    }
+}
+
+void VulkanApplication::dumpProfilerTrace() {
+    if (profiler::dump_chrome_trace(rendererSettings.profileOutput)) {
+        std::cout << "[INFO] Profiler trace written to " << rendererSettings.profileOutput << std::endl;
+    } else {
+        std::cerr << "[ERROR] Failed to write profiler trace " << rendererSettings.profileOutput << std::endl;
+    }
+}
+
+void VulkanApplication::reportCaptureStats() {
+    float elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - renderStartTime).count();
+    if (elapsed <= 0.0f) {
+        return;
+    }
+
+    uint64_t written = captureEncoder.encodedFrames();
+    std::cout << "[CAPTURE] " << written << " frames written: " << written / elapsed << " fps captured vs "
+              << renderFrames.load(std::memory_order_relaxed) / elapsed << " fps rendered (" << capturesDropped.load(std::memory_order_relaxed)
+              << " of " << capturesRequested.load(std::memory_order_relaxed)
+              << " requested frames dropped)" << std::endl;
+}
+
 void VulkanApplication::cleanupSwapChain() {
     vkDestroyImageView(device, depthImageView, nullptr);
     vkDestroyImage(device, depthImage, nullptr);
@@ -1453,25 +3464,55 @@ void VulkanApplication::cleanupSwapChain() {
         vkDestroyImageView(device, imageView, nullptr);
     }
     
-    vkDestroySwapchainKHR(device, swapChain, nullptr);
+    if (headless) {
+        for (size_t i = 0; i < swapChainImages.size(); i++) {
+            vkDestroyImage(device, swapChainImages[i], nullptr);
+            vkFreeMemory(device, offscreenImagesMemory[i], nullptr);
+        }
+        swapChainImages.clear();
+        offscreenImagesMemory.clear();
+    } else {
+        vkDestroySwapchainKHR(device, swapChain, nullptr);
+    }
 }
 
 void VulkanApplication::recreateSwapChain() {
-    int width = 0, height = 0;
-    glfwGetFramebufferSize(window, &width, &height);
-    while (width == 0 || height == 0) {
-        glfwGetFramebufferSize(window, &width, &height);
-        glfwWaitEvents();
+    // Runs on the render thread, so it cannot touch GLFW; the main thread keeps the size up to date.
+    while (framebufferWidth == 0 || framebufferHeight == 0) {
+        if (!renderThreadRunning) {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
 
     vkDeviceWaitIdle(device);
 
+    if (captureEnabled) {
+        pollCaptures();
+        captureEncoder.waitIdle();
+        destroyCaptureResources();
+    }
+
     cleanupSwapChain();
 
+    size_t previousImageCount = swapChainImages.size();
+
     createSwapChain();
     createImageViews();
     createDepthResources();
     createFramebuffers();
+    for (StaticCommandCache& cache : staticCommandCaches) {
+        cache.valid = false;
+    }
+
+    if (swapChainImages.size() != previousImageCount) {
+        destroyRenderFinishedSemaphores();
+        createRenderFinishedSemaphores();
+    }
+
+    if (captureEnabled) {
+        createCaptureResources();
+    }
 }
 
 void VulkanApplication::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
@@ -1504,11 +3545,14 @@ bool VulkanApplication::checkValidationLayerSupport() {
 }
 
 std::vector<const char*> VulkanApplication::getRequiredExtensions() {
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-    
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    std::vector<const char*> extensions;
+
+    if (!headless) {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
     
     if (enableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -1522,8 +3566,8 @@ bool VulkanApplication::isDeviceSuitable(VkPhysicalDevice device) {
     
     bool extensionsSupported = checkDeviceExtensionSupport(device);
     
-    bool swapChainAdequate = false;
-    if(extensionsSupported) {
+    bool swapChainAdequate = headless;
+    if(extensionsSupported && !headless) {
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
@@ -1531,7 +3575,35 @@ bool VulkanApplication::isDeviceSuitable(VkPhysicalDevice device) {
     VkPhysicalDeviceFeatures supportedFeatures;
     vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
     
-    return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+    return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy &&
+           checkDescriptorIndexingSupport(device);
+}
+
+bool VulkanApplication::checkDescriptorIndexingSupport(VkPhysicalDevice device) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_2) {
+        return false;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &indexingFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+    indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &indexingProperties;
+    vkGetPhysicalDeviceProperties2(device, &properties2);
+
+    return indexingFeatures.shaderSampledImageArrayNonUniformIndexing && indexingFeatures.descriptorBindingPartiallyBound &&
+           indexingFeatures.descriptorBindingSampledImageUpdateAfterBind && indexingFeatures.descriptorBindingUpdateUnusedWhilePending &&
+           indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers >= MAX_TEXTURES &&
+           indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages >= MAX_TEXTURES;
 }
 
 bool VulkanApplication::checkDeviceExtensionSupport(VkPhysicalDevice device) {
@@ -1540,6 +3612,7 @@ bool VulkanApplication::checkDeviceExtensionSupport(VkPhysicalDevice device) {
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.   data());
     
+    std::vector<const char*> deviceExtensions = getRequiredDeviceExtensions();
     std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end()          );
     
     for(const auto& extension : availableExtensions) {
@@ -1549,6 +3622,13 @@ bool VulkanApplication::checkDeviceExtensionSupport(VkPhysicalDevice device) {
     return requiredExtensions.empty();
 }
 
+std::vector<const char*> VulkanApplication::getRequiredDeviceExtensions() {
+    if (headless) {
+        return {};
+    }
+    return presentDeviceExtensions;
+}
+
 QueueFamilyIndices VulkanApplication::findQueueFamilies(VkPhysicalDevice device) {
     QueueFamilyIndices indices;
     
@@ -1564,7 +3644,12 @@ QueueFamilyIndices VulkanApplication::findQueueFamilies(VkPhysicalDevice device)
         }
         
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        if (headless) {
+            // Nothing is presented; the graphics queue doubles as the "present" queue.
+            presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        } else {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        }
         
         if(presentSupport) {
             indices.presentFamily = i;
@@ -1613,10 +3698,20 @@ VkSurfaceFormatKHR VulkanApplication::chooseSwapSurfaceFormat(const std::vector<
 }
 
 VkPresentModeKHR VulkanApplication::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
-    for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            return availablePresentMode;
-        }
+    auto is_available = [&](VkPresentModeKHR mode) {
+        return std::find(availablePresentModes.begin(), availablePresentModes.end(), mode) != availablePresentModes.end();
+    };
+
+    if (is_available(rendererSettings.presentMode)) {
+        return rendererSettings.presentMode;
+    }
+
+    // The two low-latency modes are the closest substitutes for each other; FIFO is always supported.
+    if (rendererSettings.presentMode == VK_PRESENT_MODE_IMMEDIATE_KHR && is_available(VK_PRESENT_MODE_MAILBOX_KHR)) {
+        return VK_PRESENT_MODE_MAILBOX_KHR;
+    }
+    if (rendererSettings.presentMode == VK_PRESENT_MODE_MAILBOX_KHR && is_available(VK_PRESENT_MODE_IMMEDIATE_KHR)) {
+        return VK_PRESENT_MODE_IMMEDIATE_KHR;
     }
     
     return VK_PRESENT_MODE_FIFO_KHR;
@@ -1626,12 +3721,9 @@ VkExtent2D VulkanApplication::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& c
     if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
         return capabilities.currentExtent;
     } else {
-        int width, height;
-        glfwGetFramebufferSize(window, &width, &height);
-        
         VkExtent2D actualExtent = {
-            static_cast<uint32_t>(width),
-            static_cast<uint32_t>(height)
+            static_cast<uint32_t>(framebufferWidth.load()),
+            static_cast<uint32_t>(framebufferHeight.load())
         };
         
         actualExtent.width = std::clamp(actualExtent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
@@ -1845,6 +3937,8 @@ bool VulkanApplication::hasStencilComponent(VkFormat format) {
 
 void VulkanApplication::framebufferResizeCallback(GLFWwindow* window, int width, int height) {
     auto app = reinterpret_cast<VulkanApplication*>(glfwGetWindowUserPointer(window));
+    app->framebufferWidth = width;
+    app->framebufferHeight = height;
     app->framebufferResized = true;
 }
 
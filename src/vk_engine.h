@@ -1,9 +1,14 @@
 #pragma once
 
+#include <array>
 #include <vector>
 #include <optional>
 #include <string>
 #include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <chrono>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
@@ -17,6 +22,22 @@
 
 #include "mesh.h"
 #include "initializers.h"
+#include "frame_mailbox.h"
+#include "settings.h"
+#include "frame_capture.h"
+#include "profiler.h"
+#include "vk_queries.h"
+#include "bench.h"
+#include "draw_sort.h"
+#include "debug_draw.h"
+#include "impostor.h"
+#include "light_clusters.h"
+#include "input_record.h"
+#include "transform_batch.h"
+#include "mesh_optimizer.h"
+#include "vk_textures.h"
+#include "ao_bake.h"
+#include "parallel_for.h"
 
 const float BALL_RADIUS = 0.16f;
 
@@ -53,6 +74,8 @@ struct SwapChainSupportDetails {
 struct UniformBufferObject {
     alignas(16) glm::mat4 view;
     alignas(16) glm::mat4 proj;
+    // World to clip space of the lamp's shadow map.
+    alignas(16) glm::mat4 shadowViewProj;
 };
 
 struct Light {
@@ -63,12 +86,31 @@ struct Light {
 
 struct Material {
 	glm::vec3 color{1.0f, 1.0f, 1.0f};
+	// Diffuse texture multiplied with color; INVALID_TEXTURE samples the white default.
+	TextureId texture = INVALID_TEXTURE;
+	// Slot in the material storage buffer, assigned by createMaterialTable.
+	uint32_t index = 0;
+	// The .mtl dissolve; materials below 1 draw with the blended pipeline, sorted back to front.
+	float opacity = 1.0f;
 };
 
 struct SubMesh {
     std::string materialName;
     uint32_t indexCount;
     uint32_t firstIndex;
+    // Material::index of materialName, resolved once the scene is loaded.
+    uint32_t materialIndex = 0;
+};
+
+const uint32_t MAX_MESH_LODS = 4;
+
+// A level of detail: the run of a mesh's submeshes drawn instead of the full-resolution ones.
+struct MeshLod {
+    uint32_t firstSubMesh;
+    uint32_t subMeshCount;
+    uint32_t triangleCount;
+    // Largest object-space deviation from LOD 0.
+    float error;
 };
 
 struct Mesh {
@@ -78,7 +120,25 @@ struct Mesh {
     VkDeviceMemory _vertexBufferMemory{VK_NULL_HANDLE};
     VkBuffer _indexBuffer{VK_NULL_HANDLE};
     VkDeviceMemory _indexBufferMemory{VK_NULL_HANDLE};
+    // Width of the uploaded index buffer; _indices stays 32-bit on the CPU.
+    VkIndexType _indexType{VK_INDEX_TYPE_UINT32};
     std::vector<SubMesh> _subMeshes;
+    // Dequantization for packed vertices; identity when the vertex buffer holds float Vertex data.
+    VertexQuantization _quantization;
+    // Finest first; _lods[0] covers the original submeshes. Empty for meshes without a chain.
+    std::vector<MeshLod> _lods;
+    // Object-space bounding sphere used to project LOD errors onto the screen.
+    glm::vec3 _boundsCenter{0.0f};
+    float _boundsRadius = 0.0f;
+    // Mesh field of draw sort keys, assigned by createDrawDataBuffers.
+    uint32_t _sortId = 0;
+    // Entry in the impostor table drawn instead of the mesh with --ball-impostors; -1 for none.
+    int32_t _impostorIndex = -1;
+    // Baked ambient occlusion per vertex (255 is open), uploaded as a second vertex stream.
+    // Empty for meshes drawn without it.
+    std::vector<uint8_t> _occlusion;
+    VkBuffer _occlusionBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory _occlusionBufferMemory{VK_NULL_HANDLE};
 };
 
 struct RenderObject {
@@ -86,13 +146,164 @@ struct RenderObject {
     glm::mat4 transformMatrix;
 };
 
-struct GPUDrawPushConstants {
+struct CameraState {
+    float yaw;
+    float pitch;
+    float distance;
+};
+
+// Everything the render thread needs from one simulation tick. Transforms are
+// parallel to _dynamicRenderables, whose mesh names never change after setup.
+struct FrameSnapshot {
+    std::vector<glm::mat4> dynamicTransforms;
+    CameraState camera{};
+    Light light{};
+    // Every light binned into clusters; lights[0] is the lamp.
+    std::vector<GPUPointLight> lights;
+    uint64_t simTick = 0;
+    // steady_clock time at which processInput sampled the keys for this tick.
+    std::chrono::steady_clock::time_point inputSampleTime{};
+};
+
+struct FrameTimings {
+    float simMs = 0.0f;
+    float renderMs = 0.0f;
+    uint64_t simTicks = 0;
+    uint64_t renderFrames = 0;
+    // Input sample to present submission, averaged since the previous report.
+    float inputToPresentMs = 0.0f;
+    float inputToPresentMaxMs = 0.0f;
+    // Draw counts of the most recently recorded frame.
+    uint64_t triangles = 0;
+    std::array<uint32_t, MAX_MESH_LODS> objectsPerLod{};
+    uint32_t drawCalls = 0;
+    uint32_t indirectCalls = 0;
+    uint32_t pipelineBinds = 0;
+    // Vertex and index buffer binds together.
+    uint32_t bufferBinds = 0;
+    // Times a static command buffer was recorded since startup.
+    uint64_t staticCommandRecords = 0;
+    // Objects drawn as ray-traced sphere impostors.
+    uint32_t impostors = 0;
+    // Times the static shadow layer and the composited shadow map were rendered since startup.
+    uint64_t staticShadowRenders = 0;
+    uint64_t shadowRenders = 0;
+    // Light clustering of the most recently recorded frame.
+    uint32_t lights = 0;
+    uint32_t visibleLights = 0;
+    uint32_t litClusters = 0;
+    uint32_t maxClusterLights = 0;
+    uint32_t lightIndices = 0;
+};
+
+// Host-visible buffer a rendered frame is copied into. pending is set while the
+// copy is in flight and is only touched by the render thread.
+struct CaptureBuffer {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    void* mapped = nullptr;
+    bool coherent = true;
+    bool pending = false;
+    uint32_t frameSlot = 0;
+    uint64_t frameNumber = 0;
+};
+
+// Command counts of the most recently recorded frame.
+struct DrawStats {
+    // Draws executed, whether recorded directly or read from the indirect buffer.
+    uint32_t drawCalls = 0;
+    uint64_t triangles = 0;
+    uint32_t pipelineBinds = 0;
+    uint32_t vertexBufferBinds = 0;
+    uint32_t indexBufferBinds = 0;
+    uint32_t indirectCalls = 0;
+    // Objects drawn at each level of detail.
+    std::array<uint32_t, MAX_MESH_LODS> objectsPerLod{};
+    uint32_t impostors = 0;
+};
+
+// One drawn object in the object storage buffer (std430).
+struct GPUObjectData {
     glm::mat4 transform;
+    // Object-space position = vertex position * positionScale + positionOffset.
+    glm::vec4 positionScale;
+    glm::vec4 positionOffset;
+};
+
+// One draw in the draw storage buffer, found through gl_InstanceIndex (the draw's firstInstance).
+struct GPUDrawData {
+    uint32_t objectIndex;
+    uint32_t materialIndex;
+};
+
+// One material in the material storage buffer (std430).
+struct GPUMaterialData {
     glm::vec4 color;
+    // Slot in the bindless texture array.
+    uint32_t textureIndex;
+    uint32_t padding[3];
+};
+
+// One ball in the impostor table (std430). Impostor draws store its index in GPUDrawData::materialIndex.
+struct GPUImpostorData {
+    // Object-space center and radius of the sphere.
+    glm::vec4 sphere;
+    // First texel and size of the ball's marking map in the texel section.
+    uint32_t texelOffset;
+    uint32_t width;
+    uint32_t height;
+    uint32_t padding;
+};
+
+// Where each section of a frame's draw data buffer starts, and how many entries it holds.
+struct DrawDataLayout {
+    uint32_t objectCapacity = 0;
+    uint32_t drawCapacity = 0;
+    uint32_t materialCount = 0;
+    uint32_t lightCapacity = 0;
+    VkDeviceSize objectsOffset = 0;
+    VkDeviceSize drawsOffset = 0;
+    VkDeviceSize materialsOffset = 0;
+    VkDeviceSize indirectOffset = 0;
+    // Lights, then the GPUClusterGrid header followed by the clusters, then the light index list.
+    VkDeviceSize lightsOffset = 0;
+    VkDeviceSize clustersOffset = 0;
+    VkDeviceSize lightIndicesOffset = 0;
+    VkDeviceSize size = 0;
+};
+
+// A submesh draw collected by recordCommandBuffer, written to the draw data once sorted.
+struct PendingDraw {
+    const Mesh* mesh;
+    uint32_t objectIndex;
+    uint32_t materialIndex;
+    uint32_t indexCount;
+    uint32_t firstIndex;
+};
+
+// Consecutive draws that share a pipeline and a mesh, recorded with one indirect call.
+struct DrawRun {
+    VkPipeline pipeline;
+    const Mesh* mesh;
+    uint32_t firstDraw;
+    uint32_t drawCount;
+};
+
+// A frame slot's pre-recorded static draws and what they were recorded for.
+struct StaticCommandCache {
+    bool valid = false;
+    VkExtent2D extent{};
+    std::vector<DrawRun> runs;
+    // Direct-draw fallback only: the commands the draws were recorded from.
+    std::vector<VkDrawIndexedIndirectCommand> commands;
+    // Command counters of the recording, added to every frame that executes it.
+    DrawStats stats;
 };
 
 class VulkanApplication {
     public:
+
+    explicit VulkanApplication(const RendererSettings& rendererSettings = RendererSettings{});
     
     // Initializes the Vulkan application, including window creation and Vulkan setup.
     void init();
@@ -100,17 +311,35 @@ class VulkanApplication {
     void run();
     // Cleans up all Vulkan resources and terminates the application.
     void cleanup();
+    // Returns the latest timings of the simulation and render threads.
+    FrameTimings getFrameTimings() const;
+    // Returns the timings and starts a new input latency averaging window.
+    FrameTimings consumeFrameTimings();
     
     private:
 
     const float MODEL_SCALE = 1.0f;
 
+    RendererSettings rendererSettings;
+    uint32_t maxFramesInFlight;
+    bool headless;
+
     // Initializes the GLFW window.
     void initWindow();
     // Initializes the core Vulkan components.
     void initVulkan();
-    // The main application loop where frames are rendered and events are processed.
+    // The main application loop: polls events and runs the simulation, while a render thread draws.
     void mainLoop();
+    // The render thread loop: draws the latest published snapshot until stopped.
+    void renderLoop();
+    // Runs the benchmark script serially at a fixed timestep and writes the results file.
+    void benchLoop();
+    // Applies the script's camera, orbit, rack and shot events for the given frame.
+    void applyBenchEvents(const BenchScript& script, uint32_t frame, float deltaTime, size_t& nextShot);
+    // Feeds a recorded input stream to the simulation instead of GLFW, drawing every tick serially.
+    void replayLoop();
+    // Hashes ball positions, velocities and rotations so recorded and replayed sessions can be compared.
+    uint64_t ballStateChecksum() const;
     
     // Creates the Vulkan instance.
     void createInstance();
@@ -126,6 +355,8 @@ class VulkanApplication {
     void createSwapChain();
     // Creates image views for the swap chain images.
     void createImageViews();
+    // Creates the ring of offscreen color targets that stand in for the swap chain in headless mode.
+    void createOffscreenTargets();
     // Creates the render pass that defines the rendering operations.
     void createRenderPass();
     // Creates the descriptor set layout for uniform buffers.
@@ -143,19 +374,42 @@ class VulkanApplication {
     void load_model(const char* filename);
     // Creates the vertex and index buffers for a given mesh.
     void create_mesh_buffers(Mesh& mesh);
+    // Logs the vertex and index buffer memory of the meshes still on the GPU.
+    void reportMeshMemory() const;
+    // Computes the mesh's bounds and simplifies it into up to levelCount extra submesh ranges in the
+    // same buffers, recorded as LODs. A levelCount of 0 leaves only full resolution.
+    void build_mesh_lods(Mesh& mesh, const std::vector<IndexRange>& ranges, uint32_t levelCount);
+    // Picks the coarsest LOD whose error projects to at most lodPixelError pixels.
+    uint32_t selectLod(const Mesh& mesh, const glm::mat4& transform, const glm::vec3& cameraPosition, float pixelsPerUnit) const;
     // Sets up the initial scene with all objects.
     void setup_scene();
-    // Updates the scene's dynamic objects each frame.
+    // Merges every static renderable into one world-space mesh with a submesh per material.
+    void build_static_batch();
+    // Ray-traces per-vertex ambient occlusion of a world-space mesh against its own triangles.
+    void bake_occlusion(Mesh& mesh);
+    // Creates the lamp light and the --lights extras around the table.
+    void setup_lights();
+    // Moves the extra lights along their circles.
+    void update_lights(float deltaTime);
+    // Rebuilds the transforms of the dynamic objects that changed since the last update.
     void update_scene(float deltaTime);
-    // Creates debug axes for visualization.
-    void create_debug_axes();
-    // Draws a vertical line for debugging purposes.
-    void draw_debug_vertical_line(glm::vec2 xz_pos, float height, const std::string& name, const std::string& materialName);
-    // Creates debug lines to visualize the table boundaries.
-    void create_debug_bounds_lines();
+    // Indices into _dynamicRenderables whose transforms the last update_scene changed.
+    const std::vector<uint32_t>& changed_renderables() const { return _changedRenderables; }
+    // Rebuilds this frame's debug lines: world axes, table bounds, light range, ball bounds and trails.
+    void draw_debug_shapes(const FrameSnapshot& snapshot);
 
     // Creates the uniform buffers for passing data to shaders.
     void createUniformBuffers();
+    // Assigns every material a slot in the material buffer and resolves each submesh's material.
+    void createMaterialTable();
+    // Creates the per-frame buffers holding objects, draws, materials and indirect commands.
+    void createDrawDataBuffers();
+    // Creates the debug line pipeline and one persistently mapped vertex buffer per frame in flight.
+    void createDebugDrawResources();
+    // Bakes the ball markings into the impostor buffer and creates the quad mesh and impostor pipeline.
+    void createImpostorResources();
+    // Creates the lamp's shadow maps, their render passes and framebuffers, the sampler and the depth-only pipeline.
+    void createShadowResources();
     // Creates the descriptor pool for allocating descriptor sets.
     void createDescriptorPool();
     // Creates the descriptor sets for the uniform buffers.
@@ -164,14 +418,35 @@ class VulkanApplication {
     void createCommandBuffer();
     // Creates synchronization objects like semaphores and fences.
     void createSyncObjects();
+    // Creates the per swap chain image semaphores signalled when rendering finishes.
+    void createRenderFinishedSemaphores();
+    // Destroys the per swap chain image semaphores.
+    void destroyRenderFinishedSemaphores();
     
+    // Copies the simulation state into the back snapshot slot and publishes it.
+    void publish_snapshot();
     // Renders a single frame.
     void drawFrame();
-    // Updates the uniform buffer with the current camera matrices.
-    void updateUniformBuffer(uint32_t currentImage);
+    // Updates the uniform buffer with the snapshot's camera matrices.
+    void updateUniformBuffer(uint32_t currentImage, const FrameSnapshot& snapshot);
     // Records the rendering commands into a command buffer.
-    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, const FrameSnapshot& snapshot);
     
+    // Creates the ring of readback buffers used for frame capture.
+    void createCaptureResources();
+    // Destroys the readback buffers.
+    void destroyCaptureResources();
+    // Picks a free readback buffer for this frame, or -1 when nothing should be captured.
+    int32_t acquireCaptureBuffer();
+    // Records the copy of the rendered image into the given readback buffer.
+    void recordCaptureCopy(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t captureSlot);
+    // Hands every readback whose frame fence has signalled to the encoder without blocking.
+    void pollCaptures();
+    // Prints the sustained capture rate next to the rendering rate.
+    void reportCaptureStats();
+    // Writes the CPU profiler's buffered zones to the configured trace file.
+    void dumpProfilerTrace();
+
     // Cleans up the swap chain and its associated resources.
     void cleanupSwapChain();
     // Recreates the swap chain when the window is resized.
@@ -187,6 +462,10 @@ class VulkanApplication {
     bool isDeviceSuitable(VkPhysicalDevice device);
     // Checks if a given physical device supports the required extensions.
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    // Checks for Vulkan 1.2 descriptor indexing with a bindless array of MAX_TEXTURES samplers.
+    bool checkDescriptorIndexingSupport(VkPhysicalDevice device);
+    // Returns the device extensions required by the current output mode.
+    std::vector<const char*> getRequiredDeviceExtensions();
     // Finds the queue families for a given physical device.
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
     // Queries the swap chain support details for a given physical device.
@@ -229,26 +508,44 @@ class VulkanApplication {
     // Callback function for Vulkan validation layer messages.
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData);
     
-    GLFWwindow* window;
+    GLFWwindow* window = nullptr;
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     VkDevice device;
     VkQueue graphicsQueue;
-    VkSurfaceKHR surface;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
     VkQueue presentQueue;
-    VkSwapchainKHR swapChain;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+    // In headless mode these hold the offscreen color targets instead of swap chain images.
     std::vector<VkImage> swapChainImages;
+    std::vector<VkDeviceMemory> offscreenImagesMemory;
+    uint32_t nextOffscreenTarget = 0;
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
     std::vector<VkImageView> swapChainImageViews;
     VkRenderPass renderPass;
     VkDescriptorSetLayout descriptorSetLayout;
+    // Set 1: the bindless array of MAX_TEXTURES combined image samplers, owned by the texture cache.
+    VkDescriptorSetLayout textureSetLayout;
     VkPipelineLayout pipelineLayout;
     VkPipeline graphicsPipeline;
+    // Alpha-blended variant without depth writes for translucent materials.
+    VkPipeline translucentPipeline;
+    // Opaque variant reading baked occlusion from vertex binding 1.
+    VkPipeline bakedAoPipeline;
+    // Line-list pipeline for DebugDraw vertices; only created with --debug-draw.
+    VkPipeline debugLinePipeline = VK_NULL_HANDLE;
+    // Ray-traced sphere impostors for the balls; only created with --ball-impostors.
+    VkPipeline impostorPipeline = VK_NULL_HANDLE;
     std::vector<VkFramebuffer> swapChainFramebuffers;
     VkCommandPool commandPool;
     std::vector<VkCommandBuffer> commandBuffers;
+    // Secondary buffers per frame slot: static draws re-recorded only when their runs or the
+    // target size change, and dynamic draws recorded every frame.
+    std::vector<VkCommandBuffer> staticCommandBuffers;
+    std::vector<VkCommandBuffer> dynamicCommandBuffers;
+    std::vector<StaticCommandCache> staticCommandCaches;
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
     std::vector<VkFence> inFlightFences;
@@ -261,26 +558,135 @@ class VulkanApplication {
     std::vector<VkBuffer> uniformBuffers;
     std::vector<VkDeviceMemory> uniformBuffersMemory;
     std::vector<void*> uniformBuffersMapped;
-
-    VkBuffer lightBuffer;
-    VkDeviceMemory lightBufferMemory;
-    void* lightBufferMapped;
     
+    // One host-visible buffer per frame in flight, laid out by drawDataLayout.
+    std::vector<VkBuffer> drawDataBuffers;
+    std::vector<VkDeviceMemory> drawDataMemory;
+    std::vector<void*> drawDataMapped;
+    DrawDataLayout drawDataLayout;
+    // Device-local impostor table followed by the RGBA8 marking texels at impostorTexelsOffset.
+    VkBuffer impostorBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory impostorBufferMemory = VK_NULL_HANDLE;
+    VkDeviceSize impostorTableSize = 0;
+    VkDeviceSize impostorTexelsOffset = 0;
+    VkDeviceSize impostorTexelsSize = 0;
+    // Materials by Material::index.
+    std::vector<const Material*> _materialTable;
+    std::vector<DrawRun> frameDrawRuns;
+    std::vector<uint8_t> frameMaterialUsed;
+    // Draws of the frame in collection order, and the keys that order them.
+    std::vector<PendingDraw> framePendingDraws;
+    std::vector<SortEntry> frameOpaqueEntries;
+    std::vector<SortEntry> frameTranslucentEntries;
+    std::vector<SortEntry> frameSortScratch;
+
     VkDescriptorPool descriptorPool;
     std::vector<VkDescriptorSet> descriptorSets;
     
     VkImage depthImage;
     VkDeviceMemory depthImageMemory;
     VkImageView depthImageView;
+
+    // Lamp shadows: static casters are rendered once into staticShadowImage, which is copied into
+    // shadowImage before the dynamic casters are drawn on top. The shaders sample shadowImage.
+    VkFormat shadowFormat;
+    VkImage staticShadowImage;
+    VkDeviceMemory staticShadowImageMemory;
+    VkImageView staticShadowImageView;
+    VkImage shadowImage;
+    VkDeviceMemory shadowImageMemory;
+    VkImageView shadowImageView;
+    VkSampler shadowSampler;
+    // Clears the static layer; the composited map loads the copied static depth instead.
+    VkRenderPass staticShadowRenderPass;
+    VkRenderPass shadowRenderPass;
+    VkFramebuffer staticShadowFramebuffer;
+    VkFramebuffer shadowFramebuffer;
+    VkPipeline shadowPipeline;
+    // What the cached layers were rendered with; only touched by the render thread.
+    bool staticShadowValid = false;
+    glm::vec3 shadowLightPosition{0.0f};
+    std::vector<glm::mat4> shadowCasterTransforms;
     
     uint32_t currentFrame = 0;
-    bool framebufferResized = false;
+    std::atomic<bool> framebufferResized{false};
+    std::atomic<int> framebufferWidth{0};
+    std::atomic<int> framebufferHeight{0};
+
+    FrameMailbox<FrameSnapshot> _snapshots;
+    uint64_t simTickCounter = 0;
+    std::thread renderThread;
+    std::atomic<bool> renderThreadRunning{false};
+    std::exception_ptr renderThreadError;
+    std::atomic<float> simFrameMs{0.0f};
+    std::atomic<float> renderFrameMs{0.0f};
+    std::atomic<uint64_t> simTicks{0};
+    std::atomic<uint64_t> renderFrames{0};
+    std::atomic<uint64_t> renderTriangles{0};
+    std::atomic<uint32_t> renderDrawCalls{0};
+    std::atomic<uint32_t> renderIndirectCalls{0};
+    std::atomic<uint32_t> renderPipelineBinds{0};
+    std::atomic<uint32_t> renderBufferBinds{0};
+    std::atomic<uint64_t> staticCommandRecords{0};
+    std::atomic<uint32_t> renderImpostors{0};
+    std::atomic<uint64_t> staticShadowRenders{0};
+    std::atomic<uint64_t> shadowRenders{0};
+    std::atomic<uint32_t> renderLights{0};
+    std::atomic<uint32_t> renderVisibleLights{0};
+    std::atomic<uint32_t> renderLitClusters{0};
+    std::atomic<uint32_t> renderMaxClusterLights{0};
+    std::atomic<uint32_t> renderLightIndices{0};
+    std::array<std::atomic<uint32_t>, MAX_MESH_LODS> renderObjectsPerLod{};
+    std::chrono::steady_clock::time_point lastInputSampleTime{};
+
+    bool captureEnabled;
+    std::vector<CaptureBuffer> captureBuffers;
+    CaptureEncoder captureEncoder;
+    int32_t frameCaptureSlot = -1;
+    uint32_t nextCaptureSlot = 0;
+    // Counted on the render thread, reported from the main loop.
+    std::atomic<uint64_t> capturesRequested{0};
+    std::atomic<uint64_t> capturesDropped{0};
+    std::chrono::steady_clock::time_point renderStartTime{};
+
+    bool profilerDumpKeyDown = false;
+    bool pipelineStatisticsSupported = false;
+    bool textureCompressionSupported = false;
+    // multiDrawIndirect and drawIndirectFirstInstance; without them draws are recorded one by one.
+    bool indirectDrawSupported = false;
+    GpuQueries gpuQueries;
+    TextureCache textureCache;
+    DrawStats frameDrawStats;
+    DebugDraw debugDraw;
+    std::vector<VkBuffer> debugVertexBuffers;
+    std::vector<VkDeviceMemory> debugVertexMemory;
+    std::vector<void*> debugVertexMapped;
+    // DEBUG_TRAIL_LENGTH recent positions per ball, allocated once.
+    std::vector<glm::vec3> debugTrails;
+    bool debugBudgetWarned = false;
+    LightClusterBuilder lightClusters;
+    bool lightBudgetWarned = false;
+    InputRecorder inputRecorder;
+    std::atomic<uint64_t> inputLatencyTotalUs{0};
+    std::atomic<uint64_t> inputLatencySamples{0};
+    std::atomic<uint64_t> inputLatencyMaxUs{0};
     
     void setupPoolTable();
-    void processInput(float deltaTime);
+    // Reads the keyboard into an InputKey bitset and handles the F12 profiler dump.
+    uint16_t sampleInput();
+    void processInput(float deltaTime, const InputFrame& input);
     void updatePhysics(float deltaTime);
     std::vector<PoolBall> balls;
     CueStick cue;
+    // Set by the physics step for every ball that moved; cleared once update_scene rebuilt its transform.
+    std::vector<uint8_t> ballTransformDirty;
+    bool cueTransformDirty = true;
+    bool cueWasHidden = false;
+    float cueAngleAtUpdate = 0.0f;
+    std::vector<uint32_t> _changedRenderables;
+    TransformSoA _ballTransforms;
+    const glm::mat4 _modelScaleMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(MODEL_SCALE));
+    const glm::mat4 _yToZUpRotation = glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
     
     glm::vec2 table_min_bounds;
     glm::vec2 table_max_bounds;
@@ -288,4 +694,9 @@ class VulkanApplication {
     float cameraYaw = glm::radians(60.0f);
     float cameraPitch = glm::radians(45.0f);
     float cameraDistance = 15.0f;
+    Light sceneLight{glm::vec3(-3.0f, 5.5f, 0.0f), 13.0f, 1.2f};
+    // The lamp first, then the extra lights; anchors are the centers the extras circle around.
+    std::vector<GPUPointLight> sceneLights;
+    std::vector<glm::vec3> lightAnchors;
+    float lightTime = 0.0f;
 };
\ No newline at end of file
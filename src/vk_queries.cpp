@@ -0,0 +1,193 @@
+#include "vk_queries.h"
+#include "profiler.h"
+
+#include <iostream>
+#include <stdexcept>
+
+static const char* GPU_ZONE_NAMES[] = {"GPU Render Pass", "GPU Static", "GPU Dynamic"};
+
+void GpuQueries::init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t graphicsFamily, uint32_t frameSlots, bool pipelineStatisticsEnabled) {
+    this->device = device;
+    slots.assign(frameSlots, FrameSlot{});
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+    uint32_t validBits = families[graphicsFamily].timestampValidBits;
+    if (validBits > 0) {
+        timestampPeriodNs = properties.limits.timestampPeriod;
+        timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = frameSlots * TIMESTAMP_COUNT;
+        if (vkCreateQueryPool(device, &poolInfo, nullptr, &timestampPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+    }
+
+    if (pipelineStatisticsEnabled) {
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        poolInfo.queryCount = frameSlots * DRAW_GROUP_COUNT;
+        poolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+        if (vkCreateQueryPool(device, &poolInfo, nullptr, &statisticsPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline statistics query pool!");
+        }
+    }
+
+    std::cout << "[INFO] GPU queries: timestamps " << (timestampPool != VK_NULL_HANDLE ? "on" : "unsupported")
+              << ", pipeline statistics " << (statisticsPool != VK_NULL_HANDLE ? "on" : "unsupported") << std::endl;
+}
+
+void GpuQueries::destroy() {
+    if (timestampPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(device, timestampPool, nullptr);
+        timestampPool = VK_NULL_HANDLE;
+    }
+    if (statisticsPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(device, statisticsPool, nullptr);
+        statisticsPool = VK_NULL_HANDLE;
+    }
+    slots.clear();
+}
+
+void GpuQueries::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameSlot) {
+    if (timestampPool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(commandBuffer, timestampPool, frameSlot * TIMESTAMP_COUNT, TIMESTAMP_COUNT);
+    }
+    if (statisticsPool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(commandBuffer, statisticsPool, frameSlot * DRAW_GROUP_COUNT, DRAW_GROUP_COUNT);
+    }
+    slots[frameSlot].recorded = true;
+}
+
+void GpuQueries::writeTimestamp(VkCommandBuffer commandBuffer, uint32_t frameSlot, GpuTimestamp point, VkPipelineStageFlagBits stage) {
+    if (timestampPool != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(commandBuffer, stage, timestampPool, frameSlot * TIMESTAMP_COUNT + point);
+    }
+}
+
+void GpuQueries::beginStatistics(VkCommandBuffer commandBuffer, uint32_t frameSlot, GpuDrawGroup group) {
+    if (statisticsPool != VK_NULL_HANDLE) {
+        vkCmdBeginQuery(commandBuffer, statisticsPool, frameSlot * DRAW_GROUP_COUNT + group, 0);
+    }
+}
+
+void GpuQueries::endStatistics(VkCommandBuffer commandBuffer, uint32_t frameSlot, GpuDrawGroup group) {
+    if (statisticsPool != VK_NULL_HANDLE) {
+        vkCmdEndQuery(commandBuffer, statisticsPool, frameSlot * DRAW_GROUP_COUNT + group);
+    }
+}
+
+void GpuQueries::markSubmitted(uint32_t frameSlot, uint64_t cpuTicks) {
+    slots[frameSlot].submitTicks = cpuTicks;
+}
+
+void GpuQueries::collect(uint32_t frameSlot) {
+    PROFILE_FUNCTION();
+    FrameSlot& slot = slots[frameSlot];
+    if (!slot.recorded) {
+        return;
+    }
+    slot.recorded = false;
+
+    // Each query returns its value followed by an availability word. No WAIT flag: a query
+    // that is somehow still pending is dropped instead of stalling the render thread.
+    const VkQueryResultFlags flags = VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT;
+
+    uint64_t timestamps[TIMESTAMP_COUNT][2] = {};
+    bool timestampsReady = timestampPool != VK_NULL_HANDLE &&
+        vkGetQueryPoolResults(device, timestampPool, frameSlot * TIMESTAMP_COUNT, TIMESTAMP_COUNT,
+                              sizeof(timestamps), timestamps, sizeof(timestamps[0]), flags) == VK_SUCCESS;
+
+    // Vertex invocations, fragment invocations, availability.
+    uint64_t statistics[DRAW_GROUP_COUNT][3] = {};
+    bool statisticsReady = statisticsPool != VK_NULL_HANDLE &&
+        vkGetQueryPoolResults(device, statisticsPool, frameSlot * DRAW_GROUP_COUNT, DRAW_GROUP_COUNT,
+                              sizeof(statistics), statistics, sizeof(statistics[0]), flags) == VK_SUCCESS;
+
+    for (uint32_t i = 0; timestampsReady && i < TIMESTAMP_COUNT; i++) {
+        timestampsReady = timestamps[i][1] != 0;
+    }
+    for (uint32_t i = 0; statisticsReady && i < DRAW_GROUP_COUNT; i++) {
+        statisticsReady = statistics[i][2] != 0;
+    }
+
+    auto elapsed_ms = [&](GpuTimestamp begin, GpuTimestamp end) {
+        uint64_t ticks = (timestamps[end][0] - timestamps[begin][0]) & timestampMask;
+        return static_cast<float>(ticks * static_cast<double>(timestampPeriodNs) / 1e6);
+    };
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    if (timestampsReady) {
+        float passMs = elapsed_ms(TIMESTAMP_PASS_BEGIN, TIMESTAMP_PASS_END);
+        float staticMs = elapsed_ms(TIMESTAMP_STATIC_BEGIN, TIMESTAMP_STATIC_END);
+        float dynamicMs = elapsed_ms(TIMESTAMP_DYNAMIC_BEGIN, TIMESTAMP_DYNAMIC_END);
+        passStats.add(passMs);
+        staticStats.add(staticMs);
+        dynamicStats.add(dynamicMs);
+
+        // GPU and CPU clocks are not calibrated against each other, so the GPU track is
+        // anchored at the submit and only its durations and relative offsets are exact.
+        if (profiler::is_enabled() && slot.submitTicks != 0) {
+            profiler::record_gpu_zone(GPU_ZONE_NAMES[0], slot.submitTicks, 0.0, passMs * 1000.0);
+            profiler::record_gpu_zone(GPU_ZONE_NAMES[1], slot.submitTicks, elapsed_ms(TIMESTAMP_PASS_BEGIN, TIMESTAMP_STATIC_BEGIN) * 1000.0, staticMs * 1000.0);
+            profiler::record_gpu_zone(GPU_ZONE_NAMES[2], slot.submitTicks, elapsed_ms(TIMESTAMP_PASS_BEGIN, TIMESTAMP_DYNAMIC_BEGIN) * 1000.0, dynamicMs * 1000.0);
+        }
+    }
+    if (statisticsReady) {
+        for (uint32_t group = 0; group < DRAW_GROUP_COUNT; group++) {
+            vertexStats[group].add(static_cast<float>(statistics[group][0]));
+            fragmentStats[group].add(static_cast<float>(statistics[group][1]));
+        }
+    }
+}
+
+void GpuQueries::setHistoryCapacity(size_t frames) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    passStats = RollingStats(frames);
+    staticStats = RollingStats(frames);
+    dynamicStats = RollingStats(frames);
+    for (uint32_t group = 0; group < DRAW_GROUP_COUNT; group++) {
+        vertexStats[group] = RollingStats(frames);
+        fragmentStats[group] = RollingStats(frames);
+    }
+}
+
+GpuFrameStats GpuQueries::stats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    GpuFrameStats result;
+    result.timestamps = timestampPool != VK_NULL_HANDLE;
+    result.pipelineStatistics = statisticsPool != VK_NULL_HANDLE;
+    result.samples = passStats.size();
+    result.passMs = passStats.summarize();
+    result.staticMs = staticStats.summarize();
+    result.dynamicMs = dynamicStats.summarize();
+    for (uint32_t group = 0; group < DRAW_GROUP_COUNT; group++) {
+        result.vertexInvocations[group] = vertexStats[group].average();
+        result.fragmentInvocations[group] = fragmentStats[group].average();
+    }
+    return result;
+}
+
+void GpuQueries::printReport() const {
+    GpuFrameStats gpu = stats();
+    if (gpu.timestamps && gpu.samples > 0) {
+        std::cout << "[GPU] Pass: " << gpu.passMs.average << " ms avg, p50 " << gpu.passMs.p50 << " / p95 " << gpu.passMs.p95
+                  << " / p99 " << gpu.passMs.p99 << " ms | Static: " << gpu.staticMs.average << " ms (p95 " << gpu.staticMs.p95
+                  << ") | Dynamic: " << gpu.dynamicMs.average << " ms (p95 " << gpu.dynamicMs.p95 << ")" << std::endl;
+    }
+    if (gpu.pipelineStatistics) {
+        std::cout << "[GPU] Invocations/frame: static " << gpu.vertexInvocations[DRAW_GROUP_STATIC] << " VS, "
+                  << gpu.fragmentInvocations[DRAW_GROUP_STATIC] << " FS | dynamic " << gpu.vertexInvocations[DRAW_GROUP_DYNAMIC]
+                  << " VS, " << gpu.fragmentInvocations[DRAW_GROUP_DYNAMIC] << " FS" << std::endl;
+    }
+}
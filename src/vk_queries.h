@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "vk_types.h"
+#include "rolling_stats.h"
+
+// Points in the frame where a GPU timestamp is written.
+enum GpuTimestamp : uint32_t {
+    TIMESTAMP_PASS_BEGIN,
+    TIMESTAMP_STATIC_BEGIN,
+    TIMESTAMP_STATIC_END,
+    TIMESTAMP_DYNAMIC_BEGIN,
+    TIMESTAMP_DYNAMIC_END,
+    TIMESTAMP_PASS_END,
+    TIMESTAMP_COUNT
+};
+
+// Draw groups measured with pipeline-statistics queries.
+enum GpuDrawGroup : uint32_t {
+    DRAW_GROUP_STATIC,
+    DRAW_GROUP_DYNAMIC,
+    DRAW_GROUP_COUNT
+};
+
+// Rolling GPU timings in milliseconds and shader invocation counts per frame.
+struct GpuFrameStats {
+    StatsSummary passMs;
+    StatsSummary staticMs;
+    StatsSummary dynamicMs;
+    float vertexInvocations[DRAW_GROUP_COUNT] = {};
+    float fragmentInvocations[DRAW_GROUP_COUNT] = {};
+    size_t samples = 0;
+    bool timestamps = false;
+    bool pipelineStatistics = false;
+};
+
+// Timestamp and pipeline-statistics query pools with one range of queries per frame slot.
+// A slot's results are read once its fence has signalled, maxFramesInFlight frames after
+// they were recorded, so reading never stalls the GPU.
+class GpuQueries {
+    public:
+
+    // Creates the pools. Either query type is skipped when the device does not support it.
+    void init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t graphicsFamily, uint32_t frameSlots, bool pipelineStatisticsEnabled);
+    void destroy();
+
+    // Resets the slot's queries. Must be recorded outside a render pass, before any other query command.
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameSlot);
+    void writeTimestamp(VkCommandBuffer commandBuffer, uint32_t frameSlot, GpuTimestamp point, VkPipelineStageFlagBits stage);
+    void beginStatistics(VkCommandBuffer commandBuffer, uint32_t frameSlot, GpuDrawGroup group);
+    void endStatistics(VkCommandBuffer commandBuffer, uint32_t frameSlot, GpuDrawGroup group);
+
+    // Remembers when the slot was submitted; GPU zones in the profiler trace are placed relative to it.
+    void markSubmitted(uint32_t frameSlot, uint64_t cpuTicks);
+    // Reads the slot's previous results without waiting. Call after the slot's fence wait.
+    void collect(uint32_t frameSlot);
+
+    // Sets how many frames the rolling statistics cover and clears them.
+    void setHistoryCapacity(size_t frames);
+
+    // Thread-safe snapshot of the rolling statistics.
+    GpuFrameStats stats() const;
+    void printReport() const;
+
+    private:
+
+    struct FrameSlot {
+        bool recorded = false;
+        uint64_t submitTicks = 0;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueryPool timestampPool = VK_NULL_HANDLE;
+    VkQueryPool statisticsPool = VK_NULL_HANDLE;
+    float timestampPeriodNs = 1.0f;
+    uint64_t timestampMask = ~0ull;
+    std::vector<FrameSlot> slots;
+
+    mutable std::mutex statsMutex;
+    RollingStats passStats;
+    RollingStats staticStats;
+    RollingStats dynamicStats;
+    RollingStats vertexStats[DRAW_GROUP_COUNT];
+    RollingStats fragmentStats[DRAW_GROUP_COUNT];
+};
@@ -0,0 +1,590 @@
+#include "vk_textures.h"
+#include "initializers.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include <stb_image.h>
+
+static VkFormat vk_format(TextureFormat format) {
+    switch (format) {
+        case TextureFormat::BC1: return VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+        case TextureFormat::BC7: return VK_FORMAT_BC7_SRGB_BLOCK;
+        default:                 return VK_FORMAT_R8G8B8A8_SRGB;
+    }
+}
+
+static void image_barrier(VkCommandBuffer commandBuffer, VkImage image, uint32_t baseMip, uint32_t mipCount,
+                          VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess,
+                          VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = baseMip;
+    barrier.subresourceRange.levelCount = mipCount;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+// Copies every level the source provides from the staging buffer in one call, then blits
+// each remaining level from the one above it. Every level ends in SHADER_READ_ONLY_OPTIMAL.
+static void record_upload(VkCommandBuffer commandBuffer, VkBuffer staging, VkDeviceSize offset, VkImage image,
+                          const TextureImage& source, uint32_t mipLevels) {
+    image_barrier(commandBuffer, image, 0, mipLevels, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                  0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    uint32_t copiedLevels = static_cast<uint32_t>(source.mips.size());
+    std::vector<VkBufferImageCopy> regions(copiedLevels);
+    for (uint32_t level = 0; level < copiedLevels; ++level) {
+        VkBufferImageCopy& region = regions[level];
+        region.bufferOffset = offset + source.mips[level].offset;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = level;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {source.mips[level].width, source.mips[level].height, 1};
+    }
+    vkCmdCopyBufferToImage(commandBuffer, staging, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copiedLevels, regions.data());
+
+    if (copiedLevels > 1) {
+        image_barrier(commandBuffer, image, 0, copiedLevels - 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                      VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    }
+
+    int32_t mipWidth = static_cast<int32_t>(source.mips.back().width);
+    int32_t mipHeight = static_cast<int32_t>(source.mips.back().height);
+    for (uint32_t level = copiedLevels; level < mipLevels; ++level) {
+        image_barrier(commandBuffer, image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                      VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        VkImageBlit blit{};
+        blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+        blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1};
+        blit.dstOffsets[1] = {std::max(mipWidth / 2, 1), std::max(mipHeight / 2, 1), 1};
+        blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+        vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        image_barrier(commandBuffer, image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                      VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+        mipWidth = std::max(mipWidth / 2, 1);
+        mipHeight = std::max(mipHeight / 2, 1);
+    }
+
+    image_barrier(commandBuffer, image, mipLevels - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                  VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
+
+void TextureCache::init(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, uint32_t queueFamily,
+                        VkDescriptorSetLayout setLayout, VkDeviceSize budgetBytes, uint32_t framesInFlight,
+                        bool compressedFormats, bool loadBaked) {
+    this->physicalDevice = physicalDevice;
+    this->device = device;
+    this->queue = queue;
+    this->setLayout = setLayout;
+    this->budgetBytes = budgetBytes;
+    this->framesInFlight = framesInFlight;
+    this->loadBaked = loadBaked;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    auto sampled_with_filtering = [&](TextureFormat format) {
+        const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, vk_format(format), &formatProperties);
+        return (formatProperties.optimalTilingFeatures & required) == required;
+    };
+    linearBlitSupported = sampled_with_filtering(TextureFormat::RGBA8);
+    bc1Supported = compressedFormats && sampled_with_filtering(TextureFormat::BC1);
+    bc7Supported = compressedFormats && sampled_with_filtering(TextureFormat::BC7);
+
+    VkSamplerCreateInfo samplerInfo = vkinit::sampler_create_info(VK_FILTER_LINEAR);
+    samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create texture sampler.");
+    }
+
+    VkDescriptorPoolSize poolSize{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_TEXTURES};
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = 1;
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create texture descriptor pool.");
+    }
+
+    VkDescriptorSetAllocateInfo setInfo{};
+    setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setInfo.descriptorPool = descriptorPool;
+    setInfo.descriptorSetCount = 1;
+    setInfo.pSetLayouts = &setLayout;
+    if (vkAllocateDescriptorSets(device, &setInfo, &textureSet) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate the bindless texture set.");
+    }
+
+    // The render thread owns this pool; the application's pool belongs to the main thread.
+    VkCommandPoolCreateInfo commandPoolInfo = vkinit::command_pool_create_info(queueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    if (vkCreateCommandPool(device, &commandPoolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create texture upload command pool.");
+    }
+    VkCommandBufferAllocateInfo allocInfo = vkinit::command_buffer_allocate_info(commandPool);
+    VkFenceCreateInfo fenceInfo = vkinit::fence_create_info();
+    if (vkAllocateCommandBuffers(device, &allocInfo, &uploadCommands) != VK_SUCCESS ||
+        vkCreateFence(device, &fenceInfo, nullptr, &uploadFence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create texture upload objects.");
+    }
+
+    textures.reserve(MAX_TEXTURES);
+    textures.emplace_back();
+    textures[0].path = "<default>";
+    const uint8_t whitePixel[4] = {255, 255, 255, 255};
+    std::vector<DecodedImage> white(1);
+    white[0].id = 0;
+    white[0].image = texture_compress::from_pixels(whitePixel, 1, 1);
+    uploadBatch(white);
+    retireUpload(true);
+
+    stopping = false;
+    uint32_t workerCount = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+    for (uint32_t i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&TextureCache::runWorker, this);
+    }
+
+    std::cout << "[INFO] Texture cache: " << workerCount << " decode threads, " << budgetBytes / (1024 * 1024) << " MiB budget, mipmaps "
+              << (linearBlitSupported ? "blitted on the GPU" : "unsupported for this format") << ", BC1 " << (bc1Supported ? "on" : "off")
+              << ", BC7 " << (bc7Supported ? "on" : "off") << ", baked files " << (loadBaked ? "preferred" : "ignored") << std::endl;
+}
+
+void TextureCache::destroy() {
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        stopping = true;
+    }
+    jobAvailable.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    jobs.clear();
+    decoded.clear();
+
+    if (device == VK_NULL_HANDLE) {
+        return;
+    }
+
+    retireUpload(true);
+    for (Texture& texture : textures) {
+        destroyTexture(texture);
+    }
+    textures.clear();
+    paths.clear();
+    lru.clear();
+    residentBytes = 0;
+
+    vkDestroyFence(device, uploadFence, nullptr);
+    vkDestroyCommandPool(device, commandPool, nullptr);
+    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+    textureSet = VK_NULL_HANDLE;
+    vkDestroySampler(device, sampler, nullptr);
+    device = VK_NULL_HANDLE;
+}
+
+TextureId TextureCache::request(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto known = paths.find(path);
+    if (known != paths.end()) {
+        return known->second;
+    }
+    if (textures.size() >= MAX_TEXTURES) {
+        throw std::runtime_error("failed to register texture " + path + ": more than " + std::to_string(MAX_TEXTURES - 1) + " textures.");
+    }
+
+    TextureId id = static_cast<TextureId>(textures.size());
+    textures.emplace_back();
+    textures.back().path = path;
+    paths[path] = id;
+    queueDecode(id);
+    return id;
+}
+
+void TextureCache::queueDecode(TextureId id) {
+    textures[id].state = TextureState::Decoding;
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        jobs.emplace_back(id, textures[id].path);
+    }
+    jobAvailable.notify_one();
+}
+
+void TextureCache::runWorker() {
+    while (true) {
+        std::pair<TextureId, std::string> job;
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        DecodedImage image = load(job.first, job.second);
+        std::lock_guard<std::mutex> lock(jobMutex);
+        decoded.push_back(std::move(image));
+    }
+}
+
+TextureCache::DecodedImage TextureCache::load(TextureId id, const std::string& path) const {
+    auto start = std::chrono::high_resolution_clock::now();
+    DecodedImage result;
+    result.id = id;
+    try {
+        std::string baked = texture_compress::baked_path(path);
+        if (baked == path || (loadBaked && std::ifstream(baked).good())) {
+            result.image = texture_compress::read_file(baked);
+            if (!supports(result.image.format)) {
+                result.image = texture_compress::decompress(result.image);
+            }
+        } else {
+            int width = 0, height = 0, channels = 0;
+            stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+            if (!pixels) {
+                throw std::runtime_error(stbi_failure_reason());
+            }
+            result.image = texture_compress::from_pixels(pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+            stbi_image_free(pixels);
+        }
+    } catch (const std::exception& e) {
+        result.image = TextureImage{};
+        result.error = e.what();
+    }
+    result.loadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return result;
+}
+
+bool TextureCache::supports(TextureFormat format) const {
+    switch (format) {
+        case TextureFormat::BC1: return bc1Supported;
+        case TextureFormat::BC7: return bc7Supported;
+        default:                 return true;
+    }
+}
+
+void TextureCache::update() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++frame;
+    retireUpload(false);
+    // One batch at a time keeps a single staging buffer alive.
+    if (uploadInFlight) {
+        return;
+    }
+
+    std::vector<DecodedImage> images;
+    {
+        std::lock_guard<std::mutex> jobLock(jobMutex);
+        images.swap(decoded);
+    }
+    if (!images.empty()) {
+        uploadBatch(images);
+    }
+}
+
+void TextureCache::uploadBatch(std::vector<DecodedImage>& images) {
+    struct PendingUpload {
+        TextureId id;
+        size_t image;
+        VkDeviceSize stagingOffset;
+    };
+    std::vector<PendingUpload> pending;
+    std::vector<DecodedImage> deferred;
+    VkDeviceSize stagingSize = 0;
+
+    for (size_t i = 0; i < images.size(); ++i) {
+        DecodedImage& decodedImage = images[i];
+        Texture& texture = textures[decodedImage.id];
+        const TextureImage& source = decodedImage.image;
+        if (source.mips.empty()) {
+            std::cerr << "[ERROR] Failed to decode texture " << texture.path << ": " << decodedImage.error << std::endl;
+            texture.state = TextureState::Failed;
+            continue;
+        }
+
+        texture.format = source.format;
+        texture.width = source.width;
+        texture.height = source.height;
+        // Baked files carry their whole chain; single RGBA8 levels get theirs blitted.
+        if (source.mips.size() > 1 || source.format != TextureFormat::RGBA8 || !linearBlitSupported) {
+            texture.mipLevels = static_cast<uint32_t>(source.mips.size());
+        } else {
+            texture.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texture.width, texture.height)))) + 1;
+        }
+
+        VkImageCreateInfo imageInfo = vkinit::image_create_info(vk_format(texture.format), VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                                                texture.width, texture.height, VK_IMAGE_TILING_OPTIMAL);
+        imageInfo.mipLevels = texture.mipLevels;
+        if (vkCreateImage(device, &imageInfo, nullptr, &texture.image) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create texture image.");
+        }
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(device, texture.image, &requirements);
+        if (decodedImage.id != 0 && requirements.size > budgetBytes) {
+            std::cerr << "[ERROR] Texture " << texture.path << " needs " << requirements.size / (1024 * 1024) << " MiB, more than the whole budget." << std::endl;
+            vkDestroyImage(device, texture.image, nullptr);
+            texture.image = VK_NULL_HANDLE;
+            texture.state = TextureState::Failed;
+            continue;
+        }
+        if (decodedImage.id != 0 && !makeRoom(requirements.size)) {
+            // Everything evictable is still in flight; retry on a later frame.
+            vkDestroyImage(device, texture.image, nullptr);
+            texture.image = VK_NULL_HANDLE;
+            deferred.push_back(std::move(decodedImage));
+            continue;
+        }
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &texture.memory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate texture memory.");
+        }
+        vkBindImageMemory(device, texture.image, texture.memory, 0);
+        texture.bytes = requirements.size;
+        if (decodedImage.id != 0) {
+            residentBytes += texture.bytes;
+        }
+
+        pending.push_back({decodedImage.id, i, stagingSize});
+        // Buffer-to-image copies need offsets aligned to the texel or block size.
+        stagingSize += (source.data.size() + 15) & ~VkDeviceSize(15);
+    }
+
+    if (!deferred.empty()) {
+        std::lock_guard<std::mutex> jobLock(jobMutex);
+        for (DecodedImage& image : deferred) {
+            decoded.push_back(std::move(image));
+        }
+    }
+    if (pending.empty()) {
+        return;
+    }
+
+    auto recordStart = std::chrono::high_resolution_clock::now();
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = stagingSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &stagingBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create texture staging buffer.");
+    }
+    VkMemoryRequirements stagingRequirements;
+    vkGetBufferMemoryRequirements(device, stagingBuffer, &stagingRequirements);
+    VkMemoryAllocateInfo stagingAlloc{};
+    stagingAlloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    stagingAlloc.allocationSize = stagingRequirements.size;
+    stagingAlloc.memoryTypeIndex = findMemoryType(stagingRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    if (vkAllocateMemory(device, &stagingAlloc, nullptr, &stagingMemory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate texture staging memory.");
+    }
+    vkBindBufferMemory(device, stagingBuffer, stagingMemory, 0);
+
+    uint8_t* mapped;
+    vkMapMemory(device, stagingMemory, 0, stagingSize, 0, reinterpret_cast<void**>(&mapped));
+    for (const PendingUpload& upload : pending) {
+        const std::vector<uint8_t>& data = images[upload.image].image.data;
+        memcpy(mapped + upload.stagingOffset, data.data(), data.size());
+    }
+    vkUnmapMemory(device, stagingMemory);
+
+    // Every image and its whole mip chain go into a single command buffer and submit.
+    vkResetCommandBuffer(uploadCommands, 0);
+    VkCommandBufferBeginInfo beginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    vkBeginCommandBuffer(uploadCommands, &beginInfo);
+    for (const PendingUpload& upload : pending) {
+        const Texture& texture = textures[upload.id];
+        record_upload(uploadCommands, stagingBuffer, upload.stagingOffset, texture.image, images[upload.image].image, texture.mipLevels);
+    }
+    vkEndCommandBuffer(uploadCommands);
+
+    // Later frame submits on this queue are ordered after the final barriers, so the textures
+    // can be sampled right away; only the staging buffer has to wait for the fence.
+    VkSubmitInfo submitInfo = vkinit::submit_info(&uploadCommands);
+    if (vkQueueSubmit(queue, 1, &submitInfo, uploadFence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit texture uploads.");
+    }
+    uploadInFlight = true;
+    uploadSubmitted = std::chrono::high_resolution_clock::now();
+    uploadRecordMs = std::chrono::duration<double, std::milli>(uploadSubmitted - recordStart).count();
+    uploadTextureCount = 0;
+    uploadStagingBytes = stagingSize;
+
+    for (const PendingUpload& upload : pending) {
+        Texture& texture = textures[upload.id];
+        VkImageViewCreateInfo viewInfo = vkinit::imageview_create_info(vk_format(texture.format), texture.image, VK_IMAGE_ASPECT_COLOR_BIT);
+        viewInfo.subresourceRange.levelCount = texture.mipLevels;
+        if (vkCreateImageView(device, &viewInfo, nullptr, &texture.view) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create texture image view.");
+        }
+        // Frames in flight sampled slot 0 for this texture, so its own slot is unused.
+        writeSlot(upload.id, texture.view);
+
+        texture.state = TextureState::Resident;
+        texture.lastUsedFrame = frame;
+        if (upload.id != 0) {
+            lru.push_front(upload.id);
+            texture.lruPosition = lru.begin();
+            ++uploads;
+            ++uploadTextureCount;
+            std::cout << "[TEX] " << texture.path << ": " << texture_compress::format_name(texture.format) << " " << texture.width << "x"
+                      << texture.height << ", " << texture.mipLevels << " mips, " << texture.bytes / (1024.0 * 1024.0) << " MiB, loaded in "
+                      << images[upload.image].loadMs << " ms" << std::endl;
+        }
+    }
+}
+
+bool TextureCache::makeRoom(VkDeviceSize bytes) {
+    while (residentBytes + bytes > budgetBytes && !lru.empty()) {
+        // The list is ordered by last use, so once the oldest entry may still be in flight, all are.
+        TextureId oldest = lru.back();
+        if (textures[oldest].lastUsedFrame + framesInFlight > frame) {
+            return false;
+        }
+        evict(oldest);
+    }
+    return residentBytes + bytes <= budgetBytes;
+}
+
+void TextureCache::evict(TextureId id) {
+    Texture& texture = textures[id];
+    lru.erase(texture.lruPosition);
+    residentBytes -= texture.bytes;
+    // Point the slot back at the default so it never references a destroyed view.
+    writeSlot(id, textures[0].view);
+    destroyTexture(texture);
+    texture.state = TextureState::Unloaded;
+    ++evictions;
+}
+
+void TextureCache::writeSlot(TextureId slot, VkImageView view) {
+    VkDescriptorImageInfo imageInfo{sampler, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkWriteDescriptorSet write = vkinit::write_descriptor_image(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, textureSet, &imageInfo, 0);
+    write.dstArrayElement = slot;
+    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
+
+void TextureCache::destroyTexture(Texture& texture) {
+    if (texture.view != VK_NULL_HANDLE) {
+        vkDestroyImageView(device, texture.view, nullptr);
+        texture.view = VK_NULL_HANDLE;
+    }
+    if (texture.image != VK_NULL_HANDLE) {
+        vkDestroyImage(device, texture.image, nullptr);
+        texture.image = VK_NULL_HANDLE;
+    }
+    if (texture.memory != VK_NULL_HANDLE) {
+        vkFreeMemory(device, texture.memory, nullptr);
+        texture.memory = VK_NULL_HANDLE;
+    }
+    texture.bytes = 0;
+}
+
+void TextureCache::retireUpload(bool wait) {
+    if (!uploadInFlight) {
+        return;
+    }
+    if (wait) {
+        vkWaitForFences(device, 1, &uploadFence, VK_TRUE, UINT64_MAX);
+    } else if (vkGetFenceStatus(device, uploadFence) != VK_SUCCESS) {
+        return;
+    }
+
+    if (uploadTextureCount > 0) {
+        // Fences are polled once per frame, so the GPU time is an upper bound.
+        double completeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - uploadSubmitted).count();
+        std::cout << "[TEX] Uploaded " << uploadTextureCount << " textures from " << uploadStagingBytes / (1024.0 * 1024.0) << " MiB of staging: "
+                  << uploadRecordMs << " ms to stage and record, done on the GPU within " << completeMs << " ms" << std::endl;
+    }
+
+    vkResetFences(device, 1, &uploadFence);
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    vkFreeMemory(device, stagingMemory, nullptr);
+    stagingBuffer = VK_NULL_HANDLE;
+    stagingMemory = VK_NULL_HANDLE;
+    uploadInFlight = false;
+}
+
+uint32_t TextureCache::bindlessIndex(TextureId id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (id == INVALID_TEXTURE || id >= textures.size()) {
+        return 0;
+    }
+
+    Texture& texture = textures[id];
+    texture.lastUsedFrame = frame;
+    if (texture.state == TextureState::Resident) {
+        lru.splice(lru.begin(), lru, texture.lruPosition);
+        return id;
+    }
+    if (texture.state == TextureState::Unloaded) {
+        queueDecode(id);
+    }
+    return 0;
+}
+
+uint32_t TextureCache::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    throw std::runtime_error("failed to find suitable memory type for texture.");
+}
+
+TextureCacheStats TextureCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    TextureCacheStats result;
+    result.textures = textures.empty() ? 0 : static_cast<uint32_t>(textures.size() - 1);
+    result.resident = static_cast<uint32_t>(lru.size());
+    for (TextureId id : lru) {
+        if (textures[id].format != TextureFormat::RGBA8) {
+            ++result.compressed;
+        }
+    }
+    result.residentBytes = residentBytes;
+    result.budgetBytes = budgetBytes;
+    result.uploads = uploads;
+    result.evictions = evictions;
+    return result;
+}
+
+void TextureCache::printReport() const {
+    TextureCacheStats current = stats();
+    if (current.textures == 0) {
+        return;
+    }
+    std::cout << "[TEX] " << current.resident << "/" << current.textures << " textures resident (" << current.compressed << " compressed), "
+              << current.residentBytes / (1024.0 * 1024.0) << "/" << current.budgetBytes / (1024 * 1024) << " MiB, "
+              << current.uploads << " uploads, " << current.evictions << " evictions" << std::endl;
+}
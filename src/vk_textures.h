@@ -0,0 +1,172 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "texture_compress.h"
+#include "vk_types.h"
+
+using TextureId = uint32_t;
+// Materials without a texture sample the 1x1 white default, which leaves their color unchanged.
+const TextureId INVALID_TEXTURE = UINT32_MAX;
+// Size of the bindless texture array; must match the array in shader.frag.
+const uint32_t MAX_TEXTURES = 256;
+
+enum class TextureState {
+    // Not on the GPU; the next bindlessIndex() call queues a decode.
+    Unloaded,
+    // Queued for or being decoded on a worker thread, or waiting for the next upload batch.
+    Decoding,
+    // Image and mip chain are on the GPU and the texture's bindless slot has been written.
+    Resident,
+    // The file could not be decoded; the default texture is used instead.
+    Failed
+};
+
+struct TextureCacheStats {
+    uint32_t textures = 0;
+    uint32_t resident = 0;
+    // Resident textures sampled straight from BC1/BC7 blocks.
+    uint32_t compressed = 0;
+    VkDeviceSize residentBytes = 0;
+    VkDeviceSize budgetBytes = 0;
+    uint64_t uploads = 0;
+    uint64_t evictions = 0;
+};
+
+// Streams textures from disk: worker threads decode files, the render thread uploads every
+// decoded image and builds its mip chain in one batched submit per frame, and an LRU list
+// evicts textures that have not been drawn for a while once the memory budget is reached.
+// Baked .btx files are uploaded as stored, block-compressed mips included, and decoded to
+// RGBA8 on the worker when the device cannot sample their format. Every texture lives in one
+// bindless descriptor array at the slot equal to its id; slot 0 is the white default.
+class TextureCache {
+    public:
+
+    // Creates the sampler, the bindless descriptor set, upload command pool, the default texture
+    // and the decode workers. setLayout must hold MAX_TEXTURES combined image samplers at binding 0
+    // with the partially bound, update after bind and update unused while pending flags.
+    // compressedFormats says whether textureCompressionBC is enabled on the device; loadBaked
+    // makes requests for an image load its baked file instead when one exists.
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, uint32_t queueFamily,
+              VkDescriptorSetLayout setLayout, VkDeviceSize budgetBytes, uint32_t framesInFlight,
+              bool compressedFormats, bool loadBaked);
+    // Joins the workers and frees every GPU resource. The device must be idle.
+    void destroy();
+
+    // Registers a texture file and starts decoding it. Requesting a path again returns the same id.
+    TextureId request(const std::string& path);
+
+    // Starts the next frame: retires the previous upload once it has finished and uploads the
+    // textures decoded since. Call from the render thread after the frame's fence wait.
+    void update();
+
+    // Returns the array slot to sample for id and marks the texture used this frame. Until the
+    // texture is resident this is slot 0, the default texture, and an evicted texture is queued
+    // to reload. A slot is only written while no frame in flight can sample it.
+    uint32_t bindlessIndex(TextureId id);
+
+    // The set holding every texture, bound once per frame.
+    VkDescriptorSet bindlessSet() const { return textureSet; }
+
+    TextureCacheStats stats() const;
+    void printReport() const;
+
+    private:
+
+    struct Texture {
+        std::string path;
+        TextureState state = TextureState::Unloaded;
+        TextureFormat format = TextureFormat::RGBA8;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t mipLevels = 1;
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkDeviceSize bytes = 0;
+        uint64_t lastUsedFrame = 0;
+        // Position in the LRU list while resident.
+        std::list<TextureId>::iterator lruPosition;
+    };
+
+    struct DecodedImage {
+        TextureId id;
+        // No mips when loading failed.
+        TextureImage image;
+        std::string error;
+        // Worker time spent reading and decoding the file.
+        double loadMs = 0.0;
+    };
+
+    void runWorker();
+    DecodedImage load(TextureId id, const std::string& path) const;
+    // Whether images of format can be sampled without decoding them first.
+    bool supports(TextureFormat format) const;
+    void queueDecode(TextureId id);
+    // Records and submits the uploads and mip chains of every image that fits the budget.
+    void uploadBatch(std::vector<DecodedImage>& images);
+    // Evicts least recently used textures no frame in flight can still sample until bytes fit.
+    bool makeRoom(VkDeviceSize bytes);
+    void evict(TextureId id);
+    void writeSlot(TextureId slot, VkImageView view);
+    void destroyTexture(Texture& texture);
+    void retireUpload(bool wait);
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet textureSet = VK_NULL_HANDLE;
+    VkSampler sampler = VK_NULL_HANDLE;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer uploadCommands = VK_NULL_HANDLE;
+    VkFence uploadFence = VK_NULL_HANDLE;
+    bool uploadInFlight = false;
+    VkBuffer stagingBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+    bool linearBlitSupported = false;
+    bool bc1Supported = false;
+    bool bc7Supported = false;
+    bool loadBaked = true;
+
+    // Timing of the batch in flight, reported once its fence signals.
+    std::chrono::high_resolution_clock::time_point uploadSubmitted;
+    double uploadRecordMs = 0.0;
+    uint32_t uploadTextureCount = 0;
+    VkDeviceSize uploadStagingBytes = 0;
+
+    VkDeviceSize budgetBytes = 0;
+    VkDeviceSize residentBytes = 0;
+    uint32_t framesInFlight = 1;
+    uint64_t frame = 0;
+    uint64_t uploads = 0;
+    uint64_t evictions = 0;
+
+    // Guards textures, paths and lru; request() may run on another thread than the renderer.
+    // Reserved up front, so references to elements stay valid while it grows.
+    mutable std::mutex mutex;
+    std::vector<Texture> textures;
+    std::unordered_map<std::string, TextureId> paths;
+    // Most recently used first.
+    std::list<TextureId> lru;
+
+    // Guards jobs, decoded and stopping. Always taken after mutex when both are needed.
+    std::mutex jobMutex;
+    std::condition_variable jobAvailable;
+    std::deque<std::pair<TextureId, std::string>> jobs;
+    std::vector<DecodedImage> decoded;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+};